@@ -0,0 +1,497 @@
+/*
+ * boil-bench
+ *
+ * End-to-end generation benchmark for boil. It builds a synthetic template
+ * of the requested shape, runs boil on it several times with each
+ * generator (the cp/grep/sed fallback and boil-render), and reports files
+ * per second, MB per second, peak RSS and the number of processes (and
+ * threads) created.
+ * Results can be saved as a baseline and later runs compared against it.
+ *
+ * Usage: boil-bench [-f files] [-d depth] [-s size] [-p density] [-j jobs]
+ *                   [-r runs] [-b boil] [-R renderer] [-B baseline] [-S]
+ */
+#define _GNU_SOURCE /* nftw, mkdtemp */
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PLACEHOLDER "{{PROJECT_NAME}}"
+#define MAX_RUNS 64
+#define MAX_BASELINE 64
+
+/*
+ * Structure to Hold the Benchmark Configuration
+ */
+typedef struct
+{
+    unsigned files;       /* Number of template files */
+    unsigned depth;       /* Directory levels below the template root */
+    unsigned size;        /* Size of each file in bytes */
+    double density;       /* Placeholders per KiB of content */
+    unsigned jobs;        /* Worker count passed to boil -j */
+    unsigned runs;        /* Timed runs per case */
+    const char *boil;     /* Path of the boil script under test */
+    const char *renderer; /* Path of boil-render */
+    const char *baseline; /* Baseline file */
+    int save;             /* Write results as the new baseline */
+} BenchConfig;
+
+/*
+ * Structure to Hold the Result of One Case
+ */
+typedef struct
+{
+    char name[128];    /* Case name, including the template shape */
+    double files_sec;  /* Files generated per second (median run) */
+    double mb_sec;     /* Template megabytes generated per second */
+    long peak_rss_kb;  /* Largest resident set of any run, in KiB */
+    long spawns;       /* Processes and threads created per run, -1 if unknown */
+} BenchResult;
+
+/*
+ * Function to Read the Monotonic Clock in Seconds
+ */
+static double now_sec_(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Function to Read the System-Wide Fork Counter
+ *
+ * Linux counts every process created since boot in /proc/stat. The delta
+ * across a run is the number of processes the run spawned, as long as
+ * nothing else on the machine is forking at the same time.
+ */
+static long fork_count_(void)
+{
+    char line[256];
+    long n = -1;
+    FILE *f = fopen("/proc/stat", "r");
+
+    if (!f)
+    {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, "processes %ld", &n) == 1)
+        {
+            break;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+/*
+ * Function to Remove a Single Path During Tree Removal
+ */
+static int remove_one_(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+/*
+ * Function to Create a Directory and Its Parents
+ */
+static int mkdir_p_(char *path)
+{
+    char *p;
+
+    for (p = path + 1; *p; p++)
+    {
+        if (*p == '/')
+        {
+            *p = '\0';
+            if (mkdir(path, 0755) != 0 && errno != EEXIST)
+            {
+                return -1;
+            }
+            *p = '/';
+        }
+    }
+    return (mkdir(path, 0755) != 0 && errno != EEXIST) ? -1 : 0;
+}
+
+/*
+ * Function to Build the Synthetic Template
+ *
+ * File i lives depth directories down, in a path picked from the base-4
+ * digits of i, so the tree fans out four ways per level. Content is
+ * printable pseudo-random text with placeholders spread evenly through it.
+ */
+static int make_template_(const BenchConfig *cfg, const char *root, double *bytes)
+{
+    char path[PATH_MAX];
+    char *buf = malloc(cfg->size ? cfg->size : 1);
+    const size_t plen = strlen(PLACEHOLDER);
+    unsigned placeholders = (unsigned)(cfg->size * cfg->density / 1024.0);
+    unsigned seed = 12345;
+    unsigned i;
+    unsigned k;
+
+    if (!buf)
+    {
+        return -1;
+    }
+    if (placeholders * plen > cfg->size)
+    {
+        placeholders = cfg->size / plen;
+    }
+    *bytes = 0;
+    for (i = 0; i < cfg->files; i++)
+    {
+        size_t len = (size_t)snprintf(path, sizeof(path), "%s", root);
+        FILE *f;
+
+        for (k = 0; k < cfg->depth; k++)
+        {
+            len += (size_t)snprintf(path + len, sizeof(path) - len, "/d%u", (i >> (2 * k)) & 3U);
+        }
+        if (mkdir_p_(path) != 0)
+        {
+            free(buf);
+            return -1;
+        }
+        snprintf(path + len, sizeof(path) - len, "/file%u.c", i);
+
+        for (k = 0; k < cfg->size; k++)
+        {
+            seed = seed * 1103515245U + 12345U;
+            buf[k] = (k % 64 == 63) ? '\n' : (char)(' ' + (seed >> 16) % 95);
+        }
+        for (k = 0; k < placeholders; k++)
+        {
+            memcpy(buf + (size_t)k * (cfg->size / placeholders), PLACEHOLDER, plen);
+        }
+        if ((f = fopen(path, "wb")) == NULL || fwrite(buf, 1, cfg->size, f) != cfg->size)
+        {
+            if (f)
+            {
+                fclose(f);
+            }
+            free(buf);
+            return -1;
+        }
+        fclose(f);
+        *bytes += cfg->size;
+    }
+    free(buf);
+    return 0;
+}
+
+/*
+ * Function to Run boil Once and Measure It
+ *
+ * renderer selects the generator: boil-render's path, or a path that does
+ * not exist to force the cp/grep/sed fallback.
+ */
+static int run_once_(const BenchConfig *cfg, const char *work, const char *renderer,
+                     unsigned jobs, double *secs, long *rss_kb, long *spawns)
+{
+    char jobs_arg[16];
+    char tdir[PATH_MAX];
+    struct rusage ru;
+    long forks_before = fork_count_();
+    double t0 = now_sec_();
+    int status;
+    pid_t pid;
+
+    snprintf(jobs_arg, sizeof(jobs_arg), "%u", jobs);
+    snprintf(tdir, sizeof(tdir), "%s/templates", work);
+    pid = fork();
+    if (pid < 0)
+    {
+        return -1;
+    }
+    if (pid == 0)
+    {
+        int null = open("/dev/null", O_WRONLY);
+        if (chdir(work) != 0)
+        {
+            _exit(127);
+        }
+        dup2(null, STDOUT_FILENO);
+        setenv("BOIL_TEMPLATE_DIR", tdir, 1);
+        setenv("BOIL_RENDERER", renderer, 1);
+        /* Render in this process tree, never in a running boild */
+        setenv("BOIL_SOCKET", "", 1);
+        execlp("bash", "bash", cfg->boil, "-j", jobs_arg, "synthetic", "out", (char *)NULL);
+        _exit(127);
+    }
+    if (wait4(pid, &status, 0, &ru) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        return -1;
+    }
+    *secs = now_sec_() - t0;
+    *rss_kb = ru.ru_maxrss;
+    *spawns = forks_before < 0 ? -1 : fork_count_() - forks_before;
+    return 0;
+}
+
+/*
+ * Function to Compare Two Doubles for qsort
+ */
+static int cmp_double_(const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Function to Benchmark One Generator
+ */
+static int run_case_(const BenchConfig *cfg, const char *work, const char *label,
+                     const char *renderer, unsigned jobs, double bytes, BenchResult *r)
+{
+    char out[PATH_MAX];
+    double times[MAX_RUNS];
+    unsigned i;
+
+    snprintf(out, sizeof(out), "%s/out", work);
+    snprintf(r->name, sizeof(r->name), "%s f%u d%u s%u p%g", label, cfg->files, cfg->depth, cfg->size, cfg->density);
+    r->peak_rss_kb = 0;
+    for (i = 0; i < cfg->runs; i++)
+    {
+        long rss;
+        if (run_once_(cfg, work, renderer, jobs, &times[i], &rss, &r->spawns) != 0)
+        {
+            fprintf(stderr, "Error: Case '%s' failed.\n", r->name);
+            return -1;
+        }
+        if (rss > r->peak_rss_kb)
+        {
+            r->peak_rss_kb = rss;
+        }
+        nftw(out, remove_one_, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    qsort(times, cfg->runs, sizeof(times[0]), cmp_double_);
+    r->files_sec = cfg->files / times[cfg->runs / 2];
+    r->mb_sec = bytes / (1024.0 * 1024.0) / times[cfg->runs / 2];
+    return 0;
+}
+
+/*
+ * Function to Load a Baseline File
+ *
+ * Each non-comment line holds a quoted case name followed by files/s,
+ * MB/s, peak RSS in KiB and spawns.
+ */
+static unsigned load_baseline_(const char *path, BenchResult *base)
+{
+    char line[512];
+    unsigned n = 0;
+    FILE *f = fopen(path, "r");
+
+    if (!f)
+    {
+        return 0;
+    }
+    while (n < MAX_BASELINE && fgets(line, sizeof(line), f))
+    {
+        BenchResult *b = &base[n];
+        if (line[0] == '#' ||
+            sscanf(line, "\"%127[^\"]\" %lf %lf %ld %ld", b->name, &b->files_sec, &b->mb_sec, &b->peak_rss_kb, &b->spawns) != 5)
+        {
+            continue;
+        }
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+/*
+ * Function to Save Results as the New Baseline
+ *
+ * Cases already in the baseline but not run this time are kept.
+ */
+static int save_baseline_(const char *path, const BenchResult *res, unsigned nres)
+{
+    BenchResult base[MAX_BASELINE];
+    unsigned nbase = load_baseline_(path, base);
+    unsigned i;
+    unsigned j;
+    FILE *f = fopen(path, "w");
+
+    if (!f)
+    {
+        return -1;
+    }
+    fprintf(f, "# boil-bench baseline: \"case\" files/s MB/s peak_rss_kb spawns\n");
+    fprintf(f, "# Numbers are machine specific; regenerate with: make bench BENCH_ARGS=-S\n");
+    for (i = 0; i < nbase; i++)
+    {
+        for (j = 0; j < nres && strcmp(base[i].name, res[j].name) != 0; j++)
+        {
+        }
+        if (j == nres)
+        {
+            fprintf(f, "\"%s\" %.1f %.2f %ld %ld\n", base[i].name, base[i].files_sec, base[i].mb_sec, base[i].peak_rss_kb, base[i].spawns);
+        }
+    }
+    for (i = 0; i < nres; i++)
+    {
+        fprintf(f, "\"%s\" %.1f %.2f %ld %ld\n", res[i].name, res[i].files_sec, res[i].mb_sec, res[i].peak_rss_kb, res[i].spawns);
+    }
+    return fclose(f);
+}
+
+/*
+ * Function to Display Usage
+ */
+static int usage_(void)
+{
+    fprintf(stderr, "Usage: boil-bench [-f files] [-d depth] [-s size] [-p density] [-j jobs]\n");
+    fprintf(stderr, "                  [-r runs] [-b boil] [-R renderer] [-B baseline] [-S]\n");
+    fprintf(stderr, "  -f files     Template files (default 1000)\n");
+    fprintf(stderr, "  -d depth     Directory depth (default 3)\n");
+    fprintf(stderr, "  -s size      Bytes per file (default 4096)\n");
+    fprintf(stderr, "  -p density   Placeholders per KiB (default 1)\n");
+    fprintf(stderr, "  -j jobs      Also run boil-render with -j jobs (default 4, 1 to skip)\n");
+    fprintf(stderr, "  -r runs      Timed runs per case, median reported (default 5)\n");
+    fprintf(stderr, "  -b boil      boil script to run (default ./boil.sh)\n");
+    fprintf(stderr, "  -R renderer  boil-render binary (default ./boil-render)\n");
+    fprintf(stderr, "  -B baseline  Baseline file (default bench/baseline.txt)\n");
+    fprintf(stderr, "  -S           Save the results as the new baseline\n");
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchConfig cfg = {1000, 3, 4096, 1.0, 4, 5, "./boil.sh", "./boil-render", "bench/baseline.txt", 0};
+    BenchResult res[3];
+    BenchResult base[MAX_BASELINE];
+    char work[] = "/tmp/boil-bench.XXXXXX";
+    char boil[PATH_MAX];
+    char renderer[PATH_MAX];
+    char tdir[PATH_MAX];
+    double bytes;
+    unsigned nres = 0;
+    unsigned nbase;
+    unsigned i;
+    unsigned j;
+    int opt;
+    int rv = 0;
+
+    while ((opt = getopt(argc, argv, "f:d:s:p:j:r:b:R:B:S")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f':
+            cfg.files = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'd':
+            cfg.depth = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            cfg.size = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'p':
+            cfg.density = strtod(optarg, NULL);
+            break;
+        case 'j':
+            cfg.jobs = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            cfg.runs = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            cfg.boil = optarg;
+            break;
+        case 'R':
+            cfg.renderer = optarg;
+            break;
+        case 'B':
+            cfg.baseline = optarg;
+            break;
+        case 'S':
+            cfg.save = 1;
+            break;
+        default:
+            return usage_();
+        }
+    }
+    if (cfg.files == 0 || cfg.runs == 0 || cfg.runs > MAX_RUNS || cfg.density < 0)
+    {
+        return usage_();
+    }
+    if (!realpath(cfg.boil, boil) || !realpath(cfg.renderer, renderer))
+    {
+        fprintf(stderr, "Error: Cannot find '%s' or '%s'; run make first.\n", cfg.boil, cfg.renderer);
+        return 1;
+    }
+    cfg.boil = boil;
+
+    if (!mkdtemp(work))
+    {
+        fprintf(stderr, "Error: Failed to create a work directory: %s\n", strerror(errno));
+        return 1;
+    }
+    snprintf(tdir, sizeof(tdir), "%s/templates/synthetic", work);
+    if (mkdir_p_(tdir) != 0 || make_template_(&cfg, tdir, &bytes) != 0)
+    {
+        fprintf(stderr, "Error: Failed to build the synthetic template.\n");
+        rv = 1;
+    }
+
+    if (rv == 0 && run_case_(&cfg, work, "sed", "/nonexistent", 1, bytes, &res[nres]) == 0)
+    {
+        nres++;
+    }
+    if (rv == 0 && run_case_(&cfg, work, "native", renderer, 1, bytes, &res[nres]) == 0)
+    {
+        nres++;
+    }
+    if (rv == 0 && cfg.jobs > 1)
+    {
+        char label[32];
+        snprintf(label, sizeof(label), "native-j%u", cfg.jobs);
+        if (run_case_(&cfg, work, label, renderer, cfg.jobs, bytes, &res[nres]) == 0)
+        {
+            nres++;
+        }
+    }
+    nftw(work, remove_one_, 16, FTW_DEPTH | FTW_PHYS);
+
+    /* Report, with the change against the baseline where there is one */
+    nbase = load_baseline_(cfg.baseline, base);
+    printf("%-36s %10s %9s %11s %7s %9s\n", "case", "files/s", "MB/s", "peak RSS", "spawns", "vs base");
+    for (i = 0; i < nres; i++)
+    {
+        char delta[16] = "-";
+        for (j = 0; j < nbase; j++)
+        {
+            if (strcmp(base[j].name, res[i].name) == 0 && base[j].files_sec > 0)
+            {
+                snprintf(delta, sizeof(delta), "%+.1f%%", (res[i].files_sec / base[j].files_sec - 1.0) * 100.0);
+                break;
+            }
+        }
+        printf("%-36s %10.1f %9.2f %7ld KiB %7ld %9s\n", res[i].name, res[i].files_sec, res[i].mb_sec,
+               res[i].peak_rss_kb, res[i].spawns, delta);
+    }
+    if (cfg.save && save_baseline_(cfg.baseline, res, nres) != 0)
+    {
+        fprintf(stderr, "Error: Failed to write baseline '%s'.\n", cfg.baseline);
+        rv = 1;
+    }
+    return (rv == 0 && nres > 0) ? 0 : 1;
+}
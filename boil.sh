@@ -6,6 +6,9 @@ set -e
 # Templates directory (can be overridden by an environment variable)
 TEMPLATE_DIR="${BOIL_TEMPLATE_DIR:-"$HOME/.boil/templates"}"
 
+# Native renderer installed next to this script (can be overridden by an environment variable)
+RENDERER="${BOIL_RENDERER:-"$(dirname "$0")/boil-render"}"
+
 # Function to generate a default project name
 generate_project_name() {
   BASE_NAME="project_$(date +%Y%m%d)"
@@ -18,28 +21,134 @@ generate_project_name() {
 
 # Function to display usage
 usage() {
-  echo "Usage: boil <template> [project_name]"
+  echo "Usage: boil [-j jobs] [-H] <template> [project_name...]"
+  echo "       boil [-j jobs] [-H] -n count <template>"
+  echo "       boil [-j jobs] [-H] -f names_file <template>"
+  echo "       boil update [-j jobs] [-H] [project_dir...]"
+  echo "  -j jobs        Generate with jobs parallel workers (0 = one per core)"
+  echo "  -H             Hard-link unchanged template files (read-only, shared)"
+  echo "  -n count       Generate count projects with default names"
+  echo "  -f names_file  Generate one project per line of names_file"
   exit 1
 }
 
+# Function to generate one project with cp and sed (used without boil-render)
+generate_with_sed() {
+  PROJECT_NAME="$1"
+
+  # Create project directory
+  if ! mkdir -p "$PROJECT_NAME"; then
+    echo "Error: Failed to create project directory '$PROJECT_NAME'."
+    exit 1
+  fi
+
+  # Copy template files
+  if ! cp -r "$TEMPLATE_DIR/$TEMPLATE_NAME/." "$PROJECT_NAME/"; then
+    echo "Error: Failed to copy template files."
+    exit 1
+  fi
+
+  # Replace placeholders in files
+  PLACEHOLDER="{{PROJECT_NAME}}"
+  find "$PROJECT_NAME" -type f | while read -r file; do
+    if grep -q "$PLACEHOLDER" "$file"; then
+      # Determine OS for sed compatibility
+      if [[ "$OSTYPE" == "darwin"* ]]; then
+        sed -i "" "s/$PLACEHOLDER/$PROJECT_NAME/g" "$file"
+      else
+        sed -i "s/$PLACEHOLDER/$PROJECT_NAME/g" "$file"
+      fi
+    fi
+  done
+
+  echo "Project '$PROJECT_NAME' created using template '$TEMPLATE_NAME'."
+}
+
+# Bring existing projects up to date with their templates; only
+# boil-render records the manifests this needs
+if [ "$1" = "update" ]; then
+  shift
+  JOBS=1
+  LINK_FLAG=""
+  while getopts "j:H" opt; do
+    case $opt in
+      j) JOBS="$OPTARG" ;;
+      H) LINK_FLAG="-H" ;;
+      *) usage ;;
+    esac
+  done
+  shift $((OPTIND - 1))
+  if [ ! -x "$RENDERER" ]; then
+    echo "Error: 'boil update' needs 'boil-render'; run install_boil.sh with a C compiler available."
+    exit 1
+  fi
+  if [ $# -eq 0 ]; then
+    set -- .
+  fi
+  exec "$RENDERER" -j "$JOBS" $LINK_FLAG -u "$@"
+fi
+
+# Parse options
+JOBS=1
+LINK_FLAG=""
+COUNT=0
+COUNT_GIVEN=0
+NAMES_FILE=""
+while getopts "j:Hn:f:" opt; do
+  case $opt in
+    j) JOBS="$OPTARG" ;;
+    H) LINK_FLAG="-H" ;;
+    n) COUNT="$OPTARG"; COUNT_GIVEN=1 ;;
+    f) NAMES_FILE="$OPTARG" ;;
+    *) usage ;;
+  esac
+done
+shift $((OPTIND - 1))
+
 # Check arguments
 if [ $# -lt 1 ]; then
   usage
 fi
 
 TEMPLATE_NAME="$1"
-PROJECT_NAME="$2"
+shift
+PROJECT_NAMES=("$@")
 
-# Generate project name if not provided
-if [ -z "$PROJECT_NAME" ]; then
-  PROJECT_NAME=$(generate_project_name)
+# Read additional project names from a file, skipping blank lines
+if [ -n "$NAMES_FILE" ]; then
+  if [ ! -r "$NAMES_FILE" ]; then
+    echo "Error: Cannot read names file '$NAMES_FILE'."
+    exit 1
+  fi
+  while read -r name; do
+    if [ -n "$name" ]; then
+      PROJECT_NAMES+=("$name")
+    fi
+  done < "$NAMES_FILE"
 fi
 
-# Validate project name (allowing alphanumeric, underscores, and hyphens)
-if [[ ! "$PROJECT_NAME" =~ ^[a-zA-Z0-9_-]+$ ]]; then
-  echo "Error: Invalid project name. Use only letters, numbers, underscores, and hyphens."
+# Same limits as boil-render's gen_parse_count; COUNT=0 means no -n
+if [ "$COUNT_GIVEN" -eq 1 ] && { [[ ! "$COUNT" =~ ^[0-9]{1,6}$ ]] || [ "$COUNT" -lt 1 ] || [ "$COUNT" -gt 100000 ]; }; then
+  echo "Error: Invalid project count '$COUNT' (1 to 100000)."
   exit 1
 fi
+if [ "$COUNT" -gt 0 ] && [ ${#PROJECT_NAMES[@]} -gt 0 ]; then
+  echo "Error: -n cannot be combined with project names."
+  exit 1
+fi
+
+# Generate project name if not provided
+if [ "$COUNT" -eq 0 ] && [ ${#PROJECT_NAMES[@]} -eq 0 ]; then
+  PROJECT_NAMES=("$(generate_project_name)")
+fi
+
+# Validate project names (allowing alphanumeric, underscores, and hyphens)
+for PROJECT_NAME in "${PROJECT_NAMES[@]}"; do
+  if [[ ! "$PROJECT_NAME" =~ ^[a-zA-Z0-9_-]+$ ]]; then
+    echo "Error: Invalid project name '$PROJECT_NAME'. Use only letters, numbers, underscores, and hyphens."
+    exit 1
+  fi
+done
 
 # Check if template exists
 if [ ! -d "$TEMPLATE_DIR/$TEMPLATE_NAME" ]; then
@@ -47,29 +156,40 @@ if [ ! -d "$TEMPLATE_DIR/$TEMPLATE_NAME" ]; then
   exit 1
 fi
 
-# Create project directory
-if ! mkdir -p "$PROJECT_NAME"; then
-  echo "Error: Failed to create project directory '$PROJECT_NAME'."
-  exit 1
+# Render with the native renderer when it is installed; it loads the
+# template once however many projects are generated, and hands the work
+# to boild, which keeps templates loaded between runs, if it is running
+if [ -x "$RENDERER" ]; then
+  if [ "$COUNT" -gt 0 ]; then
+    RENDER_ARGS=(-n "$COUNT" "$TEMPLATE_DIR/$TEMPLATE_NAME")
+  else
+    RENDER_ARGS=("$TEMPLATE_DIR/$TEMPLATE_NAME" "${PROJECT_NAMES[@]}")
+  fi
+  STATUS=0
+  CREATED=$("$RENDERER" -v -j "$JOBS" $LINK_FLAG "${RENDER_ARGS[@]}") || STATUS=$?
+  for PROJECT_NAME in $CREATED; do
+    echo "Project '$PROJECT_NAME' created using template '$TEMPLATE_NAME'."
+  done
+  if [ "$STATUS" -ne 0 ]; then
+    echo "Error: Failed to render template files."
+    exit 1
+  fi
+  exit 0
 fi
 
-# Copy template files
-if ! cp -r "$TEMPLATE_DIR/$TEMPLATE_NAME/." "$PROJECT_NAME/"; then
-  echo "Error: Failed to copy template files."
-  exit 1
+if [ "$JOBS" != 1 ]; then
+  echo "Warning: 'boil-render' is not installed; ignoring -j $JOBS."
+fi
+if [ -n "$LINK_FLAG" ]; then
+  echo "Warning: 'boil-render' is not installed; ignoring -H."
 fi
 
-# Replace placeholders in files
-PLACEHOLDER="{{PROJECT_NAME}}"
-find "$PROJECT_NAME" -type f | while read -r file; do
-  if grep -q "$PLACEHOLDER" "$file"; then
-    # Determine OS for sed compatibility
-    if [[ "$OSTYPE" == "darwin"* ]]; then
-      sed -i "" "s/$PLACEHOLDER/$PROJECT_NAME/g" "$file"
-    else
-      sed -i "s/$PLACEHOLDER/$PROJECT_NAME/g" "$file"
-    fi
-  fi
-done
-
-echo "Project '$PROJECT_NAME' created using template '$TEMPLATE_NAME'."
\ No newline at end of file
+if [ "$COUNT" -gt 0 ]; then
+  for _ in $(seq "$COUNT"); do
+    generate_with_sed "$(generate_project_name)"
+  done
+else
+  for PROJECT_NAME in "${PROJECT_NAMES[@]}"; do
+    generate_with_sed "$PROJECT_NAME"
+  done
+fi
\ No newline at end of file
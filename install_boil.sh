@@ -71,6 +71,29 @@ if ! $SUDO cp boil.sh "$INSTALL_DIR/boil"; then
   exit 1
 fi
 
+# Build and install the native renderer and its optional daemon; boil
+# falls back to sed without them
+if make -s boil-render boild; then
+  if ! $SUDO cp boil-render "$INSTALL_DIR/boil-render"; then
+    echo "Error: Failed to copy 'boil-render' to '$INSTALL_DIR'."
+    exit 1
+  fi
+  if ! $SUDO cp boild "$INSTALL_DIR/boild"; then
+    echo "Error: Failed to copy 'boild' to '$INSTALL_DIR'."
+    exit 1
+  fi
+
+  # Compile each installed template into a pack so boil does not rescan it
+  for template in templates/*/; do
+    name=$(basename "$template")
+    if ! ./boil-render -c "$TEMPLATE_DIR/$name"; then
+      echo "Warning: Failed to compile template pack for '$name'."
+    fi
+  done
+else
+  echo "Warning: Failed to build 'boil-render'; boil will use the slower sed fallback."
+fi
+
 # Change permissions with sudo if necessary
 if ! $SUDO chmod +x "$INSTALL_DIR/boil"; then
   echo "Error: Failed to make 'boil' executable."
@@ -0,0 +1,625 @@
+/*
+ * boild
+ *
+ * Long-lived daemon that generates projects for boil-render. Loading a
+ * template (scanning it, checking or rebuilding its pack) is the fixed
+ * cost of every boil run; boild pays it once per template and keeps the
+ * loaded template, watching its directories with inotify so that any
+ * change to the template makes the next request load it again.
+ *
+ * boild listens on a Unix socket (see daemon.h) that only its own user
+ * may use, and serves one request at a time with its worker pool. When it
+ * is not running, boil-render simply renders the projects itself.
+ *
+ * Usage: boild [-j jobs] [socket_path]
+ */
+#define _GNU_SOURCE /* accept4, SO_PEERCRED */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "daemon.h"
+#include "generate.h"
+#include "pack.h"
+#include "template.h"
+
+/* Changes to a watched directory that make its template stale */
+#define WATCH_MASK (IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_DELETE_SELF | \
+                    IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO)
+
+/* Seconds a client may take to send its request */
+#define REQUEST_TIMEOUT 5
+
+/*
+ * Structure to Hold One Loaded Template
+ */
+typedef struct
+{
+    char *dir;        /* Real path of the template directory */
+    Template t;       /* Loaded template, valid while loaded is set */
+    int loaded;       /* Set once t holds the template */
+    int stale;        /* Set when the template changed since it was loaded */
+    int *wds;         /* inotify watch of every directory of the template */
+    size_t wd_count;  /* Number of watches */
+    struct stat pack; /* Pack file the template was loaded with, if any */
+    int has_pack;     /* Set if there was a pack file */
+} Cached_;
+
+/*
+ * Structure to Hold the Daemon's State
+ */
+typedef struct
+{
+    Generator g;     /* Workers used for every request */
+    int inotify;     /* inotify instance watching every loaded template */
+    Cached_ *cache;  /* Loaded templates */
+    size_t count;    /* Number of loaded templates */
+} Daemon_;
+
+/*
+ * Structure to Hold a Parsed Request
+ */
+typedef struct
+{
+    const char *cwd;      /* Directory the projects are created in */
+    const char *template; /* Template directory */
+    mode_t mask;          /* Client's umask */
+    int hard_links;       /* Hard-link store objects */
+    char **names;         /* Project names */
+    size_t count;         /* Number of project names */
+} Request_;
+
+static volatile sig_atomic_t quit_;
+
+/*
+ * Function to Stop the Accept Loop on SIGINT or SIGTERM
+ */
+static void on_signal_(int sig)
+{
+    (void)sig;
+    quit_ = 1;
+}
+
+/*
+ * Function to Display Usage
+ */
+static int usage_(void)
+{
+    fprintf(stderr, "Usage: boild [-j jobs] [socket_path]\n");
+    fprintf(stderr, "  -j jobs   Number of parallel workers (0 = one per core, default 1)\n");
+    return 1;
+}
+
+/*
+ * Function to Remove a Template's Watches and Unload It
+ */
+static void unload_(Daemon_ *d, Cached_ *c)
+{
+    size_t i;
+
+    for (i = 0; i < c->wd_count; i++)
+    {
+        inotify_rm_watch(d->inotify, c->wds[i]);
+    }
+    free(c->wds);
+    c->wds = NULL;
+    c->wd_count = 0;
+    if (c->loaded)
+    {
+        template_free(&c->t);
+        c->loaded = 0;
+    }
+}
+
+/*
+ * Function to Watch One Directory of a Template
+ */
+static int watch_(Daemon_ *d, Cached_ *c, const char *path)
+{
+    char full[PATH_MAX];
+    int *grown;
+    int wd;
+
+    if (snprintf(full, sizeof(full), "%s%s%s", c->dir, *path ? "/" : "", path) >= (int)sizeof(full) ||
+        (wd = inotify_add_watch(d->inotify, full, WATCH_MASK | IN_ONLYDIR)) < 0)
+    {
+        return -1;
+    }
+    if ((grown = realloc(c->wds, (c->wd_count + 1) * sizeof(*c->wds))) == NULL)
+    {
+        inotify_rm_watch(d->inotify, wd);
+        return -1;
+    }
+    c->wds = grown;
+    c->wds[c->wd_count++] = wd;
+    return 0;
+}
+
+/*
+ * Function to Check Whether a Template's Pack Was Built or Removed
+ *
+ * The pack lives next to the template directory, outside the watches, so
+ * it is compared with the one the template was loaded with instead. With
+ * record set, the current pack is remembered instead.
+ */
+static int pack_changed_(Cached_ *c, int record)
+{
+    char path[PATH_MAX];
+    struct stat st;
+    int has_pack = pack_path(c->dir, path, sizeof(path)) == 0 && stat(path, &st) == 0;
+
+    if (record)
+    {
+        c->has_pack = has_pack;
+        if (has_pack)
+        {
+            c->pack = st;
+        }
+        return 0;
+    }
+    return has_pack != c->has_pack ||
+           (has_pack && (st.st_dev != c->pack.st_dev || st.st_ino != c->pack.st_ino ||
+                         st.st_mtim.tv_sec != c->pack.st_mtim.tv_sec || st.st_mtim.tv_nsec != c->pack.st_mtim.tv_nsec));
+}
+
+/*
+ * Function to Load a Template and Watch Its Directories
+ *
+ * The root is watched before the template is read, so a change made while
+ * it loads still marks it stale. A template that cannot be watched (for
+ * example past the inotify watch limit) is loaded but marked stale, so it
+ * is read again for every request rather than served out of date.
+ */
+static int load_(Daemon_ *d, Cached_ *c)
+{
+    size_t i;
+    int watched;
+
+    unload_(d, c);
+    c->stale = 0;
+    watched = watch_(d, c, "") == 0;
+    if (pack_open_template(&c->t, c->dir) != 0)
+    {
+        unload_(d, c);
+        return -1;
+    }
+    c->loaded = 1;
+    pack_changed_(c, 1);
+    if (!c->t.map && pack_memory(&c->t) != 0)
+    {
+        fprintf(stderr, "Warning: Failed to load '%s' into memory; rendering from files.\n", c->dir);
+    }
+    for (i = 0; watched && i < c->t.count; i++)
+    {
+        if (c->t.entries[i].type == ENTRY_DIR)
+        {
+            watched = watch_(d, c, c->t.entries[i].path) == 0;
+        }
+    }
+    if (!watched)
+    {
+        c->stale = 1;
+    }
+    return 0;
+}
+
+/*
+ * Function to Mark the Templates Whose Directories Changed as Stale
+ */
+static void drain_events_(Daemon_ *d)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    size_t i;
+    size_t k;
+
+    while ((n = read(d->inotify, buf, sizeof(buf))) > 0)
+    {
+        const char *p = buf;
+        while (p < buf + n)
+        {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            for (i = 0; i < d->count; i++)
+            {
+                Cached_ *c = &d->cache[i];
+                for (k = 0; k < c->wd_count && !c->stale; k++)
+                {
+                    c->stale = (ev->mask & IN_Q_OVERFLOW) || ev->wd == c->wds[k];
+                }
+            }
+            p += sizeof(*ev) + ev->len;
+        }
+    }
+}
+
+/*
+ * Function to Get a Template, Loading It if Needed
+ *
+ * Returns NULL after reporting why the template could not be loaded.
+ */
+static const Template *template_for_(Daemon_ *d, const char *dir)
+{
+    Cached_ *c = NULL;
+    Cached_ *grown;
+    size_t i;
+
+    drain_events_(d);
+    for (i = 0; i < d->count && !c; i++)
+    {
+        if (strcmp(d->cache[i].dir, dir) == 0)
+        {
+            c = &d->cache[i];
+        }
+    }
+    if (!c)
+    {
+        if ((grown = realloc(d->cache, (d->count + 1) * sizeof(*d->cache))) == NULL)
+        {
+            fprintf(stderr, "Error: Out of memory.\n");
+            return NULL;
+        }
+        d->cache = grown;
+        c = &d->cache[d->count];
+        memset(c, 0, sizeof(*c));
+        if ((c->dir = strdup(dir)) == NULL)
+        {
+            fprintf(stderr, "Error: Out of memory.\n");
+            return NULL;
+        }
+        d->count++;
+    }
+    if ((!c->loaded || c->stale || pack_changed_(c, 0)) && load_(d, c) != 0)
+    {
+        fprintf(stderr, "Error: Failed to load template '%s'.\n", dir);
+        return NULL;
+    }
+    return &c->t;
+}
+
+/*
+ * Function to Read a Whole Request
+ *
+ * Reads until the "end" line. Returns the NUL-terminated request, or NULL
+ * if the client sent too much, too slowly, or hung up; *too_large is set
+ * when the request did not fit in DAEMON_MAX_REQUEST bytes.
+ */
+static char *read_request_(int fd, int *too_large)
+{
+    char *text = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    ssize_t n;
+
+    *too_large = 0;
+    for (;;)
+    {
+        if (len + 1 == cap || cap == 0)
+        {
+            char *grown;
+            if (cap > DAEMON_MAX_REQUEST)
+            {
+                *too_large = 1;
+                break;
+            }
+            cap = cap ? cap * 2 : 8192;
+            cap = cap < DAEMON_MAX_REQUEST + 1 ? cap : DAEMON_MAX_REQUEST + 1;
+            if ((grown = realloc(text, cap)) == NULL)
+            {
+                break;
+            }
+            text = grown;
+        }
+        if ((n = read(fd, text + len, cap - len - 1)) <= 0)
+        {
+            break;
+        }
+        len += (size_t)n;
+        text[len] = '\0';
+        if (len >= 5 && strcmp(text + len - 5, "\nend\n") == 0)
+        {
+            return text;
+        }
+    }
+    free(text);
+    return NULL;
+}
+
+/*
+ * Function to Parse a Request
+ *
+ * The lines are split in place, so the request borrows text.
+ */
+static int parse_request_(char *text, Request_ *r)
+{
+    char *line;
+    char *next;
+    char **grown;
+
+    memset(r, 0, sizeof(*r));
+    r->mask = 022;
+    for (line = text; line && *line; line = next)
+    {
+        if ((next = strchr(line, '\n')) != NULL)
+        {
+            *next++ = '\0';
+        }
+        if (line == text && strcmp(line, DAEMON_MAGIC) != 0)
+        {
+            return -1;
+        }
+        if (strncmp(line, "cwd ", 4) == 0)
+        {
+            r->cwd = line + 4;
+        }
+        else if (strncmp(line, "template ", 9) == 0)
+        {
+            r->template = line + 9;
+        }
+        else if (strncmp(line, "umask ", 6) == 0)
+        {
+            r->mask = (mode_t)strtoul(line + 6, NULL, 8) & 0777;
+        }
+        else if (strncmp(line, "links ", 6) == 0)
+        {
+            r->hard_links = strcmp(line + 6, "1") == 0;
+        }
+        else if (strncmp(line, "name ", 5) == 0)
+        {
+            if (!gen_name_is_valid(line + 5) ||
+                (grown = realloc(r->names, (r->count + 1) * sizeof(*r->names))) == NULL)
+            {
+                return -1;
+            }
+            r->names = grown;
+            r->names[r->count++] = line + 5;
+        }
+    }
+    return r->cwd && r->cwd[0] == '/' && r->template && r->template[0] == '/' ? 0 : -1;
+}
+
+/*
+ * Function to Generate the Projects of a Request
+ *
+ * Like boil-render, stops at the first project that fails.
+ */
+static int generate_(Daemon_ *d, int conn, const Request_ *r)
+{
+    char project[PATH_MAX];
+    const Template *t = template_for_(d, r->template);
+    mode_t mask;
+    size_t i;
+    int rv = 0;
+
+    if (!t)
+    {
+        return -1;
+    }
+    d->g.hard_links = r->hard_links;
+    gen_use_store(&d->g, t);
+    mask = umask(r->mask);
+    for (i = 0; rv == 0 && i < r->count; i++)
+    {
+        if (snprintf(project, sizeof(project), "%s/%s", r->cwd, r->names[i]) >= (int)sizeof(project))
+        {
+            fprintf(stderr, "Error: Path too long.\n");
+            rv = -1;
+        }
+        else if ((rv = gen_project(&d->g, t, project, r->names[i])) == 0)
+        {
+            dprintf(conn, "+%s\n", r->names[i]);
+        }
+    }
+    umask(mask);
+    return rv;
+}
+
+/*
+ * Function to Serve One Connection
+ *
+ * Only the daemon's own user is served. While the request runs, standard
+ * error is the connection, so every message the generator prints reaches
+ * the client.
+ */
+static void serve_(Daemon_ *d, int conn)
+{
+    struct timeval timeout = {REQUEST_TIMEOUT, 0};
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    Request_ r;
+    char *text;
+    int too_large;
+    int saved;
+    int rv;
+
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.uid != geteuid())
+    {
+        return;
+    }
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if ((text = read_request_(conn, &too_large)) == NULL)
+    {
+        if (too_large)
+        {
+            dprintf(conn, "Error: boild takes requests of up to %u bytes.\n=1\n", DAEMON_MAX_REQUEST);
+        }
+        return;
+    }
+    fflush(stderr);
+    saved = dup(STDERR_FILENO);
+    dup2(conn, STDERR_FILENO);
+    if (parse_request_(text, &r) != 0)
+    {
+        fprintf(stderr, "Error: boild could not understand the request.\n");
+        rv = -1;
+    }
+    else
+    {
+        rv = generate_(d, conn, &r);
+    }
+    dprintf(conn, "=%d\n", rv == 0 ? 0 : 1);
+    fflush(stderr);
+    if (saved >= 0)
+    {
+        dup2(saved, STDERR_FILENO);
+        close(saved);
+    }
+    free(r.names);
+    free(text);
+}
+
+/*
+ * Function to Listen on the Daemon's Socket
+ *
+ * A socket nobody answers on is left over from a daemon that did not exit
+ * cleanly and is replaced. The socket is created accessible to its owner
+ * only.
+ */
+static int listen_(const char *path)
+{
+    struct sockaddr_un addr;
+    mode_t mask;
+    int fd;
+    int rv;
+
+    if ((fd = daemon_connect(path)) >= 0)
+    {
+        close(fd);
+        fprintf(stderr, "Error: boild is already running on '%s'.\n", path);
+        return -1;
+    }
+    unlink(path);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+    if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+    {
+        fprintf(stderr, "Error: Failed to create socket: %s\n", strerror(errno));
+        return -1;
+    }
+    mask = umask(0177);
+    rv = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+    if (rv != 0 || listen(fd, 64) != 0)
+    {
+        fprintf(stderr, "Error: Failed to listen on '%s': %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[])
+{
+    char path[PATH_MAX];
+    struct sigaction sa;
+    struct pollfd fds[2];
+    Daemon_ d;
+    unsigned jobs = 1;
+    size_t i;
+    int listener;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'j':
+            if (gen_parse_jobs(optarg, &jobs) != 0)
+            {
+                fprintf(stderr, "Error: Invalid job count '%s'.\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            return usage_();
+        }
+    }
+    if (argc - optind > 1)
+    {
+        return usage_();
+    }
+    if (argc - optind == 1 ? snprintf(path, sizeof(path), "%s", argv[optind]) >= (int)sizeof(path) ||
+                                 strlen(path) >= sizeof(((struct sockaddr_un *)0)->sun_path)
+                           : daemon_socket_path(path, sizeof(path)) != 0 || !*path)
+    {
+        fprintf(stderr, "Error: No usable socket path; pass one or set BOIL_SOCKET.\n");
+        return 1;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal_;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&d, 0, sizeof(d));
+    if ((d.inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0)
+    {
+        fprintf(stderr, "Error: Failed to start inotify: %s\n", strerror(errno));
+        return 1;
+    }
+    if (gen_init(&d.g, jobs) != 0)
+    {
+        fprintf(stderr, "Error: Failed to start %u workers.\n", jobs);
+        close(d.inotify);
+        return 1;
+    }
+    if ((listener = listen_(path)) < 0)
+    {
+        gen_free(&d.g);
+        close(d.inotify);
+        return 1;
+    }
+
+    fds[0].fd = listener;
+    fds[0].events = POLLIN;
+    fds[1].fd = d.inotify;
+    fds[1].events = POLLIN;
+    while (!quit_)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "Error: poll failed: %s\n", strerror(errno));
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            drain_events_(&d);
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            int conn = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+            if (conn >= 0)
+            {
+                serve_(&d, conn);
+                close(conn);
+            }
+        }
+    }
+
+    close(listener);
+    unlink(path);
+    for (i = 0; i < d.count; i++)
+    {
+        unload_(&d, &d.cache[i]);
+        free(d.cache[i].dir);
+    }
+    free(d.cache);
+    gen_free(&d.g);
+    close(d.inotify);
+    return 0;
+}
@@ -0,0 +1,187 @@
+#define _GNU_SOURCE /* open_memstream */
+#include "daemon.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * Function to Find the Daemon's Socket
+ *
+ * $BOIL_SOCKET if set (an empty value disables the daemon), else
+ * boild.sock in $XDG_RUNTIME_DIR, else in ~/.boil. Returns -1 when there
+ * is no usable path.
+ */
+int daemon_socket_path(char *out, size_t size)
+{
+    const char *env = getenv("BOIL_SOCKET");
+    int n;
+
+    if (env)
+    {
+        n = snprintf(out, size, "%s", env);
+    }
+    else if ((env = getenv("XDG_RUNTIME_DIR")) != NULL && *env)
+    {
+        n = snprintf(out, size, "%s/%s", env, DAEMON_SOCKET);
+    }
+    else if ((env = getenv("HOME")) != NULL && *env)
+    {
+        n = snprintf(out, size, "%s/.boil/%s", env, DAEMON_SOCKET);
+    }
+    else
+    {
+        return -1;
+    }
+    return n > 0 && (size_t)n < size && (size_t)n < sizeof(((struct sockaddr_un *)0)->sun_path) ? 0 : -1;
+}
+
+/*
+ * Function to Connect to the Daemon's Socket
+ *
+ * Returns the connected socket, or -1 when no daemon is listening.
+ */
+int daemon_connect(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path) ||
+        (fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+    {
+        return -1;
+    }
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * Function to Send a Whole Buffer to the Daemon
+ *
+ * MSG_NOSIGNAL turns a daemon that hung up into an EPIPE error rather than
+ * a SIGPIPE that would kill the client.
+ */
+static int send_all_(int fd, const char *p, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+/*
+ * Function to Write a Generate Request
+ *
+ * Returns -1 without sending anything if the request is larger than the
+ * daemon accepts (DAEMON_MAX_REQUEST).
+ */
+static int send_request_(int fd, const char *cwd, const char *template_dir, char *const names[], size_t count, int hard_links)
+{
+    char *text = NULL;
+    size_t len = 0;
+    FILE *f = open_memstream(&text, &len);
+    mode_t mask = umask(0);
+    size_t i;
+    int rv;
+
+    umask(mask);
+    if (!f)
+    {
+        return -1;
+    }
+    fprintf(f, "%s\ncwd %s\ntemplate %s\numask %o\nlinks %d\n", DAEMON_MAGIC, cwd, template_dir, (unsigned)mask, hard_links ? 1 : 0);
+    for (i = 0; i < count; i++)
+    {
+        fprintf(f, "name %s\n", names[i]);
+    }
+    fprintf(f, "end\n");
+    rv = fclose(f) == 0 && len <= DAEMON_MAX_REQUEST ? send_all_(fd, text, len) : -1;
+    free(text);
+    return rv;
+}
+
+/*
+ * Function to Generate Projects Through the Daemon
+ *
+ * Sends the request and relays the reply: created projects are printed if
+ * verbose is set, messages go to standard error. Returns 0 on success, -1
+ * if the daemon reported a failure, and 1 when no daemon is running, it
+ * cannot take the request, or it hung up without a status, so the caller
+ * renders the projects itself.
+ */
+int daemon_generate(const char *template_dir, char *const names[], size_t count, int hard_links, int verbose)
+{
+    char socket_path[PATH_MAX];
+    char template_path[PATH_MAX];
+    char cwd[PATH_MAX];
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    FILE *reply;
+    int status = -1;
+    int fd;
+
+    if (daemon_socket_path(socket_path, sizeof(socket_path)) != 0 ||
+        !realpath(template_dir, template_path) || !getcwd(cwd, sizeof(cwd)) ||
+        strchr(cwd, '\n') || strchr(template_path, '\n') ||
+        (fd = daemon_connect(socket_path)) < 0)
+    {
+        return 1;
+    }
+    if (send_request_(fd, cwd, template_path, names, count, hard_links) != 0 ||
+        shutdown(fd, SHUT_WR) != 0 || (reply = fdopen(fd, "r")) == NULL)
+    {
+        close(fd);
+        return 1;
+    }
+    while (status < 0 && (n = getline(&line, &cap, reply)) > 0)
+    {
+        if (line[0] == '+')
+        {
+            if (verbose)
+            {
+                fputs(line + 1, stdout);
+            }
+        }
+        else if (line[0] == '=')
+        {
+            status = atoi(line + 1);
+        }
+        else
+        {
+            fputs(line, stderr);
+        }
+    }
+    if (status < 0)
+    {
+        fprintf(stderr, "Warning: boild closed the connection before finishing; rendering locally.\n");
+    }
+    free(line);
+    fclose(reply);
+    return status < 0 ? 1 : status == 0 ? 0 : -1;
+}
@@ -0,0 +1,36 @@
+#ifndef BOIL_DAEMON_H
+#define BOIL_DAEMON_H
+
+#include <stddef.h>
+
+/*
+ * boild Protocol
+ *
+ * boild keeps templates loaded between runs and generates projects on
+ * behalf of boil-render. A client connects to its Unix socket, sends one
+ * request as text lines and reads the reply until the daemon closes the
+ * connection:
+ *
+ *   boild 1
+ *   cwd <absolute directory the projects are created in>
+ *   template <absolute template directory>
+ *   umask <octal umask of the client>
+ *   links <1 to hard-link store objects (-H), else 0>
+ *   name <project name>          (once per project)
+ *   end
+ *
+ * Reply lines starting with '+' name a project that was created, and the
+ * last line, "=0" or "=1", is the exit status. Every other line is a
+ * message for the client's standard error.
+ */
+#define DAEMON_MAGIC "boild 1"
+#define DAEMON_SOCKET "boild.sock"
+/* Largest request boild reads: room for GEN_MAX_PROJECTS names of up to
+   NAME_MAX bytes. Larger requests are refused and rendered locally */
+#define DAEMON_MAX_REQUEST (32U * 1024U * 1024U)
+
+int daemon_socket_path(char *out, size_t size);
+int daemon_connect(const char *path);
+int daemon_generate(const char *template_dir, char *const names[], size_t count, int hard_links, int verbose);
+
+#endif /* BOIL_DAEMON_H */
@@ -0,0 +1,441 @@
+#define _GNU_SOURCE /* mkdtemp, nftw, realpath */
+#include "generate.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "manifest.h"
+#include "store.h"
+
+/*
+ * Structure to Hold One Generation Run
+ *
+ * order lists entry indices phase by phase: directories grouped by depth so
+ * parents exist before their children, then every file and link.
+ */
+typedef struct
+{
+    Generator *g;        /* Generator running the job */
+    const Template *t;   /* Template being rendered */
+    const size_t *phase; /* Entry indices of the phase being run */
+    int src_root;        /* Template root directory */
+    int dst_root;        /* Project (or staging) root directory */
+    ManifestEntry *rec;  /* Manifest entry of every template entry */
+    atomic_int failed;   /* Set by the first entry that fails */
+} Job_;
+
+/*
+ * Function to Render One Entry of the Current Phase
+ *
+ * Once any entry has failed the remaining ones are skipped, since the
+ * whole project is going to be discarded anyway.
+ */
+static void run_entry_(void *arg, size_t i, unsigned worker)
+{
+    Job_ *job = (Job_ *)arg;
+    RenderCtx *rc = &job->g->rcs[worker];
+    const TemplateEntry *e = &job->t->entries[job->phase[i]];
+    ManifestEntry *rec = &job->rec[job->phase[i]];
+
+    if (atomic_load_explicit(&job->failed, memory_order_relaxed))
+    {
+        return;
+    }
+    if (render_entry(rc, e, job->src_root, job->dst_root) != 0)
+    {
+        atomic_store(&job->failed, 1);
+        return;
+    }
+    rec->path = e->path;
+    rec->type = e->type;
+    rec->mode = e->mode;
+    rec->src = rc->src_hash;
+    rec->out = rc->out_hash;
+}
+
+/*
+ * Function to Remove a Single Path During Tree Removal
+ */
+static int remove_one_(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+/*
+ * Function to Remove a Directory Tree
+ */
+static void remove_tree_(const char *path)
+{
+    nftw(path, remove_one_, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/*
+ * Function to Check Whether a Directory Has Any Entries
+ */
+static int dir_is_empty_(const char *path)
+{
+    DIR *d = opendir(path);
+    struct dirent *e;
+    int empty = 1;
+
+    if (!d)
+    {
+        return 0;
+    }
+    while (empty && (e = readdir(d)) != NULL)
+    {
+        empty = strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0;
+    }
+    closedir(d);
+    return empty;
+}
+
+/*
+ * Function to Parse a Job Count
+ */
+int gen_parse_jobs(const char *s, unsigned *jobs)
+{
+    char *end;
+    long n = strtol(s, &end, 10);
+
+    if (*s == '\0' || *end != '\0' || n < 0 || n > 1024)
+    {
+        return -1;
+    }
+    if (n == 0)
+    {
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    *jobs = n > 0 ? (unsigned)n : 1U;
+    return 0;
+}
+
+/*
+ * Function to Parse a Project Count
+ *
+ * Accepts 1 to GEN_MAX_PROJECTS, with nothing after the number.
+ */
+int gen_parse_count(const char *s, long *count)
+{
+    char *end;
+    long n;
+
+    errno = 0;
+    n = strtol(s, &end, 10);
+    if (*s == '\0' || *end != '\0' || errno != 0 || n <= 0 || n > GEN_MAX_PROJECTS)
+    {
+        return -1;
+    }
+    *count = n;
+    return 0;
+}
+
+/*
+ * Function to Validate a Project Name
+ *
+ * Same rule as boil: letters, numbers, underscores and hyphens only.
+ */
+int gen_name_is_valid(const char *name)
+{
+    const char *p = name;
+
+    if (*p == '\0')
+    {
+        return 0;
+    }
+    for (; *p; p++)
+    {
+        if (!((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') ||
+              (*p >= '0' && *p <= '9') || *p == '_' || *p == '-'))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Function to Start a Generator
+ */
+int gen_init(Generator *g, unsigned jobs)
+{
+    unsigned i;
+
+    g->jobs = jobs ? jobs : 1;
+    g->store_root = -1;
+    g->hard_links = 0;
+    if ((g->rcs = calloc(g->jobs, sizeof(*g->rcs))) == NULL)
+    {
+        return -1;
+    }
+    for (i = 0; i < g->jobs; i++)
+    {
+        if (render_init(&g->rcs[i], "") != 0)
+        {
+            break;
+        }
+    }
+    if (i == g->jobs && pool_init(&g->pool, g->jobs) == 0)
+    {
+        return 0;
+    }
+    while (i-- > 0)
+    {
+        render_free(&g->rcs[i]);
+    }
+    free(g->rcs);
+    g->rcs = NULL;
+    return -1;
+}
+
+/*
+ * Function to Stop a Generator
+ */
+void gen_free(Generator *g)
+{
+    unsigned i;
+
+    pool_free(&g->pool);
+    for (i = 0; i < g->jobs; i++)
+    {
+        render_free(&g->rcs[i]);
+    }
+    free(g->rcs);
+    g->rcs = NULL;
+    if (g->store_root >= 0)
+    {
+        close(g->store_root);
+        g->store_root = -1;
+    }
+}
+
+/*
+ * Function to Link Files From a Template's Object Store
+ *
+ * Files of t that have a store object are linked or cloned from it
+ * instead of being written, as long as the store can be opened. This must
+ * be called again whenever the generator moves on to another template.
+ */
+void gen_use_store(Generator *g, const Template *t)
+{
+    size_t i;
+    unsigned w;
+
+    if (g->store_root >= 0)
+    {
+        close(g->store_root);
+        g->store_root = -1;
+    }
+    for (i = 0; i < t->count && !t->entries[i].object; i++)
+    {
+    }
+    if (i < t->count)
+    {
+        g->store_root = store_open(t->root, 0);
+    }
+    for (w = 0; w < g->jobs; w++)
+    {
+        g->rcs[w].store_root = g->store_root;
+        g->rcs[w].hard_links = g->hard_links;
+    }
+}
+
+/*
+ * Function to Render a Template Into a Root Directory
+ *
+ * Directories are created level by level, then all files and links are
+ * rendered; each phase is spread over the worker pool. The same phases run
+ * with a single worker, so serial and parallel output are identical. The
+ * hashes of every entry are recorded in rec for the project manifest.
+ */
+static int render_all_(Generator *g, const Template *t, int dst_root, ManifestEntry *rec)
+{
+    Job_ job;
+    size_t *order;
+    size_t n = 0;
+    size_t level_start;
+    unsigned depth;
+    unsigned max_depth = 0;
+    size_t i;
+
+    if ((order = malloc((t->count ? t->count : 1) * sizeof(*order))) == NULL)
+    {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    job.g = g;
+    job.t = t;
+    job.dst_root = dst_root;
+    job.rec = rec;
+    atomic_init(&job.failed, 0);
+    job.src_root = open(t->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (job.src_root < 0)
+    {
+        fprintf(stderr, "Error: Failed to open template '%s': %s\n", t->root, strerror(errno));
+        free(order);
+        return -1;
+    }
+    for (i = 0; i < t->count; i++)
+    {
+        if (t->entries[i].type == ENTRY_DIR && t->entries[i].depth > max_depth)
+        {
+            max_depth = t->entries[i].depth;
+        }
+    }
+
+    /* One phase per directory depth */
+    for (depth = 0; depth <= max_depth && !atomic_load(&job.failed); depth++)
+    {
+        level_start = n;
+        for (i = 0; i < t->count; i++)
+        {
+            if (t->entries[i].type == ENTRY_DIR && t->entries[i].depth == depth)
+            {
+                order[n++] = i;
+            }
+        }
+        job.phase = order + level_start;
+        pool_run(&g->pool, n - level_start, run_entry_, &job);
+    }
+
+    /* Then every file and link in one phase */
+    if (!atomic_load(&job.failed))
+    {
+        level_start = n;
+        for (i = 0; i < t->count; i++)
+        {
+            if (t->entries[i].type != ENTRY_DIR)
+            {
+                order[n++] = i;
+            }
+        }
+        job.phase = order + level_start;
+        pool_run(&g->pool, n - level_start, run_entry_, &job);
+    }
+
+    close(job.src_root);
+    free(order);
+    return atomic_load(&job.failed) ? -1 : 0;
+}
+
+/*
+ * Function to Render a Template and Record It in a Manifest
+ */
+static int render_project_(Generator *g, const Template *t, int dst_root, const char *name)
+{
+    char template_dir[PATH_MAX];
+    Manifest m;
+    int rv;
+
+    memset(&m, 0, sizeof(m));
+    if (!realpath(t->root, template_dir) ||
+        (m.entries = calloc(t->count ? t->count : 1, sizeof(*m.entries))) == NULL)
+    {
+        fprintf(stderr, "Error: Failed to resolve template '%s': %s\n", t->root, strerror(errno));
+        return -1;
+    }
+    m.template_dir = template_dir;
+    m.name = name;
+    m.count = t->count;
+    if ((rv = render_all_(g, t, dst_root, m.entries)) == 0 && manifest_write(&m, dst_root) != 0)
+    {
+        fprintf(stderr, "Warning: Failed to write %s; the project cannot be updated: %s\n", MANIFEST_NAME, strerror(errno));
+    }
+    free(m.entries);
+    return rv;
+}
+
+/*
+ * Function to Generate One Project
+ *
+ * A new project is rendered into a hidden staging directory next to
+ * project_dir and renamed into place only once every file has been
+ * written, so a failure never leaves a half-written project behind. If
+ * project_dir already exists and is not empty, the template is merged into
+ * it in place, as cp -r would do. Either way the project gets a manifest
+ * that boil-render -u uses to update it later.
+ */
+int gen_project(Generator *g, const Template *t, const char *project_dir, const char *name)
+{
+    char staging[PATH_MAX];
+    const char *base = strrchr(project_dir, '/');
+    struct stat st;
+    mode_t mask;
+    int in_place = 0;
+    int dst_root;
+    int rv;
+    unsigned i;
+
+    for (i = 0; i < g->jobs; i++)
+    {
+        g->rcs[i].name = name;
+        g->rcs[i].name_len = strlen(name);
+    }
+
+    if (stat(project_dir, &st) == 0)
+    {
+        if (!S_ISDIR(st.st_mode))
+        {
+            fprintf(stderr, "Error: '%s' exists and is not a directory.\n", project_dir);
+            return -1;
+        }
+        in_place = !dir_is_empty_(project_dir);
+    }
+
+    if (in_place)
+    {
+        snprintf(staging, sizeof(staging), "%s", project_dir);
+    }
+    else
+    {
+        base = base ? base + 1 : project_dir;
+        if (snprintf(staging, sizeof(staging), "%.*s.%s.boil-XXXXXX",
+                     (int)(base - project_dir), project_dir, base) >= (int)sizeof(staging) ||
+            mkdtemp(staging) == NULL)
+        {
+            fprintf(stderr, "Error: Failed to create project directory '%s'.\n", project_dir);
+            return -1;
+        }
+        /* mkdtemp creates the directory 0700; give it the mode mkdir would */
+        mask = umask(0);
+        umask(mask);
+        chmod(staging, 0777 & ~mask);
+    }
+
+    dst_root = open(staging, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dst_root < 0)
+    {
+        fprintf(stderr, "Error: Failed to open project directory '%s': %s\n", staging, strerror(errno));
+        rv = -1;
+    }
+    else
+    {
+        rv = render_project_(g, t, dst_root, name);
+        close(dst_root);
+    }
+
+    if (!in_place)
+    {
+        if (rv == 0 && rename(staging, project_dir) != 0)
+        {
+            fprintf(stderr, "Error: Failed to move project into '%s': %s\n", project_dir, strerror(errno));
+            rv = -1;
+        }
+        if (rv != 0)
+        {
+            remove_tree_(staging);
+        }
+    }
+    return rv;
+}
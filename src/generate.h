@@ -0,0 +1,35 @@
+#ifndef BOIL_GENERATE_H
+#define BOIL_GENERATE_H
+
+#include "pool.h"
+#include "render.h"
+#include "template.h"
+
+/* Most projects one run may generate with -n */
+#define GEN_MAX_PROJECTS 100000L
+
+/*
+ * Structure to Hold a Project Generator
+ *
+ * A generator owns the worker pool and one render context per worker, so
+ * it can be reused for any number of projects.
+ */
+typedef struct
+{
+    Pool pool;      /* Workers shared by every generated project */
+    RenderCtx *rcs; /* One render context per worker */
+    unsigned jobs;  /* Number of workers, including the calling thread */
+    int store_root; /* Object store of the current template, or -1 */
+    int hard_links; /* Hard-link store objects instead of cloning them */
+} Generator;
+
+int gen_init(Generator *g, unsigned jobs);
+void gen_free(Generator *g);
+void gen_use_store(Generator *g, const Template *t);
+
+int gen_parse_jobs(const char *s, unsigned *jobs);
+int gen_parse_count(const char *s, long *count);
+int gen_name_is_valid(const char *name);
+int gen_project(Generator *g, const Template *t, const char *project_dir, const char *name);
+
+#endif /* BOIL_GENERATE_H */
@@ -0,0 +1,107 @@
+#ifndef BOIL_HASH_H
+#define BOIL_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Streaming Content Hash
+ *
+ * Hashes file contents for project manifests. Bytes are mixed 8 at a time,
+ * so hashing keeps up with rendering, and may be added in pieces of any
+ * size: the result only depends on the byte sequence. Not cryptographic;
+ * it detects edits, not tampering.
+ */
+#define HASH_MUL 0x9e3779b97f4a7c15ULL
+
+/*
+ * Structure to Hold a Hash in Progress
+ */
+typedef struct
+{
+    uint64_t h;             /* Words mixed so far */
+    uint64_t len;           /* Bytes added so far */
+    unsigned char tail[8];  /* Bytes not yet mixed */
+} Hash;
+
+/*
+ * Function to Mix One Word Into a Hash
+ */
+static inline uint64_t hash_mix_(uint64_t h, uint64_t w)
+{
+    return ((h << 29 | h >> 35) ^ w) * HASH_MUL;
+}
+
+/*
+ * Function to Start a Hash
+ */
+static inline void hash_init(Hash *s)
+{
+    s->h = 0x243f6a8885a308d3ULL;
+    s->len = 0;
+}
+
+/*
+ * Function to Add Bytes to a Hash
+ */
+static inline void hash_add(Hash *s, const void *p, size_t n)
+{
+    const unsigned char *b = (const unsigned char *)p;
+    size_t used = (size_t)(s->len & 7U);
+    uint64_t w;
+
+    s->len += n;
+    if (used)
+    {
+        size_t take = 8 - used < n ? 8 - used : n;
+        memcpy(s->tail + used, b, take);
+        b += take;
+        n -= take;
+        if (used + take < 8)
+        {
+            return;
+        }
+        memcpy(&w, s->tail, 8);
+        s->h = hash_mix_(s->h, w);
+    }
+    for (; n >= 8; b += 8, n -= 8)
+    {
+        memcpy(&w, b, 8);
+        s->h = hash_mix_(s->h, w);
+    }
+    memcpy(s->tail, b, n);
+}
+
+/*
+ * Function to Finish a Hash
+ *
+ * The tail is padded with zeros and the length mixed in, then the bits
+ * are spread over the whole result.
+ */
+static inline uint64_t hash_final(const Hash *s)
+{
+    uint64_t h = s->h;
+    uint64_t w = 0;
+
+    memcpy(&w, s->tail, (size_t)(s->len & 7U));
+    h = hash_mix_(hash_mix_(h, w), s->len);
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+/*
+ * Function to Hash a Buffer in One Call
+ */
+static inline uint64_t hash_bytes(const void *p, size_t n)
+{
+    Hash s;
+
+    hash_init(&s);
+    hash_add(&s, p, n);
+    return hash_final(&s);
+}
+
+#endif /* BOIL_HASH_H */
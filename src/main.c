@@ -0,0 +1,381 @@
+/*
+ * boil-render
+ *
+ * Native renderer used by boil to generate a project from a template
+ * directory. Each template file is read once and written to the project
+ * with every {{PROJECT_NAME}} replaced, without spawning any processes.
+ *
+ * If <template_dir>.boilpack exists (see -c), the template is rendered
+ * from that pack instead of the loose files. The pack is rebuilt first if
+ * the template directory changed since it was built.
+ *
+ * Several projects can be generated in one run, either from a list of
+ * names or as -n fresh project_YYYYMMDDN names; the template is then read
+ * once and every project is rendered from memory.
+ *
+ * Every generated project records a manifest of what it was generated
+ * from (see manifest.h). -u brings existing projects up to date with
+ * their template, re-rendering only the files the template changed and
+ * leaving files edited since generation alone.
+ *
+ * Files of a packed template that contain no placeholder are kept once in
+ * an object store (see store.h) and cloned into each project; -H hard-links
+ * them instead, so they share one read-only inode.
+ *
+ * When boild is running (see daemon.h), projects are generated by it, from
+ * a template it already holds in memory; the -j of this run is then
+ * ignored in favour of the daemon's. Set BOIL_SOCKET to an empty value to
+ * always render locally.
+ *
+ * Usage: boil-render [-j jobs] [-H] [-v] <template_dir> <project_name>...
+ *        boil-render [-j jobs] [-H] [-v] -n count <template_dir>
+ *        boil-render [-j jobs] [-H] -u <project_dir>...
+ *        boil-render -c <template_dir> [pack_file]
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "daemon.h"
+#include "generate.h"
+#include "manifest.h"
+#include "pack.h"
+#include "template.h"
+#include "update.h"
+
+/*
+ * Function to Display Usage
+ */
+static int usage_(void)
+{
+    fprintf(stderr, "Usage: boil-render [-j jobs] [-H] [-v] <template_dir> <project_name>...\n");
+    fprintf(stderr, "       boil-render [-j jobs] [-H] [-v] -n count <template_dir>\n");
+    fprintf(stderr, "       boil-render [-j jobs] [-H] -u <project_dir>...\n");
+    fprintf(stderr, "       boil-render -c <template_dir> [pack_file]\n");
+    fprintf(stderr, "  -j jobs   Number of parallel workers (0 = one per core, default 1)\n");
+    fprintf(stderr, "  -n count  Generate count projects with default names\n");
+    fprintf(stderr, "  -H        Hard-link unchanged template files instead of copying them\n");
+    fprintf(stderr, "  -v        Print the name of every generated project\n");
+    fprintf(stderr, "  -u        Update projects with what changed in their template\n");
+    fprintf(stderr, "  -c        Compile the template into a pack (default <template_dir>%s)\n", PACK_SUFFIX);
+    return 1;
+}
+
+/*
+ * Function to Generate the Next Default Project Name
+ *
+ * Mirrors generate_project_name in boil: project_YYYYMMDD followed by the
+ * first counter value, from *count on, that does not name an existing path.
+ */
+static void next_project_name_(char *out, size_t size, unsigned *count)
+{
+    char base[32];
+    struct stat st;
+    time_t now = time(NULL);
+    struct tm tm;
+
+    localtime_r(&now, &tm);
+    strftime(base, sizeof(base), "project_%Y%m%d", &tm);
+    do
+    {
+        snprintf(out, size, "%s%u", base, (*count)++);
+    } while (stat(out, &st) == 0);
+}
+
+/*
+ * Function to Generate Projects Through boild
+ *
+ * Default names are chosen here, relative to the current directory, so
+ * they are the same ones a local run would pick. Returns 1 when no daemon
+ * is running, and daemon_generate's result otherwise.
+ */
+static int generate_with_daemon_(const char *template_dir, char *const names[], long count, int hard_links, int verbose)
+{
+    char (*generated)[64];
+    char **list;
+    unsigned counter = 1;
+    long i;
+    int rv;
+
+    if (names)
+    {
+        return daemon_generate(template_dir, names, (size_t)count, hard_links, verbose);
+    }
+    generated = malloc((size_t)count * sizeof(*generated));
+    list = malloc((size_t)count * sizeof(*list));
+    if (!generated || !list)
+    {
+        free(generated);
+        free(list);
+        return 1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        next_project_name_(generated[i], sizeof(generated[i]), &counter);
+        list[i] = generated[i];
+    }
+    rv = daemon_generate(template_dir, list, (size_t)count, hard_links, verbose);
+    free(generated);
+    free(list);
+    return rv;
+}
+
+/*
+ * Function to Update Projects From Their Templates
+ *
+ * Each project names its template in its manifest. A template is loaded
+ * and hashed once and reused for every following project generated from
+ * it, so updating many projects costs one pass over the template plus the
+ * files that actually changed. A project that fails is reported and the
+ * rest are still updated.
+ */
+static int update_projects_(Generator *g, char *const projects[], int count)
+{
+    Template t;
+    uint64_t *src = NULL;
+    int loaded = 0;
+    int rv = 0;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        UpdateStats stats;
+        Manifest m;
+        int root = open(projects[i], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        int r = root < 0 ? -1 : manifest_read(&m, root);
+
+        if (r != 0)
+        {
+            if (root < 0)
+            {
+                fprintf(stderr, "Error: Failed to open project '%s': %s\n", projects[i], strerror(errno));
+            }
+            else if (r > 0)
+            {
+                fprintf(stderr, "Error: '%s' has no %s; only projects generated by boil-render can be updated.\n", projects[i], MANIFEST_NAME);
+            }
+            else
+            {
+                fprintf(stderr, "Error: Failed to read the manifest of '%s': %s\n", projects[i], strerror(errno));
+            }
+            if (root >= 0)
+            {
+                close(root);
+            }
+            rv = -1;
+            continue;
+        }
+        if (loaded && strcmp(t.root, m.template_dir) != 0)
+        {
+            template_free(&t);
+            free(src);
+            src = NULL;
+            loaded = 0;
+        }
+        if (!loaded)
+        {
+            if (pack_open_template(&t, m.template_dir) == 0)
+            {
+                loaded = 1;
+                /* Every file is read to hash it; keep the contents for rendering */
+                if (!t.map && pack_memory(&t) != 0)
+                {
+                    fprintf(stderr, "Warning: Failed to load '%s' into memory; rendering from files.\n", t.root);
+                }
+                if ((src = malloc((t.count ? t.count : 1) * sizeof(*src))) == NULL ||
+                    update_hash_template(g, &t, src) != 0)
+                {
+                    template_free(&t);
+                    loaded = 0;
+                }
+                else
+                {
+                    gen_use_store(g, &t);
+                }
+            }
+            if (!loaded)
+            {
+                fprintf(stderr, "Error: Failed to load template '%s' of '%s'.\n", m.template_dir, projects[i]);
+                free(src);
+                src = NULL;
+                manifest_free(&m);
+                close(root);
+                rv = -1;
+                continue;
+            }
+        }
+        if (update_project(g, &t, src, projects[i], root, &m, &stats) == 0)
+        {
+            printf("Project '%s' updated: %zu changed, %zu added, %zu removed, %zu conflicts.\n",
+                   projects[i], stats.updated, stats.added, stats.removed, stats.conflicts);
+        }
+        else
+        {
+            rv = -1;
+        }
+        manifest_free(&m);
+        close(root);
+    }
+    if (loaded)
+    {
+        template_free(&t);
+    }
+    free(src);
+    return rv;
+}
+
+int main(int argc, char *argv[])
+{
+    Template t;
+    Generator g;
+    char pack[PATH_MAX];
+    char name[64];
+    unsigned jobs = 1;
+    unsigned counter = 1;
+    long count = 0;
+    long i;
+    int compile = 0;
+    int hard_links = 0;
+    int update = 0;
+    int verbose = 0;
+    int opt;
+    int rv = 0;
+
+    while ((opt = getopt(argc, argv, "cHj:n:uv")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            compile = 1;
+            break;
+        case 'H':
+            hard_links = 1;
+            break;
+        case 'j':
+            if (gen_parse_jobs(optarg, &jobs) != 0)
+            {
+                fprintf(stderr, "Error: Invalid job count '%s'.\n", optarg);
+                return 1;
+            }
+            break;
+        case 'n':
+            if (gen_parse_count(optarg, &count) != 0)
+            {
+                fprintf(stderr, "Error: Invalid project count '%s' (1 to %ld).\n", optarg, GEN_MAX_PROJECTS);
+                return 1;
+            }
+            break;
+        case 'u':
+            update = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            return usage_();
+        }
+    }
+    if (compile)
+    {
+        if (argc - optind < 1 || argc - optind > 2)
+        {
+            return usage_();
+        }
+        if (argc - optind == 2)
+        {
+            snprintf(pack, sizeof(pack), "%s", argv[optind + 1]);
+        }
+        else if (pack_path(argv[optind], pack, sizeof(pack)) != 0)
+        {
+            fprintf(stderr, "Error: Path too long.\n");
+            return 1;
+        }
+        if (template_scan(&t, argv[optind]) != 0)
+        {
+            return 1;
+        }
+        rv = pack_build(&t, pack);
+        template_free(&t);
+        return rv == 0 ? 0 : 1;
+    }
+    if (update)
+    {
+        if (argc - optind < 1 || count)
+        {
+            return usage_();
+        }
+        if (gen_init(&g, jobs) != 0)
+        {
+            fprintf(stderr, "Error: Failed to start %u workers.\n", jobs);
+            return 1;
+        }
+        g.hard_links = hard_links;
+        rv = update_projects_(&g, argv + optind, argc - optind);
+        gen_free(&g);
+        return rv == 0 ? 0 : 1;
+    }
+    if (count ? argc - optind != 1 : argc - optind < 2)
+    {
+        return usage_();
+    }
+    for (i = optind + 1; i < argc; i++)
+    {
+        if (!gen_name_is_valid(argv[i]))
+        {
+            fprintf(stderr, "Error: Invalid project name '%s'. Use only letters, numbers, underscores, and hyphens.\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!count)
+    {
+        count = argc - optind - 1;
+    }
+
+    /* Let boild generate the projects if it is running */
+    if ((rv = generate_with_daemon_(argv[optind], argc - optind == 1 ? NULL : argv + optind + 1, count, hard_links, verbose)) != 1)
+    {
+        return rv == 0 ? 0 : 1;
+    }
+    rv = 0;
+
+    if (pack_open_template(&t, argv[optind]) != 0)
+    {
+        return 1;
+    }
+    /* Read and scan a loose template once when it is used more than once */
+    if (count > 1 && !t.map && pack_memory(&t) != 0)
+    {
+        fprintf(stderr, "Warning: Failed to load '%s' into memory; rendering from files.\n", argv[optind]);
+    }
+    if (gen_init(&g, jobs) != 0)
+    {
+        fprintf(stderr, "Error: Failed to start %u workers.\n", jobs);
+        template_free(&t);
+        return 1;
+    }
+    g.hard_links = hard_links;
+    gen_use_store(&g, &t);
+    for (i = 0; rv == 0 && i < count; i++)
+    {
+        const char *project = argv[optind + 1 + i];
+        if (argc - optind == 1)
+        {
+            next_project_name_(name, sizeof(name), &counter);
+            project = name;
+        }
+        rv = gen_project(&g, &t, project, project);
+        if (rv == 0 && verbose)
+        {
+            printf("%s\n", project);
+        }
+    }
+    gen_free(&g);
+    template_free(&t);
+    return rv == 0 ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+#include "manifest.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* One-letter names of the entry types, indexed by EntryType */
+static const char type_names_[] = "dfl";
+
+/*
+ * Function to Append an Entry to a Manifest
+ */
+int manifest_add(Manifest *m, const ManifestEntry *e)
+{
+    if (m->count == m->cap)
+    {
+        size_t cap = m->cap ? m->cap * 2 : 64;
+        ManifestEntry *grown = realloc(m->entries, cap * sizeof(*grown));
+        if (!grown)
+        {
+            return -1;
+        }
+        m->entries = grown;
+        m->cap = cap;
+    }
+    m->entries[m->count++] = *e;
+    return 0;
+}
+
+/*
+ * Function to Compare Two Manifest Entries by Path
+ */
+static int compare_entries_(const void *a, const void *b)
+{
+    return strcmp(((const ManifestEntry *)a)->path, ((const ManifestEntry *)b)->path);
+}
+
+/*
+ * Function to Sort a Manifest's Entries by Path
+ */
+void manifest_sort(Manifest *m)
+{
+    if (m->count > 1)
+    {
+        qsort(m->entries, m->count, sizeof(*m->entries), compare_entries_);
+    }
+}
+
+/*
+ * Function to Look Up an Entry in a Sorted Manifest
+ */
+ManifestEntry *manifest_find(const Manifest *m, const char *path)
+{
+    ManifestEntry key;
+
+    if (m->count == 0)
+    {
+        return NULL;
+    }
+    key.path = path;
+    return bsearch(&key, m->entries, m->count, sizeof(*m->entries), compare_entries_);
+}
+
+/*
+ * Function to Split the Next Line off the Manifest Text
+ *
+ * The line is NUL-terminated in place and *p moves past it. Returns NULL
+ * at the end of the text.
+ */
+static char *next_line_(char **p)
+{
+    char *line = *p;
+    char *nl;
+
+    if (*line == '\0')
+    {
+        return NULL;
+    }
+    if ((nl = strchr(line, '\n')) != NULL)
+    {
+        *nl = '\0';
+        *p = nl + 1;
+    }
+    else
+    {
+        *p = line + strlen(line);
+    }
+    return line;
+}
+
+/*
+ * Function to Parse One Entry Line of a Manifest
+ */
+static int parse_entry_(char *line, ManifestEntry *e)
+{
+    const char *type = line[0] ? strchr(type_names_, line[0]) : NULL;
+    unsigned long mode;
+    char *p;
+
+    if (!type || line[1] != ' ')
+    {
+        return -1;
+    }
+    e->type = (EntryType)(type - type_names_);
+    mode = strtoul(line + 2, &p, 8);
+    if (*p != ' ' || mode > 07777)
+    {
+        return -1;
+    }
+    e->mode = (mode_t)mode;
+    e->src = strtoull(p + 1, &p, 16);
+    if (*p != ' ')
+    {
+        return -1;
+    }
+    e->out = strtoull(p + 1, &p, 16);
+    if (*p != ' ' || !template_path_is_safe(p + 1))
+    {
+        return -1;
+    }
+    e->path = p + 1;
+    return 0;
+}
+
+/*
+ * Function to Read a Project's Manifest
+ *
+ * Returns 1 if the project has no manifest, -1 if it cannot be read or is
+ * malformed, and 0 with the entries sorted by path otherwise.
+ */
+int manifest_read(Manifest *m, int project_root)
+{
+    struct stat st;
+    ManifestEntry e;
+    char *p;
+    char *line;
+    size_t have = 0;
+    int fd;
+
+    memset(m, 0, sizeof(*m));
+    if ((fd = openat(project_root, MANIFEST_NAME, O_RDONLY | O_CLOEXEC)) < 0)
+    {
+        return errno == ENOENT ? 1 : -1;
+    }
+    if (fstat(fd, &st) != 0 || (m->text = malloc((size_t)st.st_size + 1)) == NULL)
+    {
+        close(fd);
+        return -1;
+    }
+    while (have < (size_t)st.st_size)
+    {
+        ssize_t r = read(fd, m->text + have, (size_t)st.st_size - have);
+        if (r < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (r <= 0)
+        {
+            break;
+        }
+        have += (size_t)r;
+    }
+    close(fd);
+    m->text[have] = '\0';
+
+    p = m->text;
+    line = next_line_(&p);
+    if (!line || strcmp(line, MANIFEST_MAGIC) != 0 ||
+        !(line = next_line_(&p)) || strncmp(line, "template ", 9) != 0 ||
+        !(m->template_dir = line + 9, line = next_line_(&p)) || strncmp(line, "name ", 5) != 0)
+    {
+        manifest_free(m);
+        return -1;
+    }
+    m->name = line + 5;
+    while ((line = next_line_(&p)) != NULL)
+    {
+        if (parse_entry_(line, &e) != 0 || manifest_add(m, &e) != 0)
+        {
+            manifest_free(m);
+            return -1;
+        }
+    }
+    manifest_sort(m);
+    return 0;
+}
+
+/*
+ * Function to Write a Project's Manifest
+ *
+ * The manifest is written to a temporary file in the project, which is
+ * renamed over the old one when complete. Paths containing a newline
+ * cannot be recorded and make this fail.
+ */
+int manifest_write(const Manifest *m, int project_root)
+{
+    char tmp[32];
+    FILE *out;
+    size_t i;
+    int fd;
+    int rv = 0;
+
+    for (i = 0; i <= m->count; i++)
+    {
+        if (strchr(i < m->count ? m->entries[i].path : m->template_dir, '\n'))
+        {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    for (i = 0;; i++)
+    {
+        snprintf(tmp, sizeof(tmp), "%s.%u", MANIFEST_NAME, (unsigned)i);
+        if ((fd = openat(project_root, tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644)) >= 0)
+        {
+            break;
+        }
+        if (errno != EEXIST || i == 100)
+        {
+            return -1;
+        }
+    }
+    if ((out = fdopen(fd, "w")) == NULL)
+    {
+        close(fd);
+        unlinkat(project_root, tmp, 0);
+        return -1;
+    }
+    fprintf(out, "%s\ntemplate %s\nname %s\n", MANIFEST_MAGIC, m->template_dir, m->name);
+    for (i = 0; i < m->count; i++)
+    {
+        const ManifestEntry *e = &m->entries[i];
+        fprintf(out, "%c %o %016" PRIx64 " %016" PRIx64 " %s\n",
+                type_names_[e->type], (unsigned)e->mode, e->src, e->out, e->path);
+    }
+    if (fclose(out) != 0 || renameat(project_root, tmp, project_root, MANIFEST_NAME) != 0)
+    {
+        unlinkat(project_root, tmp, 0);
+        rv = -1;
+    }
+    return rv;
+}
+
+/*
+ * Function to Release a Manifest
+ */
+void manifest_free(Manifest *m)
+{
+    free(m->entries);
+    free(m->text);
+    memset(m, 0, sizeof(*m));
+}
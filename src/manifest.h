@@ -0,0 +1,62 @@
+#ifndef BOIL_MANIFEST_H
+#define BOIL_MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "template.h"
+
+/*
+ * Project Manifest
+ *
+ * Every generated project holds a manifest at its root recording where it
+ * came from and, for every entry, the hash (see hash.h) of the template
+ * source it was rendered from and of the content written. boil-render -u
+ * compares those against the template and the project to re-render only
+ * what the template changed, and to leave alone anything edited since.
+ *
+ * The manifest is text: a header line, the template directory, the project
+ * name, then one line per entry of the form
+ *
+ *   <f|d|l> <octal mode> <hex source hash> <hex output hash> <path>
+ */
+#define MANIFEST_NAME ".boil-manifest"
+#define MANIFEST_MAGIC "boil-manifest 1"
+
+/*
+ * Structure to Hold One Manifest Entry
+ */
+typedef struct
+{
+    const char *path; /* Relative path, borrowed from the template or the manifest text */
+    EntryType type;   /* Kind of entry */
+    mode_t mode;      /* Permission bits of the template entry */
+    uint64_t src;     /* Source hash, see render_meta_hash */
+    uint64_t out;     /* Hash of the content written to the project */
+} ManifestEntry;
+
+/*
+ * Structure to Hold a Project Manifest
+ *
+ * A manifest read from disk keeps the file's text, and its strings point
+ * into it. Entries are sorted by path after manifest_read or manifest_sort.
+ */
+typedef struct
+{
+    const char *template_dir; /* Absolute path of the template directory */
+    const char *name;         /* Project name the template was rendered with */
+    ManifestEntry *entries;   /* One entry per template entry */
+    size_t count;             /* Number of entries */
+    size_t cap;               /* Allocated capacity of entries */
+    char *text;               /* Manifest file contents, if read from disk */
+} Manifest;
+
+int manifest_add(Manifest *m, const ManifestEntry *e);
+void manifest_sort(Manifest *m);
+ManifestEntry *manifest_find(const Manifest *m, const char *path);
+int manifest_read(Manifest *m, int project_root);
+int manifest_write(const Manifest *m, int project_root);
+void manifest_free(Manifest *m);
+
+#endif /* BOIL_MANIFEST_H */
@@ -0,0 +1,466 @@
+#define _GNU_SOURCE /* memmem */
+#include "pack.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "render.h"
+#include "store.h"
+
+/*
+ * Structure to Hold a Growable Byte Buffer
+ */
+typedef struct
+{
+    char *p;    /* Buffer contents */
+    size_t len; /* Bytes used */
+    size_t cap; /* Bytes allocated */
+} Buf_;
+
+/*
+ * Function to Append Bytes to a Growable Buffer
+ */
+static int buf_add_(Buf_ *b, const void *p, size_t n)
+{
+    if (b->len + n > b->cap)
+    {
+        size_t cap = b->cap ? b->cap : 4096;
+        char *grown;
+        while (cap < b->len + n)
+        {
+            cap *= 2;
+        }
+        if ((grown = realloc(b->p, cap)) == NULL)
+        {
+            return -1;
+        }
+        b->p = grown;
+        b->cap = cap;
+    }
+    memcpy(b->p + b->len, p, n);
+    b->len += n;
+    return 0;
+}
+
+/*
+ * Function to Append One File's Content to a Pack Being Built
+ *
+ * The file is mapped, its placeholders are located once here, and the
+ * content is written to the pack unchanged. A file without placeholders
+ * is also added to the object store, if there is one (store_root >= 0).
+ */
+static int pack_file_(int src_root, const char *path, int out, PackEntry *pe, Buf_ *ph, int store_root)
+{
+    struct stat st;
+    const char *data;
+    const char *p;
+    size_t pos = 0;
+    int fd = openat(src_root, path, O_RDONLY | O_CLOEXEC);
+    int rv = 0;
+
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    pe->size = (uint64_t)st.st_size;
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return -1;
+    }
+    while (rv == 0 && (p = memmem(data + pos, pe->size - pos, BOIL_PLACEHOLDER, BOIL_PLACEHOLDER_LEN)) != NULL)
+    {
+        uint64_t off = (uint64_t)(p - data);
+        rv = buf_add_(ph, &off, sizeof(off));
+        pe->ph_count++;
+        pos = (size_t)off + BOIL_PLACEHOLDER_LEN;
+    }
+    if (rv == 0 && pe->ph_count == 0 && store_root >= 0)
+    {
+        const uint64_t h = hash_bytes(data, (size_t)pe->size);
+        if (h != 0 && store_put(store_root, data, pe->size, h, (mode_t)pe->mode) == 0)
+        {
+            pe->object = h;
+        }
+    }
+    if (rv == 0)
+    {
+        rv = write_all(out, data, pe->size);
+    }
+    munmap((void *)data, (size_t)st.st_size);
+    return rv;
+}
+
+/*
+ * Function to Write a Template Pack to a File Descriptor
+ *
+ * This function reads every file of a scanned template once. Contents are
+ * streamed first; the tables, whose sizes are only known at the end,
+ * follow them, and the header is filled in last. Files are added to the
+ * object store at store_root, or to none when it is -1.
+ */
+static int pack_write_(const Template *t, int out, int store_root)
+{
+    static const char zeros[8] = {0};
+    PackHeader h;
+    PackEntry *pes;
+    Buf_ ph = {0};
+    Buf_ strings = {0};
+    uint64_t off = sizeof(PackHeader);
+    int src_root;
+    int rv;
+    size_t i;
+
+    if ((pes = calloc(t->count ? t->count : 1, sizeof(*pes))) == NULL)
+    {
+        return -1;
+    }
+    src_root = open(t->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (src_root < 0)
+    {
+        fprintf(stderr, "Error: Failed to open template '%s': %s\n", t->root, strerror(errno));
+        free(pes);
+        return -1;
+    }
+    memset(&h, 0, sizeof(h));
+    rv = write_all(out, (const char *)&h, sizeof(h));
+
+    for (i = 0; rv == 0 && i < t->count; i++)
+    {
+        const TemplateEntry *e = &t->entries[i];
+        PackEntry *pe = &pes[i];
+
+        pe->path_off = strings.len;
+        pe->data_off = off;
+        pe->ph_first = ph.len / sizeof(uint64_t);
+        pe->mode = (uint32_t)e->mode;
+        pe->type = (uint16_t)e->type;
+        pe->depth = (uint16_t)e->depth;
+        rv = buf_add_(&strings, e->path, strlen(e->path) + 1);
+
+        if (rv == 0 && e->type == ENTRY_FILE)
+        {
+            rv = pack_file_(src_root, e->path, out, pe, &ph, store_root);
+            off += pe->size;
+        }
+        else if (rv == 0 && e->type == ENTRY_LINK)
+        {
+            char target[PATH_MAX];
+            ssize_t n = readlinkat(src_root, e->path, target, sizeof(target) - 1);
+            if (n < 0)
+            {
+                rv = -1;
+            }
+            else
+            {
+                target[n] = '\0';
+                pe->size = (uint64_t)n;
+                rv = write_all(out, target, (size_t)n + 1);
+                off += pe->size + 1;
+            }
+        }
+        if (rv != 0)
+        {
+            fprintf(stderr, "Error: Failed to pack '%s/%s': %s\n", t->root, e->path, strerror(errno));
+        }
+    }
+
+    if (rv == 0)
+    {
+        memcpy(h.magic, PACK_MAGIC, sizeof(h.magic));
+        h.fingerprint = t->fingerprint;
+        h.entry_count = t->count;
+        h.entries_off = (off + 7U) & ~(uint64_t)7U;
+        h.ph_total = ph.len / sizeof(uint64_t);
+        h.ph_off = h.entries_off + t->count * sizeof(PackEntry);
+        h.strings_off = h.ph_off + ph.len;
+        h.strings_len = strings.len;
+        if (write_all(out, zeros, (size_t)(h.entries_off - off)) != 0 ||
+            write_all(out, (const char *)pes, t->count * sizeof(PackEntry)) != 0 ||
+            write_all(out, ph.p, ph.len) != 0 ||
+            write_all(out, strings.p, strings.len) != 0 ||
+            pwrite(out, &h, sizeof(h), 0) != (ssize_t)sizeof(h))
+        {
+            rv = -1;
+        }
+    }
+    close(src_root);
+    free(pes);
+    free(ph.p);
+    free(strings.p);
+    return rv;
+}
+
+/*
+ * Function to Build a Template Pack
+ *
+ * The pack is written to a temporary file, which is renamed over pack_path
+ * when complete so readers never see a partial pack. Without an object
+ * store the pack is built all the same; its files are then always written.
+ */
+int pack_build(const Template *t, const char *pack_path)
+{
+    char tmp[PATH_MAX];
+    int store_root;
+    int out;
+    int rv;
+
+    if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", pack_path) >= (int)sizeof(tmp) ||
+        (out = mkstemp(tmp)) < 0)
+    {
+        fprintf(stderr, "Error: Failed to build pack '%s': %s\n", pack_path, strerror(errno));
+        return -1;
+    }
+    fchmod(out, 0644);
+    if ((store_root = store_open(t->root, 1)) < 0)
+    {
+        fprintf(stderr, "Warning: Failed to open the object store of '%s': %s\n", t->root, strerror(errno));
+    }
+    rv = pack_write_(t, out, store_root);
+    if (store_root >= 0)
+    {
+        close(store_root);
+    }
+    if (close(out) != 0)
+    {
+        rv = -1;
+    }
+    if (rv == 0 && rename(tmp, pack_path) != 0)
+    {
+        rv = -1;
+    }
+    if (rv != 0)
+    {
+        fprintf(stderr, "Error: Failed to write pack '%s': %s\n", pack_path, strerror(errno));
+        unlink(tmp);
+    }
+    return rv;
+}
+
+/*
+ * Function to Map a Template Pack From a File Descriptor
+ *
+ * If fd holds a valid pack built from the same template state as t
+ * (matching fingerprint), t's entries are replaced by entries that point
+ * straight into the mapped pack and 0 is returned. A stale or malformed
+ * pack returns 1 and leaves t untouched; -1 means out of memory.
+ */
+static int pack_load_fd_(Template *t, int fd)
+{
+    const PackHeader *h;
+    const PackEntry *pes;
+    const uint64_t *ph;
+    const char *strings;
+    TemplateEntry *entries;
+    struct stat st;
+    char *map;
+    size_t len;
+    size_t i;
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PackHeader))
+    {
+        return 1;
+    }
+    len = (size_t)st.st_size;
+    map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        return 1;
+    }
+
+    /* Validate the header and section bounds before trusting any offset */
+    h = (const PackHeader *)map;
+    if (memcmp(h->magic, PACK_MAGIC, sizeof(h->magic)) != 0 ||
+        h->fingerprint != t->fingerprint ||
+        h->entries_off % 8U != 0 || h->entries_off > len ||
+        h->entry_count > (len - h->entries_off) / sizeof(PackEntry) ||
+        h->ph_off != h->entries_off + h->entry_count * sizeof(PackEntry) ||
+        h->ph_total > (len - h->ph_off) / sizeof(uint64_t) ||
+        h->strings_off != h->ph_off + h->ph_total * sizeof(uint64_t) ||
+        h->strings_len != len - h->strings_off)
+    {
+        munmap(map, len);
+        return 1;
+    }
+    pes = (const PackEntry *)(map + h->entries_off);
+    ph = (const uint64_t *)(map + h->ph_off);
+    strings = map + h->strings_off;
+
+    if ((entries = calloc(h->entry_count ? h->entry_count : 1, sizeof(*entries))) == NULL)
+    {
+        munmap(map, len);
+        return -1;
+    }
+    for (i = 0; i < h->entry_count; i++)
+    {
+        const PackEntry *pe = &pes[i];
+        TemplateEntry *e = &entries[i];
+        uint64_t k;
+
+        if (pe->path_off >= h->strings_len ||
+            memchr(strings + pe->path_off, '\0', h->strings_len - pe->path_off) == NULL ||
+            !template_path_is_safe(strings + pe->path_off) ||
+            pe->type > ENTRY_LINK ||
+            pe->data_off < sizeof(PackHeader) || pe->data_off > h->entries_off ||
+            pe->size > h->entries_off - pe->data_off ||
+            (pe->type == ENTRY_LINK && (pe->size == h->entries_off - pe->data_off ||
+                                        map[pe->data_off + pe->size] != '\0')) ||
+            pe->ph_first > h->ph_total || pe->ph_count > h->ph_total - pe->ph_first)
+        {
+            break;
+        }
+        for (k = 0; k < pe->ph_count; k++)
+        {
+            const uint64_t o = ph[pe->ph_first + k];
+            if (o + BOIL_PLACEHOLDER_LEN > pe->size ||
+                (k > 0 && o < ph[pe->ph_first + k - 1] + BOIL_PLACEHOLDER_LEN))
+            {
+                break;
+            }
+        }
+        if (k != pe->ph_count)
+        {
+            break;
+        }
+        e->path = (char *)(strings + pe->path_off);
+        e->mode = (mode_t)pe->mode;
+        e->type = (EntryType)pe->type;
+        e->depth = pe->depth;
+        e->data = map + pe->data_off;
+        e->size = pe->size;
+        e->ph = ph + pe->ph_first;
+        e->ph_count = pe->ph_count;
+        e->object = pe->type == ENTRY_FILE && pe->ph_count == 0 ? pe->object : 0;
+    }
+    if (i != h->entry_count)
+    {
+        free(entries);
+        munmap(map, len);
+        return 1;
+    }
+
+    /* Swap the scanned entries for the pack-backed ones */
+    for (i = 0; i < t->count; i++)
+    {
+        free(t->entries[i].path);
+    }
+    free(t->entries);
+    t->entries = entries;
+    t->count = h->entry_count;
+    t->cap = h->entry_count;
+    t->map = map;
+    t->map_len = len;
+    return 0;
+}
+
+/*
+ * Function to Load a Template Pack
+ *
+ * Same as pack_load_fd_, with a missing pack file reported as stale.
+ */
+int pack_load(Template *t, const char *pack_path)
+{
+    int fd = open(pack_path, O_RDONLY | O_CLOEXEC);
+    int rv;
+
+    if (fd < 0)
+    {
+        return 1;
+    }
+    rv = pack_load_fd_(t, fd);
+    close(fd);
+    return rv;
+}
+
+/*
+ * Function to Pack a Template Into Memory
+ *
+ * This function builds a pack in an anonymous memory file and loads it, so
+ * a template without a pack on disk can still be read and scanned once and
+ * then rendered many times from memory.
+ */
+int pack_memory(Template *t)
+{
+    int fd = memfd_create("boil-template", MFD_CLOEXEC);
+    int rv;
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+    rv = pack_write_(t, fd, -1);
+    if (rv == 0)
+    {
+        rv = pack_load_fd_(t, fd) == 0 ? 0 : -1;
+    }
+    close(fd);
+    return rv;
+}
+
+/*
+ * Function to Derive the Default Pack Path of a Template Directory
+ */
+int pack_path(const char *template_dir, char *out, size_t size)
+{
+    size_t n = strlen(template_dir);
+
+    while (n > 1 && template_dir[n - 1] == '/')
+    {
+        n--;
+    }
+    return snprintf(out, size, "%.*s%s", (int)n, template_dir, PACK_SUFFIX) < (int)size ? 0 : -1;
+}
+
+/*
+ * Function to Load a Template, Preferring Its Pack
+ *
+ * A stale pack is rebuilt from the template directory before use; if that
+ * fails the loose files are rendered instead, so a pack can only make
+ * generation faster, never break it.
+ */
+int pack_open_template(Template *t, const char *template_dir)
+{
+    char pack[PATH_MAX];
+    int rv;
+
+    if (template_scan(t, template_dir) != 0)
+    {
+        return -1;
+    }
+    if (pack_path(template_dir, pack, sizeof(pack)) != 0 || access(pack, F_OK) != 0)
+    {
+        return 0;
+    }
+    if ((rv = pack_load(t, pack)) == 1)
+    {
+        if (pack_build(t, pack) != 0)
+        {
+            fprintf(stderr, "Warning: Template pack '%s' is out of date; rendering from '%s'.\n", pack, template_dir);
+            return 0;
+        }
+        rv = pack_load(t, pack);
+    }
+    if (rv < 0)
+    {
+        template_free(t);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef BOIL_PACK_H
+#define BOIL_PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "template.h"
+
+/*
+ * Template Pack Format
+ *
+ * A pack is one file holding a whole template, laid out so it can be
+ * mapped and used in place:
+ *
+ *   PackHeader
+ *   content of every file and link target, back to back
+ *   PackEntry[entry_count]           (8-byte aligned)
+ *   uint64_t placeholders[ph_total]  (offsets within each file's content)
+ *   path strings, NUL-terminated
+ *
+ * Packs are a local cache built on the machine that uses them, so all
+ * integers are stored in native byte order. Building a pack also adds its
+ * placeholder-free files to the object store (see store.h).
+ */
+#define PACK_MAGIC "BOILPK02"
+#define PACK_SUFFIX ".boilpack"
+
+typedef struct
+{
+    char magic[8];         /* PACK_MAGIC */
+    uint64_t fingerprint;  /* Template fingerprint the pack was built from */
+    uint64_t entry_count;  /* Number of PackEntry records */
+    uint64_t entries_off;  /* File offset of the PackEntry table */
+    uint64_t ph_total;     /* Number of placeholder offsets */
+    uint64_t ph_off;       /* File offset of the placeholder table */
+    uint64_t strings_off;  /* File offset of the path strings */
+    uint64_t strings_len;  /* Size of the path strings in bytes */
+} PackHeader;
+
+typedef struct
+{
+    uint64_t path_off;  /* Offset of the path in the strings section */
+    uint64_t data_off;  /* File offset of the content or link target */
+    uint64_t size;      /* Content size in bytes */
+    uint64_t ph_first;  /* Index of the first placeholder offset */
+    uint64_t ph_count;  /* Number of placeholders in the content */
+    uint64_t object;    /* Content hash of the file's store object, or 0 */
+    uint32_t mode;      /* Permission bits */
+    uint16_t type;      /* EntryType */
+    uint16_t depth;     /* Directory depth */
+} PackEntry;
+
+int pack_build(const Template *t, const char *pack_path);
+int pack_load(Template *t, const char *pack_path);
+int pack_memory(Template *t);
+
+int pack_path(const char *template_dir, char *out, size_t size);
+int pack_open_template(Template *t, const char *template_dir);
+
+#endif /* BOIL_PACK_H */
@@ -0,0 +1,144 @@
+#include "pool.h"
+
+#include <stdlib.h>
+
+/*
+ * Function to Work Through the Current Batch
+ */
+static void drain_(Pool *p, unsigned worker)
+{
+    size_t i;
+
+    while ((i = atomic_fetch_add(&p->next, 1)) < p->count)
+    {
+        p->fn(p->arg, i, worker);
+    }
+}
+
+/*
+ * Worker Thread Entry Point
+ *
+ * Each thread sleeps until a new batch generation is posted, drains it and
+ * reports back, until the pool is shut down.
+ */
+static void *worker_main_(void *arg)
+{
+    const PoolThread *self = (const PoolThread *)arg;
+    Pool *p = self->pool;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;)
+    {
+        while (p->generation == seen && !p->quit)
+        {
+            pthread_cond_wait(&p->start, &p->lock);
+        }
+        if (p->quit)
+        {
+            break;
+        }
+        seen = p->generation;
+        pthread_mutex_unlock(&p->lock);
+
+        drain_(p, self->worker);
+
+        pthread_mutex_lock(&p->lock);
+        if (--p->active == 0)
+        {
+            pthread_cond_signal(&p->done);
+        }
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+/*
+ * Function to Start a Worker Pool
+ */
+int pool_init(Pool *p, unsigned jobs)
+{
+    unsigned i;
+
+    p->nthreads = jobs > 1 ? jobs - 1 : 0;
+    p->threads = NULL;
+    p->generation = 0;
+    p->active = 0;
+    p->quit = 0;
+    p->count = 0;
+    atomic_init(&p->next, 0);
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->start, NULL);
+    pthread_cond_init(&p->done, NULL);
+    if (p->nthreads == 0)
+    {
+        return 0;
+    }
+    if ((p->threads = calloc(p->nthreads, sizeof(*p->threads))) == NULL)
+    {
+        p->nthreads = 0;
+        return -1;
+    }
+    for (i = 0; i < p->nthreads; i++)
+    {
+        p->threads[i].pool = p;
+        p->threads[i].worker = i + 1; /* Worker 0 is the thread calling pool_run */
+        if (pthread_create(&p->threads[i].tid, NULL, worker_main_, &p->threads[i]) != 0)
+        {
+            p->nthreads = i;
+            pool_free(p);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function to Run a Batch of Work on the Pool
+ *
+ * This function calls fn for every index in [0, count) and returns once all
+ * of them have completed. The order in which indices run is unspecified.
+ */
+void pool_run(Pool *p, size_t count, PoolFn fn, void *arg)
+{
+    pthread_mutex_lock(&p->lock);
+    p->fn = fn;
+    p->arg = arg;
+    p->count = count;
+    atomic_store(&p->next, 0);
+    p->active = p->nthreads;
+    p->generation++;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+
+    drain_(p, 0);
+
+    pthread_mutex_lock(&p->lock);
+    while (p->active > 0)
+    {
+        pthread_cond_wait(&p->done, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+/*
+ * Function to Stop a Worker Pool
+ */
+void pool_free(Pool *p)
+{
+    unsigned i;
+
+    pthread_mutex_lock(&p->lock);
+    p->quit = 1;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+    for (i = 0; i < p->nthreads; i++)
+    {
+        pthread_join(p->threads[i].tid, NULL);
+    }
+    free(p->threads);
+    p->threads = NULL;
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->start);
+    pthread_cond_destroy(&p->done);
+}
@@ -0,0 +1,50 @@
+#ifndef BOIL_POOL_H
+#define BOIL_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+/* Work function: called once per index, on the worker numbered worker */
+typedef void (*PoolFn)(void *arg, size_t index, unsigned worker);
+
+struct Pool;
+
+/*
+ * Structure to Hold One Worker Thread
+ */
+typedef struct
+{
+    pthread_t tid;     /* Thread handle */
+    struct Pool *pool; /* Owning pool */
+    unsigned worker;   /* Worker number passed to the work function */
+} PoolThread;
+
+/*
+ * Structure to Hold a Worker Pool
+ *
+ * A pool of jobs workers is jobs - 1 threads plus the thread calling
+ * pool_run, which takes part in the work instead of just waiting. Workers
+ * claim indices from a shared atomic counter, so uneven items balance out.
+ */
+typedef struct Pool
+{
+    PoolThread *threads;    /* Extra worker threads */
+    unsigned nthreads;      /* Number of extra worker threads */
+    pthread_mutex_t lock;   /* Protects the fields below */
+    pthread_cond_t start;   /* Signalled when a new batch is posted */
+    pthread_cond_t done;    /* Signalled when the last worker finishes */
+    unsigned generation;    /* Incremented for every posted batch */
+    unsigned active;        /* Threads still working on the batch */
+    int quit;               /* Set to make the threads exit */
+    PoolFn fn;              /* Work function of the current batch */
+    void *arg;              /* Argument of the current batch */
+    size_t count;           /* Number of indices in the current batch */
+    atomic_size_t next;     /* Next unclaimed index */
+} Pool;
+
+int pool_init(Pool *p, unsigned jobs);
+void pool_run(Pool *p, size_t count, PoolFn fn, void *arg);
+void pool_free(Pool *p);
+
+#endif /* BOIL_POOL_H */
@@ -0,0 +1,360 @@
+#define _GNU_SOURCE /* memmem */
+#include "render.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "store.h"
+
+/*
+ * Function to Write a Whole Buffer to a File Descriptor
+ *
+ * This function retries short writes and interrupted system calls until
+ * every byte has been written or a real error occurs.
+ */
+int write_all(int fd, const char *p, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t w = write(fd, p, n);
+        if (w < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+/*
+ * Function to Flush the Pending Output Buffer
+ */
+static int flush_(RenderCtx *rc, int fd)
+{
+    if (rc->out_len > 0 && write_all(fd, rc->out, rc->out_len) != 0)
+    {
+        return -1;
+    }
+    rc->out_len = 0;
+    return 0;
+}
+
+/*
+ * Function to Queue Bytes for Output
+ *
+ * Small pieces are coalesced in the output buffer; pieces that would not
+ * fit after a flush are written straight through to avoid an extra copy.
+ * Everything queued is folded into the output hash.
+ */
+static int emit_(RenderCtx *rc, int fd, const char *p, size_t n)
+{
+    hash_add(&rc->hash_out, p, n);
+    if (n > RENDER_BUF_SIZE - rc->out_len)
+    {
+        if (flush_(rc, fd) != 0)
+        {
+            return -1;
+        }
+        if (n >= RENDER_BUF_SIZE)
+        {
+            return write_all(fd, p, n);
+        }
+    }
+    memcpy(rc->out + rc->out_len, p, n);
+    rc->out_len += n;
+    return 0;
+}
+
+/*
+ * Function to Create a File Nothing Else Links To
+ *
+ * An existing file is replaced by a new one rather than truncated, since
+ * it may be a hard link to a store object (see store.h) or another file.
+ * This also gives it the requested mode, as for a file that did not exist.
+ */
+int open_fresh(int root, const char *path, mode_t mode)
+{
+    int fd = openat(root, path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+
+    if (fd < 0 && errno == EEXIST && unlinkat(root, path, 0) == 0)
+    {
+        fd = openat(root, path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+    }
+    return fd;
+}
+
+/*
+ * Function to Initialize a Render Context
+ */
+int render_init(RenderCtx *rc, const char *name)
+{
+    rc->name = name;
+    rc->name_len = strlen(name);
+    rc->in = malloc(RENDER_BUF_SIZE);
+    rc->out = malloc(RENDER_BUF_SIZE);
+    rc->out_len = 0;
+    rc->store_root = -1;
+    rc->hard_links = 0;
+    if (!rc->in || !rc->out)
+    {
+        render_free(rc);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Function to Release a Render Context
+ */
+void render_free(RenderCtx *rc)
+{
+    free(rc->in);
+    free(rc->out);
+    rc->in = NULL;
+    rc->out = NULL;
+}
+
+/*
+ * Function to Render One File in a Single Streaming Pass
+ *
+ * This function reads src_fd once, replacing every BOIL_PLACEHOLDER with the
+ * project name as it goes, and writes the result to dst_fd. The last
+ * BOIL_PLACEHOLDER_LEN - 1 bytes of each chunk are carried over to the next
+ * read so a placeholder split across two reads is still found. Replacement
+ * is non-overlapping and left to right, matching sed's s///g.
+ */
+int render_fd(RenderCtx *rc, int src_fd, int dst_fd)
+{
+    const size_t keep = BOIL_PLACEHOLDER_LEN - 1U;
+    size_t have = 0;
+    int eof = 0;
+
+    rc->out_len = 0;
+    hash_init(&rc->hash_in);
+    hash_init(&rc->hash_out);
+    while (!eof)
+    {
+        ssize_t r = read(src_fd, rc->in + have, RENDER_BUF_SIZE - have);
+        size_t pos = 0;
+        size_t tail;
+        const char *m;
+
+        if (r < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        eof = (r == 0);
+        hash_add(&rc->hash_in, rc->in + have, (size_t)r);
+        have += (size_t)r;
+
+        /* Substitute every placeholder that lies fully inside the buffer */
+        while ((m = memmem(rc->in + pos, have - pos, BOIL_PLACEHOLDER, BOIL_PLACEHOLDER_LEN)) != NULL)
+        {
+            const size_t lit = (size_t)(m - (rc->in + pos));
+            if (emit_(rc, dst_fd, rc->in + pos, lit) != 0 ||
+                emit_(rc, dst_fd, rc->name, rc->name_len) != 0)
+            {
+                return -1;
+            }
+            pos += lit + BOIL_PLACEHOLDER_LEN;
+        }
+
+        /* Hold back a possible placeholder prefix unless the input is done */
+        tail = (eof || have - pos <= keep) ? (eof ? have : pos) : have - keep;
+        if (emit_(rc, dst_fd, rc->in + pos, tail - pos) != 0)
+        {
+            return -1;
+        }
+        memmove(rc->in, rc->in + tail, have - tail);
+        have -= tail;
+    }
+    return flush_(rc, dst_fd);
+}
+
+/*
+ * Function to Render Content Held in Memory
+ *
+ * Used for entries loaded from a template pack, whose placeholder offsets
+ * are already known: the output is just the literal ranges between them
+ * with the project name in between, and no byte has to be searched.
+ */
+static int render_mem_(RenderCtx *rc, const TemplateEntry *e, int dst_fd)
+{
+    uint64_t pos = 0;
+    uint64_t k;
+
+    rc->out_len = 0;
+    hash_init(&rc->hash_in);
+    hash_add(&rc->hash_in, e->data, (size_t)e->size);
+    hash_init(&rc->hash_out);
+    for (k = 0; k < e->ph_count; k++)
+    {
+        if (emit_(rc, dst_fd, e->data + pos, (size_t)(e->ph[k] - pos)) != 0 ||
+            emit_(rc, dst_fd, rc->name, rc->name_len) != 0)
+        {
+            return -1;
+        }
+        pos = e->ph[k] + BOIL_PLACEHOLDER_LEN;
+    }
+    if (emit_(rc, dst_fd, e->data + pos, (size_t)(e->size - pos)) != 0)
+    {
+        return -1;
+    }
+    return flush_(rc, dst_fd);
+}
+
+/*
+ * Function to Render a Regular File
+ *
+ * The destination is created with the source permission bits (subject to
+ * the umask), which is what cp -r does for files it creates. A file with a
+ * store object is linked or cloned from the store when possible, which
+ * returns 1 since nothing was read or written.
+ */
+static int render_file_(RenderCtx *rc, const TemplateEntry *e, int src_root, int dst_root)
+{
+    int sfd = -1;
+    int dfd;
+    int rv = -1;
+
+    if (e->object && rc->store_root >= 0 && store_link(rc->store_root, e, dst_root, rc->hard_links) == 0)
+    {
+        return 1;
+    }
+    if (!e->data && (sfd = openat(src_root, e->path, O_RDONLY | O_CLOEXEC)) < 0)
+    {
+        fprintf(stderr, "Error: Failed to read '%s': %s\n", e->path, strerror(errno));
+        return -1;
+    }
+    dfd = open_fresh(dst_root, e->path, e->mode);
+    if (dfd < 0)
+    {
+        fprintf(stderr, "Error: Failed to create '%s': %s\n", e->path, strerror(errno));
+        if (sfd >= 0)
+        {
+            close(sfd);
+        }
+        return -1;
+    }
+    if ((e->data ? render_mem_(rc, e, dfd) : render_fd(rc, sfd, dfd)) == 0)
+    {
+        rv = 0;
+    }
+    else
+    {
+        fprintf(stderr, "Error: Failed to render '%s': %s\n", e->path, strerror(errno));
+    }
+    if (close(dfd) != 0 && rv == 0)
+    {
+        fprintf(stderr, "Error: Failed to write '%s': %s\n", e->path, strerror(errno));
+        rv = -1;
+    }
+    if (sfd >= 0)
+    {
+        close(sfd);
+    }
+    return rv;
+}
+
+/*
+ * Function to Copy a Symbolic Link
+ *
+ * Links are recreated as links, never followed, like cp -r does.
+ */
+static int copy_link_(RenderCtx *rc, const TemplateEntry *e, int src_root, int dst_root)
+{
+    char buf[PATH_MAX];
+    const char *target = e->data;
+
+    if (!target)
+    {
+        ssize_t n = readlinkat(src_root, e->path, buf, sizeof(buf) - 1);
+        if (n < 0)
+        {
+            fprintf(stderr, "Error: Failed to read link '%s': %s\n", e->path, strerror(errno));
+            return -1;
+        }
+        buf[n] = '\0';
+        target = buf;
+    }
+    hash_init(&rc->hash_in);
+    hash_add(&rc->hash_in, target, strlen(target));
+    rc->hash_out = rc->hash_in;
+    unlinkat(dst_root, e->path, 0);
+    if (symlinkat(target, dst_root, e->path) != 0)
+    {
+        fprintf(stderr, "Error: Failed to create link '%s': %s\n", e->path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Function to Combine an Entry's Content Hash With Its Type and Mode
+ *
+ * The result is the entry's source hash: it changes when the template
+ * file's content, kind or permission bits change.
+ */
+uint64_t render_meta_hash(uint64_t h, const TemplateEntry *e)
+{
+    const uint64_t meta[2] = {h, (uint64_t)e->type << 32 | (uint64_t)e->mode};
+
+    return hash_bytes(meta, sizeof(meta));
+}
+
+/*
+ * Function to Materialize One Template Entry
+ *
+ * Paths are resolved relative to the two root directory descriptors, so
+ * entries can be rendered in any order once their parent directory exists.
+ * On success rc->src_hash and rc->out_hash describe the entry.
+ */
+int render_entry(RenderCtx *rc, const TemplateEntry *e, int src_root, int dst_root)
+{
+    int rv = -1;
+
+    switch (e->type)
+    {
+    case ENTRY_DIR:
+        if (mkdirat(dst_root, e->path, e->mode) != 0 && errno != EEXIST)
+        {
+            fprintf(stderr, "Error: Failed to create directory '%s': %s\n", e->path, strerror(errno));
+            return -1;
+        }
+        hash_init(&rc->hash_in);
+        hash_init(&rc->hash_out);
+        rv = 0;
+        break;
+    case ENTRY_FILE:
+        rv = render_file_(rc, e, src_root, dst_root);
+        if (rv == 1)
+        {
+            /* Linked from the store: the object hash is the content hash */
+            rc->src_hash = render_meta_hash(e->object, e);
+            rc->out_hash = e->object;
+            return 0;
+        }
+        break;
+    case ENTRY_LINK:
+        rv = copy_link_(rc, e, src_root, dst_root);
+        break;
+    }
+    rc->src_hash = render_meta_hash(hash_final(&rc->hash_in), e);
+    rc->out_hash = hash_final(&rc->hash_out);
+    return rv;
+}
@@ -0,0 +1,55 @@
+#ifndef BOIL_RENDER_H
+#define BOIL_RENDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash.h"
+#include "template.h"
+
+/*
+ * Template Placeholder
+ *
+ * Every occurrence of this byte sequence in a template file is replaced
+ * with the project name when the file is rendered.
+ */
+#define BOIL_PLACEHOLDER "{{PROJECT_NAME}}"
+#define BOIL_PLACEHOLDER_LEN (sizeof(BOIL_PLACEHOLDER) - 1U)
+
+/* Size of the streaming read and write buffers used per render context */
+#define RENDER_BUF_SIZE (64U * 1024U)
+
+/*
+ * Structure to Hold the Rendering State
+ *
+ * One context owns the I/O buffers used while rendering, so a context must
+ * not be shared between threads. The project name is borrowed, not copied.
+ * render_entry leaves the hashes of what it read and wrote in the context,
+ * for the project manifest.
+ */
+typedef struct
+{
+    const char *name;  /* Replacement for BOIL_PLACEHOLDER */
+    size_t name_len;   /* Length of name in bytes */
+    char *in;          /* Read buffer (RENDER_BUF_SIZE bytes) */
+    char *out;         /* Write buffer (RENDER_BUF_SIZE bytes) */
+    size_t out_len;    /* Bytes currently pending in out */
+    Hash hash_in;      /* Source content read so far */
+    Hash hash_out;     /* Content written so far */
+    uint64_t src_hash; /* Source content, type and mode of the last entry */
+    uint64_t out_hash; /* Content written for the last entry */
+    int store_root;    /* Object store to link files from, or -1 */
+    int hard_links;    /* Hard-link store objects instead of cloning them */
+} RenderCtx;
+
+int render_init(RenderCtx *rc, const char *name);
+void render_free(RenderCtx *rc);
+
+int write_all(int fd, const char *p, size_t n);
+int open_fresh(int root, const char *path, mode_t mode);
+
+int render_fd(RenderCtx *rc, int src_fd, int dst_fd);
+int render_entry(RenderCtx *rc, const TemplateEntry *e, int src_root, int dst_root);
+uint64_t render_meta_hash(uint64_t h, const TemplateEntry *e);
+
+#endif /* BOIL_RENDER_H */
@@ -0,0 +1,273 @@
+#define _GNU_SOURCE /* copy_file_range */
+#include "store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#include "render.h"
+
+/*
+ * Function to Get the Mode of the Object for a File Mode
+ *
+ * Objects keep the file's read and execute bits but never its write bits,
+ * so a hard link to one has the file's permissions minus writing.
+ */
+static mode_t object_mode_(mode_t mode)
+{
+    return mode & 07555;
+}
+
+/*
+ * Function to Name an Object
+ *
+ * Objects are spread over 256 directories by the top byte of their hash.
+ * The mode is part of the name, since every hard link to an object shares
+ * its mode: the same content with another mode is another object.
+ */
+static void object_name_(uint64_t hash, uint64_t size, mode_t mode, char *out, size_t n)
+{
+    snprintf(out, n, "%02x/%014" PRIx64 "-%" PRIu64 "-%04o", (unsigned)(hash >> 56), hash & (uint64_t)0xffffffffffffff,
+             size, (unsigned)object_mode_(mode));
+}
+
+/*
+ * Function to Open the Object Store of a Template Directory
+ *
+ * The store is STORE_DIR in the directory holding the template directory.
+ * With create set it is created if missing. Returns a directory
+ * descriptor, or -1.
+ */
+int store_open(const char *template_dir, int create)
+{
+    char path[PATH_MAX];
+    size_t n = strlen(template_dir);
+    size_t dir;
+
+    while (n > 1 && template_dir[n - 1] == '/')
+    {
+        n--;
+    }
+    for (dir = n; dir > 0 && template_dir[dir - 1] != '/'; dir--)
+    {
+    }
+    if (snprintf(path, sizeof(path), "%.*s%s", (int)dir, template_dir, STORE_DIR) >= (int)sizeof(path))
+    {
+        return -1;
+    }
+    if (create && mkdir(path, 0755) != 0 && errno != EEXIST)
+    {
+        return -1;
+    }
+    return open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+/*
+ * Function to Check That an Object Was Not Written Since It Was Stored
+ *
+ * Objects are stamped with STORE_MTIME when stored, and any write moves
+ * the modification time, so a changed time means the object (and every
+ * hard link to it) was modified, whatever its mode allowed. Size and mode
+ * must also be those the object was stored with.
+ */
+static int object_intact_(const struct stat *st, uint64_t size, mode_t mode)
+{
+    return (uint64_t)st->st_size == size && (st->st_mode & 07777) == object_mode_(mode) &&
+           st->st_mtim.tv_sec == STORE_MTIME && st->st_mtim.tv_nsec == 0;
+}
+
+/*
+ * Function to Check That an Existing Object Holds the Given Content
+ */
+static int object_matches_(int store_root, const char *name, const char *data, uint64_t size)
+{
+    struct stat st;
+    void *map;
+    int fd = openat(store_root, name, O_RDONLY | O_CLOEXEC);
+    int same;
+
+    if (fd < 0 || fstat(fd, &st) != 0 || (uint64_t)st.st_size != size)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return 0;
+    }
+    map = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return 0;
+    }
+    same = memcmp(map, data, (size_t)size) == 0;
+    munmap(map, (size_t)size);
+    return same;
+}
+
+/*
+ * Function to Add Content to the Store
+ *
+ * hash must be the content's hash_bytes. An intact object that already
+ * exists is compared byte for byte, so a hash collision is refused rather
+ * than handing out the wrong file; one that was modified is replaced. New
+ * objects are written to a temporary name, stamped (see object_intact_)
+ * and renamed into place with object_mode_(mode), whatever the umask.
+ * Returns 0 when the object holds the content.
+ */
+int store_put(int store_root, const char *data, uint64_t size, uint64_t hash, mode_t mode)
+{
+    const struct timespec stamp[2] = {{0, UTIME_OMIT}, {STORE_MTIME, 0}};
+    char name[64];
+    char tmp[96];
+    struct stat st;
+    int fd;
+    int rv;
+
+    object_name_(hash, size, mode, name, sizeof(name));
+    if (fstatat(store_root, name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+    {
+        if (object_intact_(&st, size, mode))
+        {
+            return object_matches_(store_root, name, data, size) ? 0 : -1;
+        }
+        unlinkat(store_root, name, 0);
+    }
+    name[2] = '\0';
+    if (mkdirat(store_root, name, 0755) != 0 && errno != EEXIST)
+    {
+        return -1;
+    }
+    name[2] = '/';
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", name, (long)getpid());
+    if ((fd = openat(store_root, tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0444)) < 0)
+    {
+        return -1;
+    }
+    rv = write_all(fd, data, (size_t)size);
+    if (rv == 0)
+    {
+        rv = fchmod(fd, object_mode_(mode)) == 0 && futimens(fd, stamp) == 0 ? 0 : -1;
+    }
+    if (close(fd) != 0 || rv != 0 || renameat(store_root, tmp, store_root, name) != 0)
+    {
+        unlinkat(store_root, tmp, 0);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Function to Clone an Object Into a File
+ *
+ * FICLONE shares the object's blocks; copy_file_range copies inside the
+ * kernel, and on filesystems that support it clones as well.
+ */
+static int clone_(int sfd, int dfd, uint64_t size)
+{
+#ifdef FICLONE
+    if (ioctl(dfd, FICLONE, sfd) == 0)
+    {
+        return 0;
+    }
+#endif
+#ifdef __linux__
+    while (size > 0)
+    {
+        ssize_t n = copy_file_range(sfd, NULL, dfd, NULL, (size_t)size, 0);
+        if (n <= 0)
+        {
+            return -1;
+        }
+        size -= (uint64_t)n;
+    }
+    return 0;
+#else
+    (void)sfd;
+    (void)dfd;
+    (void)size;
+    return -1;
+#endif
+}
+
+/*
+ * Function to Materialize a File From the Store
+ *
+ * e must carry an object (e->object). The file is made a hard link to the
+ * object when hard is set, and a clone of it otherwise. An object that was
+ * modified since it was stored is removed from the store, so it is never
+ * handed out again. Returns 0 on success and 1 when the caller should
+ * write the file itself: the object is missing, damaged or modified, the
+ * project is on another filesystem, or the filesystem cannot clone.
+ */
+int store_link(int store_root, const TemplateEntry *e, int dst_root, int hard)
+{
+    char name[64];
+    struct stat st;
+    int sfd;
+    int dfd;
+    int rv;
+
+    object_name_(e->object, e->size, e->mode, name, sizeof(name));
+    if (hard)
+    {
+        if (fstatat(store_root, name, &st, 0) != 0)
+        {
+            return 1;
+        }
+        if (!object_intact_(&st, e->size, e->mode))
+        {
+            unlinkat(store_root, name, 0);
+            return 1;
+        }
+        if (linkat(store_root, name, dst_root, e->path, 0) != 0 &&
+            (errno != EEXIST || unlinkat(dst_root, e->path, 0) != 0 ||
+             linkat(store_root, name, dst_root, e->path, 0) != 0))
+        {
+            return 1;
+        }
+        return 0;
+    }
+    if (e->size < STORE_CLONE_MIN)
+    {
+        return 1;
+    }
+    if ((sfd = openat(store_root, name, O_RDONLY | O_CLOEXEC)) < 0)
+    {
+        return 1;
+    }
+    if (fstat(sfd, &st) != 0 || !object_intact_(&st, e->size, e->mode))
+    {
+        unlinkat(store_root, name, 0);
+        close(sfd);
+        return 1;
+    }
+    if ((dfd = open_fresh(dst_root, e->path, e->mode)) < 0)
+    {
+        close(sfd);
+        return 1;
+    }
+    rv = clone_(sfd, dfd, e->size);
+    if (close(dfd) != 0)
+    {
+        rv = -1;
+    }
+    close(sfd);
+    if (rv != 0)
+    {
+        unlinkat(dst_root, e->path, 0);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef BOIL_STORE_H
+#define BOIL_STORE_H
+
+#include <stdint.h>
+
+#include "template.h"
+
+/*
+ * Content-Addressed Object Store
+ *
+ * Template files without placeholders are rendered byte for byte, so every
+ * project would get its own copy of them. When a template pack is built,
+ * each such file is also stored once, read-only, in a store shared by all
+ * templates: STORE_DIR next to the template directories, with objects
+ * named by the content hash, size and mode of the file (see hash.h). Projects
+ * then get a reflink of the object, which shares its blocks until either
+ * copy is written, or with -H a hard link to it. Where neither works (a
+ * different filesystem, or one without reflinks) the file is written as
+ * usual, so the store never changes what a project contains.
+ */
+#define STORE_DIR ".boil-objects"
+
+/* Smallest file worth cloning; smaller ones are as fast to write and may
+   be stored inline in the filesystem's metadata anyway */
+#define STORE_CLONE_MIN 4096U
+
+/* Modification time every object is stored with; any other time means it
+   was written to since, through a hard link or otherwise */
+#define STORE_MTIME 1
+
+int store_open(const char *template_dir, int create);
+int store_put(int store_root, const char *data, uint64_t size, uint64_t hash, mode_t mode);
+int store_link(int store_root, const TemplateEntry *e, int dst_root, int hard);
+
+#endif /* BOIL_STORE_H */
@@ -0,0 +1,239 @@
+#include "template.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Function to Fold Bytes Into a 64-bit FNV-1a Hash
+ */
+static uint64_t fnv1a_(uint64_t h, const void *p, size_t n)
+{
+    const unsigned char *b = (const unsigned char *)p;
+    while (n-- > 0)
+    {
+        h ^= *b++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/*
+ * Function to Hash the Metadata of One Entry
+ *
+ * Any edit to a template file changes its size or modification time, so
+ * this is enough to tell whether a pack built from the template is stale
+ * without reading file contents. Per-entry hashes are summed, which makes
+ * the fingerprint independent of directory listing order.
+ */
+static uint64_t entry_hash_(const char *path, const struct stat *st)
+{
+    uint64_t meta[4];
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    meta[0] = (uint64_t)st->st_mode;
+    meta[1] = (uint64_t)st->st_size;
+    meta[2] = (uint64_t)st->st_mtim.tv_sec;
+    meta[3] = (uint64_t)st->st_mtim.tv_nsec;
+    h = fnv1a_(h, path, strlen(path) + 1);
+    return fnv1a_(h, meta, sizeof(meta));
+}
+
+/*
+ * Function to Append an Entry to a Template
+ */
+static int add_entry_(Template *t, const char *path, const struct stat *st, EntryType type, unsigned depth)
+{
+    TemplateEntry *e;
+
+    if (t->count == t->cap)
+    {
+        size_t cap = t->cap ? t->cap * 2 : 64;
+        TemplateEntry *grown = realloc(t->entries, cap * sizeof(*grown));
+        if (!grown)
+        {
+            return -1;
+        }
+        t->entries = grown;
+        t->cap = cap;
+    }
+    e = &t->entries[t->count];
+    if ((e->path = strdup(path)) == NULL)
+    {
+        return -1;
+    }
+    e->mode = st->st_mode & 07777;
+    e->type = type;
+    e->depth = depth;
+    e->data = NULL;
+    e->size = 0;
+    e->ph = NULL;
+    e->ph_count = 0;
+    e->object = 0;
+    t->count++;
+    t->fingerprint += entry_hash_(path, st);
+    return 0;
+}
+
+/*
+ * Function to Scan a Directory Recursively
+ *
+ * path holds the relative path of the directory being scanned; it is
+ * extended in place for each child and restored afterwards.
+ */
+static int scan_dir_(Template *t, int dfd, char *path, size_t path_len, unsigned depth)
+{
+    DIR *d;
+    struct dirent *e;
+    int rv = 0;
+
+    if ((d = fdopendir(dfd)) == NULL)
+    {
+        fprintf(stderr, "Error: Failed to open '%s/%s': %s\n", t->root, path, strerror(errno));
+        close(dfd);
+        return -1;
+    }
+    while (rv == 0 && (e = readdir(d)) != NULL)
+    {
+        struct stat st;
+        size_t n;
+        size_t len;
+
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+        {
+            continue;
+        }
+        n = strlen(e->d_name);
+        len = path_len ? path_len + 1 + n : n;
+        if (len >= PATH_MAX)
+        {
+            fprintf(stderr, "Error: Path too long under '%s/%s'.\n", t->root, path);
+            rv = -1;
+            break;
+        }
+        if (path_len)
+        {
+            path[path_len] = '/';
+        }
+        memcpy(path + len - n, e->d_name, n + 1);
+
+        if (fstatat(dirfd(d), e->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+        {
+            fprintf(stderr, "Error: Failed to stat '%s/%s': %s\n", t->root, path, strerror(errno));
+            rv = -1;
+        }
+        else if (S_ISREG(st.st_mode) || S_ISLNK(st.st_mode))
+        {
+            rv = add_entry_(t, path, &st, S_ISREG(st.st_mode) ? ENTRY_FILE : ENTRY_LINK, depth);
+        }
+        else if (S_ISDIR(st.st_mode))
+        {
+            int child = openat(dirfd(d), e->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (child < 0)
+            {
+                fprintf(stderr, "Error: Failed to open '%s/%s': %s\n", t->root, path, strerror(errno));
+                rv = -1;
+            }
+            else if ((rv = add_entry_(t, path, &st, ENTRY_DIR, depth)) == 0)
+            {
+                rv = scan_dir_(t, child, path, len, depth + 1);
+            }
+            else
+            {
+                close(child);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Warning: Skipping special file '%s/%s'.\n", t->root, path);
+        }
+        path[path_len] = '\0';
+    }
+    closedir(d);
+    return rv;
+}
+
+/*
+ * Function to Scan a Template Directory
+ *
+ * This function records every directory, file and symbolic link below dir
+ * without reading any file contents, so rendering can be planned (and
+ * split across workers) before any output is written.
+ */
+int template_scan(Template *t, const char *dir)
+{
+    char path[PATH_MAX] = "";
+    int dfd;
+
+    memset(t, 0, sizeof(*t));
+    if ((t->root = strdup(dir)) == NULL)
+    {
+        return -1;
+    }
+    dfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd < 0)
+    {
+        fprintf(stderr, "Error: Failed to open template '%s': %s\n", dir, strerror(errno));
+        template_free(t);
+        return -1;
+    }
+    if (scan_dir_(t, dfd, path, 0, 0) != 0)
+    {
+        template_free(t);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Function to Check That a Relative Path Stays Inside Its Root
+ *
+ * Paths read from packs and manifests are checked with this before they
+ * are used, so a corrupt file cannot reach outside the project.
+ */
+int template_path_is_safe(const char *path)
+{
+    const char *p = path;
+
+    if (*path == '\0' || *path == '/')
+    {
+        return 0;
+    }
+    while (p)
+    {
+        if (p[0] == '.' && p[1] == '.' && (p[2] == '/' || p[2] == '\0'))
+        {
+            return 0;
+        }
+        p = strchr(p, '/');
+        p = p ? p + 1 : NULL;
+    }
+    return 1;
+}
+
+/*
+ * Function to Release a Scanned Template
+ */
+void template_free(Template *t)
+{
+    size_t i;
+
+    for (i = 0; !t->map && i < t->count; i++)
+    {
+        free(t->entries[i].path);
+    }
+    if (t->map)
+    {
+        munmap(t->map, t->map_len);
+    }
+    free(t->entries);
+    free(t->root);
+    memset(t, 0, sizeof(*t));
+}
@@ -0,0 +1,59 @@
+#ifndef BOIL_TEMPLATE_H
+#define BOIL_TEMPLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * Enumeration of Template Entry Types
+ */
+typedef enum
+{
+    ENTRY_DIR,  /* Directory, created before anything inside it */
+    ENTRY_FILE, /* Regular file, rendered with placeholder substitution */
+    ENTRY_LINK  /* Symbolic link, recreated as-is */
+} EntryType;
+
+/*
+ * Structure to Hold One Template Entry
+ *
+ * Paths are relative to the template root and never start with a slash.
+ * Entries loaded from a template pack also carry their content (or link
+ * target) and the offsets of every placeholder in it; for scanned entries
+ * data is NULL and the content is read from the template directory.
+ */
+typedef struct
+{
+    char *path;          /* Relative path of the entry */
+    mode_t mode;         /* Permission bits of the source entry */
+    EntryType type;      /* Kind of entry */
+    unsigned depth;      /* Number of parent directories below the root */
+    const char *data;    /* Content when loaded from a pack, else NULL */
+    uint64_t size;       /* Content size in bytes (pack only) */
+    const uint64_t *ph;  /* Sorted placeholder offsets in data (pack only) */
+    uint64_t ph_count;   /* Number of placeholder offsets (pack only) */
+    uint64_t object;     /* Content hash of its store object, or 0 (pack only) */
+} TemplateEntry;
+
+/*
+ * Structure to Hold a Scanned Template
+ *
+ * Entries are stored in pre-order, so every directory precedes its contents.
+ */
+typedef struct
+{
+    char *root;             /* Template directory the entries are relative to */
+    TemplateEntry *entries; /* Entries in pre-order */
+    size_t count;           /* Number of entries */
+    size_t cap;             /* Allocated capacity of entries */
+    uint64_t fingerprint;   /* Hash of every entry's path, type, mode, size and mtime */
+    void *map;              /* Mapped template pack backing the entries, if any */
+    size_t map_len;         /* Length of the mapping */
+} Template;
+
+int template_scan(Template *t, const char *dir);
+int template_path_is_safe(const char *path);
+void template_free(Template *t);
+
+#endif /* BOIL_TEMPLATE_H */
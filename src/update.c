@@ -0,0 +1,449 @@
+#include "update.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "render.h"
+
+/*
+ * Structure to Hold One Parallel Pass of an Update
+ *
+ * The same structure serves hashing the template (list is NULL and every
+ * entry is hashed) and re-rendering the changed entries of a project
+ * (list holds their entry indices, rec the manifest entry of each).
+ */
+typedef struct
+{
+    Generator *g;        /* Generator whose pool and buffers are used */
+    const Template *t;   /* Template being hashed or rendered */
+    uint64_t *src;       /* Source hash of every entry (hashing only) */
+    const size_t *list;  /* Entry indices to render */
+    ManifestEntry *rec;  /* Manifest entry of each rendered entry */
+    int src_root;        /* Template root directory */
+    int dst_root;        /* Project root directory */
+    atomic_int failed;   /* Set by the first entry that fails */
+} Pass_;
+
+/*
+ * Function to Hash the Content of a File or Link Target
+ *
+ * The file is read through buf (RENDER_BUF_SIZE bytes) without following a
+ * final symbolic link. Returns 0 with *h set, 1 if the path does not exist,
+ * 2 if it is not of the given type, and -1 on a read error.
+ */
+static int hash_content_(int root, const char *path, EntryType type, char *buf, uint64_t *h)
+{
+    struct stat st;
+    Hash s;
+    int fd;
+
+    if (fstatat(root, path, &st, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        return errno == ENOENT || errno == ENOTDIR ? 1 : -1;
+    }
+    *h = hash_bytes("", 0);
+    if (type == ENTRY_LINK)
+    {
+        ssize_t n;
+        if (!S_ISLNK(st.st_mode))
+        {
+            return 2;
+        }
+        if ((n = readlinkat(root, path, buf, RENDER_BUF_SIZE)) < 0)
+        {
+            return -1;
+        }
+        *h = hash_bytes(buf, (size_t)n);
+        return 0;
+    }
+    if (type != ENTRY_FILE || !S_ISREG(st.st_mode))
+    {
+        return type == ENTRY_DIR && S_ISDIR(st.st_mode) ? 0 : 2;
+    }
+    if ((fd = openat(root, path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC)) < 0)
+    {
+        return -1;
+    }
+    hash_init(&s);
+    for (;;)
+    {
+        ssize_t r = read(fd, buf, RENDER_BUF_SIZE);
+        if (r < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (r <= 0)
+        {
+            close(fd);
+            *h = hash_final(&s);
+            return r < 0 ? -1 : 0;
+        }
+        hash_add(&s, buf, (size_t)r);
+    }
+}
+
+/*
+ * Function to Hash One Template Entry
+ */
+static void hash_entry_(void *arg, size_t i, unsigned worker)
+{
+    Pass_ *pass = (Pass_ *)arg;
+    const TemplateEntry *e = &pass->t->entries[i];
+    uint64_t h = hash_bytes("", 0);
+
+    if (e->object)
+    {
+        h = e->object;
+    }
+    else if (e->data)
+    {
+        h = hash_bytes(e->data, (size_t)e->size);
+    }
+    else if (e->type != ENTRY_DIR &&
+             hash_content_(pass->src_root, e->path, e->type, pass->g->rcs[worker].in, &h) != 0)
+    {
+        fprintf(stderr, "Error: Failed to read '%s/%s': %s\n", pass->t->root, e->path, strerror(errno));
+        atomic_store(&pass->failed, 1);
+        return;
+    }
+    pass->src[i] = render_meta_hash(h, e);
+}
+
+/*
+ * Function to Hash Every Entry of a Template
+ *
+ * src receives one source hash per entry, equal to the one recorded in the
+ * manifest of a project generated from the same template state. This reads
+ * the whole template once; it is done once per template however many
+ * projects are then updated from it.
+ */
+int update_hash_template(Generator *g, const Template *t, uint64_t *src)
+{
+    Pass_ pass;
+
+    memset(&pass, 0, sizeof(pass));
+    pass.g = g;
+    pass.t = t;
+    pass.src = src;
+    atomic_init(&pass.failed, 0);
+    if ((pass.src_root = open(t->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+    {
+        fprintf(stderr, "Error: Failed to open template '%s': %s\n", t->root, strerror(errno));
+        return -1;
+    }
+    pool_run(&g->pool, t->count, hash_entry_, &pass);
+    close(pass.src_root);
+    return atomic_load(&pass.failed) ? -1 : 0;
+}
+
+/*
+ * Function to Re-Render One Changed Entry of a Project
+ *
+ * Files are replaced, never rewritten in place (see open_fresh), so a
+ * file hard-linked from the object store is never modified and every file
+ * gets the template's current mode.
+ */
+static void render_changed_(void *arg, size_t i, unsigned worker)
+{
+    Pass_ *pass = (Pass_ *)arg;
+    RenderCtx *rc = &pass->g->rcs[worker];
+    const TemplateEntry *e = &pass->t->entries[pass->list[i]];
+
+    if (atomic_load_explicit(&pass->failed, memory_order_relaxed))
+    {
+        return;
+    }
+    if (render_entry(rc, e, pass->src_root, pass->dst_root) != 0)
+    {
+        atomic_store(&pass->failed, 1);
+        return;
+    }
+    pass->rec[i].src = rc->src_hash;
+    pass->rec[i].out = rc->out_hash;
+}
+
+/*
+ * Structure to Hold the State of Updating One Project
+ */
+typedef struct
+{
+    Generator *g;            /* Generator whose pool and buffers are used */
+    const Template *t;       /* Template the project is updated from */
+    const uint64_t *src;     /* Source hash of every template entry */
+    const char *project_dir; /* Project path, for messages */
+    int project_root;        /* Project root directory */
+    const Manifest *m;       /* Manifest written at the last generation or update */
+    Manifest next;           /* Manifest being built for this update */
+    size_t *list;            /* Template entries to re-render */
+    size_t *slot;            /* Entry in next of each of them */
+    size_t changed;          /* Number of entries to re-render */
+    unsigned char *seen;     /* Set for manifest entries still in the template */
+    UpdateStats *stats;      /* Counts reported to the caller */
+} Update_;
+
+/*
+ * Function to Report a Conflict
+ */
+static void conflict_(Update_ *u, const char *path, const char *why)
+{
+    printf("Conflict: %s/%s %s; left as is.\n", u->project_dir, path, why);
+    u->stats->conflicts++;
+}
+
+/*
+ * Function to Add a Record to the New Manifest
+ */
+static int record_(Update_ *u, const ManifestEntry *rec)
+{
+    if (manifest_add(&u->next, rec) != 0)
+    {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Function to Decide What Each Template Entry Needs
+ *
+ * Unchanged entries are carried over without touching the project.
+ * Directories are created here, in pre-order, so every changed file has
+ * its parent by the time it is rendered; files and links to re-render are
+ * queued in u->list.
+ */
+static int plan_(Update_ *u)
+{
+    size_t i;
+
+    for (i = 0; i < u->t->count; i++)
+    {
+        const TemplateEntry *e = &u->t->entries[i];
+        const ManifestEntry *old = manifest_find(u->m, e->path);
+        ManifestEntry rec;
+        uint64_t h = 0;
+        int state;
+
+        if (old)
+        {
+            u->seen[old - u->m->entries] = 1;
+        }
+        rec.path = e->path;
+        rec.type = e->type;
+        rec.mode = e->mode;
+        rec.src = u->src[i];
+        rec.out = hash_bytes("", 0);
+        if (old && old->type == e->type && old->src == u->src[i])
+        {
+            if (record_(u, old) != 0)
+            {
+                return -1;
+            }
+            continue;
+        }
+        if (e->type == ENTRY_DIR)
+        {
+            if (mkdirat(u->project_root, e->path, e->mode) != 0 && errno != EEXIST)
+            {
+                fprintf(stderr, "Error: Failed to create directory '%s/%s': %s\n", u->project_dir, e->path, strerror(errno));
+                return -1;
+            }
+            u->stats->added += !old;
+            if (record_(u, &rec) != 0)
+            {
+                return -1;
+            }
+            continue;
+        }
+        state = hash_content_(u->project_root, e->path, e->type, u->g->rcs[0].in, &h);
+        if (state < 0)
+        {
+            fprintf(stderr, "Error: Failed to read '%s/%s': %s\n", u->project_dir, e->path, strerror(errno));
+            return -1;
+        }
+        if (!old && state != 1)
+        {
+            conflict_(u, e->path, "is new in the template but already exists");
+            continue;
+        }
+        if (old && state != 0)
+        {
+            conflict_(u, e->path, "changed in the template but was deleted or replaced");
+        }
+        else if (old && h != old->out)
+        {
+            conflict_(u, e->path, "changed in the template but was edited");
+        }
+        else
+        {
+            /* Unedited, or new and not in the way of anything */
+            if (old)
+            {
+                u->stats->updated++;
+            }
+            else
+            {
+                u->stats->added++;
+            }
+            u->list[u->changed] = i;
+            u->slot[u->changed++] = u->next.count;
+            old = &rec;
+        }
+        if (record_(u, old) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function to Re-Render the Queued Entries on the Worker Pool
+ */
+static int rerender_(Update_ *u)
+{
+    Pass_ pass;
+    size_t i;
+    int rv;
+
+    memset(&pass, 0, sizeof(pass));
+    if ((pass.rec = malloc(u->changed * sizeof(*pass.rec))) == NULL)
+    {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    if ((pass.src_root = open(u->t->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+    {
+        fprintf(stderr, "Error: Failed to open template '%s': %s\n", u->t->root, strerror(errno));
+        free(pass.rec);
+        return -1;
+    }
+    pass.g = u->g;
+    pass.t = u->t;
+    pass.list = u->list;
+    pass.dst_root = u->project_root;
+    atomic_init(&pass.failed, 0);
+    for (i = 0; i < u->g->jobs; i++)
+    {
+        u->g->rcs[i].name = u->m->name;
+        u->g->rcs[i].name_len = strlen(u->m->name);
+    }
+    pool_run(&u->g->pool, u->changed, render_changed_, &pass);
+    for (i = 0; i < u->changed; i++)
+    {
+        u->next.entries[u->slot[i]].src = pass.rec[i].src;
+        u->next.entries[u->slot[i]].out = pass.rec[i].out;
+    }
+    rv = atomic_load(&pass.failed) ? -1 : 0;
+    close(pass.src_root);
+    free(pass.rec);
+    return rv;
+}
+
+/*
+ * Function to Remove What the Template Dropped
+ *
+ * The manifest is sorted by path, so walking it backwards reaches every
+ * directory's contents before the directory itself. Files that were edited
+ * are kept and reported; directories are only removed once empty.
+ */
+static int remove_dropped_(Update_ *u)
+{
+    size_t i;
+
+    for (i = u->m->count; i-- > 0;)
+    {
+        const ManifestEntry *old = &u->m->entries[i];
+        uint64_t h = 0;
+        int state;
+
+        if (u->seen[i])
+        {
+            continue;
+        }
+        if (old->type == ENTRY_DIR)
+        {
+            u->stats->removed += unlinkat(u->project_root, old->path, AT_REMOVEDIR) == 0;
+            continue;
+        }
+        state = hash_content_(u->project_root, old->path, old->type, u->g->rcs[0].in, &h);
+        if (state == 0 && h == old->out)
+        {
+            if (unlinkat(u->project_root, old->path, 0) != 0)
+            {
+                fprintf(stderr, "Error: Failed to remove '%s/%s': %s\n", u->project_dir, old->path, strerror(errno));
+                return -1;
+            }
+            u->stats->removed++;
+        }
+        else if (state == 0)
+        {
+            conflict_(u, old->path, "was removed from the template but was edited");
+            if (record_(u, old) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function to Update a Project From Its Template
+ *
+ * Each template entry whose source hash matches the manifest is skipped
+ * without touching the project, so the work done is proportional to what
+ * changed in the template. A changed entry is re-rendered if the project
+ * still holds exactly what was generated for it, and reported as a
+ * conflict otherwise; entries the template dropped are removed on the same
+ * terms. The manifest is rewritten to match, keeping the old record of
+ * every conflict so it is reported again until resolved.
+ */
+int update_project(Generator *g, const Template *t, const uint64_t *src,
+                   const char *project_dir, int project_root, const Manifest *m, UpdateStats *stats)
+{
+    const size_t n = t->count ? t->count : 1;
+    Update_ u;
+    int rv = -1;
+
+    memset(&u, 0, sizeof(u));
+    memset(stats, 0, sizeof(*stats));
+    u.g = g;
+    u.t = t;
+    u.src = src;
+    u.project_dir = project_dir;
+    u.project_root = project_root;
+    u.m = m;
+    u.stats = stats;
+    u.next.template_dir = m->template_dir;
+    u.next.name = m->name;
+    u.list = malloc(n * sizeof(*u.list));
+    u.slot = malloc(n * sizeof(*u.slot));
+    u.seen = calloc(m->count ? m->count : 1, 1);
+    if (!u.list || !u.slot || !u.seen)
+    {
+        fprintf(stderr, "Error: Out of memory.\n");
+    }
+    else if (plan_(&u) == 0 && (u.changed == 0 || rerender_(&u) == 0) && remove_dropped_(&u) == 0)
+    {
+        manifest_sort(&u.next);
+        if (manifest_write(&u.next, project_root) != 0)
+        {
+            fprintf(stderr, "Error: Failed to write '%s/%s': %s\n", project_dir, MANIFEST_NAME, strerror(errno));
+        }
+        else
+        {
+            rv = 0;
+        }
+    }
+    free(u.list);
+    free(u.slot);
+    free(u.seen);
+    free(u.next.entries);
+    return rv;
+}
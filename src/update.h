@@ -0,0 +1,26 @@
+#ifndef BOIL_UPDATE_H
+#define BOIL_UPDATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "generate.h"
+#include "manifest.h"
+#include "template.h"
+
+/*
+ * Structure to Hold the Outcome of Updating One Project
+ */
+typedef struct
+{
+    size_t updated;   /* Entries re-rendered because the template changed */
+    size_t added;     /* Entries new in the template */
+    size_t removed;   /* Entries removed because the template dropped them */
+    size_t conflicts; /* Entries left alone because they were edited */
+} UpdateStats;
+
+int update_hash_template(Generator *g, const Template *t, uint64_t *src);
+int update_project(Generator *g, const Template *t, const uint64_t *src,
+                   const char *project_dir, int project_root, const Manifest *m, UpdateStats *stats);
+
+#endif /* BOIL_UPDATE_H */
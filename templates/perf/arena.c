@@ -0,0 +1,109 @@
+#include "arena.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "simd.h"
+
+/*
+ * Function to Create an Arena With Its Own Block
+ *
+ * The block is aligned to a cache line. Returns -1 if it cannot be allocated.
+ */
+int arena_init(Arena *a, size_t size)
+{
+    a->base = aligned_buffer_alloc(size, SIMD_CACHE_LINE);
+    a->size = a->base ? size : 0;
+    a->used = 0;
+    a->owned = 1;
+    return a->base ? 0 : -1;
+}
+
+/*
+ * Function to Create an Arena Over a Caller's Buffer
+ */
+void arena_init_buffer(Arena *a, void *buffer, size_t size)
+{
+    a->base = (unsigned char *)buffer;
+    a->size = size;
+    a->used = 0;
+    a->owned = 0;
+}
+
+/*
+ * Function to Allocate From an Arena
+ *
+ * The alignment must be a power of two. Returns NULL when the arena does
+ * not have size bytes left at that alignment.
+ */
+void *arena_alloc(Arena *a, size_t size, size_t align)
+{
+    const uintptr_t address = (uintptr_t)a->base + a->used;
+    const size_t padding = (size_t)(-address & (align - 1));
+
+    if (padding > a->size - a->used || size > a->size - a->used - padding)
+    {
+        return NULL;
+    }
+    a->used += padding + size;
+    return (void *)(address + padding);
+}
+
+/*
+ * Function to Allocate Zeroed Memory From an Arena
+ */
+void *arena_calloc(Arena *a, size_t count, size_t size, size_t align)
+{
+    void *p;
+
+    if (size != 0 && count > SIZE_MAX / size)
+    {
+        return NULL;
+    }
+    if ((p = arena_alloc(a, count * size, align)) != NULL)
+    {
+        memset(p, 0, count * size);
+    }
+    return p;
+}
+
+/*
+ * Function to Remember How Much of an Arena Is Used
+ */
+size_t arena_mark(const Arena *a)
+{
+    return a->used;
+}
+
+/*
+ * Function to Free Everything Allocated Since a Mark
+ */
+void arena_rewind(Arena *a, size_t mark)
+{
+    if (mark < a->used)
+    {
+        a->used = mark;
+    }
+}
+
+/*
+ * Function to Free Everything in an Arena
+ */
+void arena_reset(Arena *a)
+{
+    a->used = 0;
+}
+
+/*
+ * Function to Release an Arena's Block
+ */
+void arena_destroy(Arena *a)
+{
+    if (a->owned)
+    {
+        aligned_buffer_free(a->base);
+    }
+    a->base = NULL;
+    a->size = 0;
+    a->used = 0;
+}
@@ -0,0 +1,30 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Structure to Hold a Linear (Arena) Allocator
+ *
+ * An arena hands out memory by bumping an offset through one block, so an
+ * allocation costs an add and a compare. Nothing is freed on its own: the
+ * whole arena is reset at once, or rolled back to a mark taken earlier.
+ */
+typedef struct
+{
+    unsigned char *base; /* Start of the block */
+    size_t size;         /* Bytes in the block */
+    size_t used;         /* Bytes handed out, including alignment padding */
+    int owned;           /* Whether arena_destroy frees the block */
+} Arena;
+
+int arena_init(Arena *a, size_t size);
+void arena_init_buffer(Arena *a, void *buffer, size_t size);
+void *arena_alloc(Arena *a, size_t size, size_t align);
+void *arena_calloc(Arena *a, size_t count, size_t size, size_t align);
+size_t arena_mark(const Arena *a);
+void arena_rewind(Arena *a, size_t mark);
+void arena_reset(Arena *a);
+void arena_destroy(Arena *a);
+
+#endif /* ARENA_H */
@@ -0,0 +1,402 @@
+#include "jobs.h"
+
+#include <unistd.h>
+
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define cpu_relax_() _mm_pause()
+#elif defined(__aarch64__)
+#define cpu_relax_() __asm__ volatile("yield")
+#else
+#define cpu_relax_() ((void)0)
+#endif
+
+#define JOBS_MASK_ (JOBS_DEQUE_CAPACITY - 1U)
+#define JOBS_MAX_CHUNKS_ 256U /* Most jobs one jobs_parallel_for splits into */
+
+/* The worker running on this thread, or NULL */
+static _Thread_local JobWorker *current_;
+
+/*
+ * Function to Push a Job on the Bottom of the Owner's Deque
+ *
+ * Returns 0 if the deque is full.
+ */
+static int deque_push_(JobDeque *d, Job *job)
+{
+    const int_fast64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    const int_fast64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+
+    if (b - t >= (int_fast64_t)JOBS_DEQUE_CAPACITY)
+    {
+        return 0;
+    }
+    atomic_store_explicit(&d->slots[b & JOBS_MASK_], job, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+    return 1;
+}
+
+/*
+ * Function to Pop the Newest Job From the Owner's Deque
+ *
+ * Only the last job can be contended by thieves; the top is then claimed
+ * with a compare-and-swap like a steal would.
+ */
+static Job *deque_pop_(JobDeque *d)
+{
+    const int_fast64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    int_fast64_t t;
+    Job *job;
+
+    atomic_store_explicit(&d->bottom, b, memory_order_seq_cst);
+    t = atomic_load_explicit(&d->top, memory_order_seq_cst);
+    if (t > b)
+    {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    job = atomic_load_explicit(&d->slots[b & JOBS_MASK_], memory_order_relaxed);
+    if (t == b)
+    {
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        {
+            job = NULL;
+        }
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+/*
+ * Function to Steal the Oldest Job From Another Worker's Deque
+ */
+static Job *deque_steal_(JobDeque *d)
+{
+    int_fast64_t t = atomic_load_explicit(&d->top, memory_order_seq_cst);
+    const int_fast64_t b = atomic_load_explicit(&d->bottom, memory_order_seq_cst);
+    Job *job;
+
+    if (t >= b)
+    {
+        return NULL;
+    }
+    job = atomic_load_explicit(&d->slots[t & JOBS_MASK_], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+    {
+        return NULL;
+    }
+    return job;
+}
+
+/*
+ * Function to Find a Job for a Worker
+ *
+ * Takes the worker's own newest job first, then tries every other worker
+ * once, starting from a random one so thieves spread out.
+ */
+static Job *find_job_(JobWorker *w)
+{
+    JobSystem *s = w->system;
+    Job *job = deque_pop_(&w->deque);
+    unsigned start;
+    unsigned i;
+
+    if (!job && s->count > 1)
+    {
+        w->rng ^= w->rng << 13;
+        w->rng ^= w->rng >> 17;
+        w->rng ^= w->rng << 5;
+        start = w->rng % s->count;
+        for (i = 0; i < s->count && !job; i++)
+        {
+            const unsigned victim = (start + i) % s->count;
+            if (victim != w->index)
+            {
+                job = deque_steal_(&s->workers[victim].deque);
+            }
+        }
+    }
+    if (job)
+    {
+        atomic_fetch_sub_explicit(&s->queued, 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+/*
+ * Function to Run a Job and Count It as Finished
+ */
+static void run_job_(Job *job)
+{
+    JobCounter *counter = job->counter;
+
+    job->fn(job->arg);
+    if (counter)
+    {
+        atomic_fetch_sub_explicit(&counter->pending, 1, memory_order_release);
+    }
+}
+
+/*
+ * Worker Thread Entry Point
+ *
+ * Each thread runs jobs while it can find them, spins for a while when it
+ * cannot, then sleeps until jobs_submit queues a job or the system stops.
+ */
+static void *worker_main_(void *arg)
+{
+    JobWorker *w = (JobWorker *)arg;
+    JobSystem *s = w->system;
+    unsigned idle = 0;
+
+    current_ = w;
+    while (!atomic_load_explicit(&s->quit, memory_order_acquire))
+    {
+        Job *job = find_job_(w);
+        if (job)
+        {
+            run_job_(job);
+            idle = 0;
+            continue;
+        }
+        if (++idle < JOBS_SPIN)
+        {
+            cpu_relax_();
+            continue;
+        }
+        idle = 0;
+
+        /* The sleeping count is raised before queued is checked, and
+           jobs_submit raises queued before checking sleeping, so one of
+           the two always sees the other */
+        pthread_mutex_lock(&s->lock);
+        atomic_fetch_add(&s->sleeping, 1);
+        while (atomic_load(&s->queued) == 0 && !atomic_load(&s->quit))
+        {
+            pthread_cond_wait(&s->wake, &s->lock);
+        }
+        atomic_fetch_sub(&s->sleeping, 1);
+        pthread_mutex_unlock(&s->lock);
+    }
+    return NULL;
+}
+
+/*
+ * Function to Start a Job System
+ *
+ * A worker count of 0 means one per core. The calling thread becomes
+ * worker 0. Returns -1 if the workers cannot be allocated; if some threads
+ * fail to start, the system runs with the ones that did.
+ */
+int jobs_init(JobSystem *s, unsigned workers)
+{
+    unsigned i;
+
+    if (workers == 0)
+    {
+        const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cores > 0 ? (unsigned)cores : 1;
+    }
+    if (workers > JOBS_MAX_WORKERS)
+    {
+        workers = JOBS_MAX_WORKERS;
+    }
+    s->workers = aligned_buffer_alloc(sizeof(JobWorker) * workers, SIMD_CACHE_LINE);
+    if (!s->workers)
+    {
+        return -1;
+    }
+    s->count = workers;
+    atomic_init(&s->queued, 0);
+    atomic_init(&s->sleeping, 0);
+    atomic_init(&s->quit, 0);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->wake, NULL);
+    for (i = 0; i < workers; i++)
+    {
+        JobWorker *w = &s->workers[i];
+        unsigned j;
+        atomic_init(&w->deque.top, 0);
+        atomic_init(&w->deque.bottom, 0);
+        for (j = 0; j < JOBS_DEQUE_CAPACITY; j++)
+        {
+            atomic_init(&w->deque.slots[j], NULL);
+        }
+        w->system = s;
+        w->index = i;
+        w->rng = 0x9E3779B9U * (i + 1);
+    }
+    current_ = &s->workers[0];
+    for (i = 1; i < workers; i++)
+    {
+        if (pthread_create(&s->workers[i].thread, NULL, worker_main_, &s->workers[i]) != 0)
+        {
+            s->count = i;
+            break;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function to Queue a Job
+ *
+ * The job goes on the calling worker's deque, where idle workers can steal
+ * it. From a thread that is not one of this system's workers, or when the
+ * deque is full, the job runs right away instead.
+ */
+void jobs_submit(JobSystem *s, Job *job)
+{
+    JobWorker *w = current_;
+
+    if (job->counter)
+    {
+        atomic_fetch_add_explicit(&job->counter->pending, 1, memory_order_relaxed);
+    }
+    if (!w || w->system != s)
+    {
+        run_job_(job);
+        return;
+    }
+    atomic_fetch_add(&s->queued, 1);
+    if (!deque_push_(&w->deque, job))
+    {
+        atomic_fetch_sub(&s->queued, 1);
+        run_job_(job);
+        return;
+    }
+    if (atomic_load(&s->sleeping) > 0)
+    {
+        pthread_mutex_lock(&s->lock);
+        pthread_cond_signal(&s->wake);
+        pthread_mutex_unlock(&s->lock);
+    }
+}
+
+/*
+ * Function to Wait for a Counter to Reach Zero
+ *
+ * A worker runs queued jobs, its own or stolen, while it waits.
+ */
+void jobs_wait(JobSystem *s, JobCounter *counter)
+{
+    JobWorker *w = current_ && current_->system == s ? current_ : NULL;
+
+    while (atomic_load_explicit(&counter->pending, memory_order_acquire) != 0)
+    {
+        Job *job = w ? find_job_(w) : NULL;
+        if (job)
+        {
+            run_job_(job);
+        }
+        else
+        {
+            cpu_relax_();
+        }
+    }
+}
+
+/*
+ * Structure to Hold One Range of a Parallel For
+ */
+typedef struct
+{
+    JobRangeFn fn; /* Range function */
+    void *arg;     /* Its argument */
+    size_t begin;  /* First index */
+    size_t end;    /* One past the last index */
+} JobRange_;
+
+/*
+ * Function to Run One Range of a Parallel For
+ */
+static void run_range_(void *arg)
+{
+    const JobRange_ *r = (const JobRange_ *)arg;
+
+    r->fn(r->arg, r->begin, r->end);
+}
+
+/*
+ * Function to Run a Range Function Over [0, count) in Parallel
+ *
+ * The range is split into chunks of grain indices (0 picks four chunks per
+ * worker), at most 256 of them, and returns once every chunk has run. The
+ * calling thread runs the first chunk itself.
+ */
+void jobs_parallel_for(JobSystem *s, size_t count, size_t grain, JobRangeFn fn, void *arg)
+{
+    JobRange_ ranges[JOBS_MAX_CHUNKS_];
+    Job jobs[JOBS_MAX_CHUNKS_];
+    JobCounter counter;
+    size_t chunks;
+    size_t i;
+
+    if (count == 0)
+    {
+        return;
+    }
+    if (grain == 0)
+    {
+        grain = (count + s->count * 4 - 1) / (s->count * 4);
+    }
+    if (grain < (count + JOBS_MAX_CHUNKS_ - 1) / JOBS_MAX_CHUNKS_)
+    {
+        grain = (count + JOBS_MAX_CHUNKS_ - 1) / JOBS_MAX_CHUNKS_;
+    }
+    chunks = (count + grain - 1) / grain;
+    atomic_init(&counter.pending, 0);
+    for (i = chunks; i-- > 1;)
+    {
+        ranges[i].fn = fn;
+        ranges[i].arg = arg;
+        ranges[i].begin = i * grain;
+        ranges[i].end = i * grain + grain < count ? i * grain + grain : count;
+        jobs[i].fn = run_range_;
+        jobs[i].arg = &ranges[i];
+        jobs[i].counter = &counter;
+        jobs_submit(s, &jobs[i]);
+    }
+    fn(arg, 0, grain < count ? grain : count);
+    jobs_wait(s, &counter);
+}
+
+/*
+ * Function to Get the Calling Thread's Worker Number
+ *
+ * Returns 0 on threads that are not workers.
+ */
+unsigned jobs_worker_index(void)
+{
+    return current_ ? current_->index : 0;
+}
+
+/*
+ * Function to Stop a Job System
+ *
+ * Every submitted job must have finished; wait for their counters first.
+ */
+void jobs_destroy(JobSystem *s)
+{
+    unsigned i;
+
+    atomic_store(&s->quit, 1);
+    pthread_mutex_lock(&s->lock);
+    pthread_cond_broadcast(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+    for (i = 1; i < s->count; i++)
+    {
+        pthread_join(s->workers[i].thread, NULL);
+    }
+    if (current_ && current_->system == s)
+    {
+        current_ = NULL;
+    }
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->wake);
+    aligned_buffer_free(s->workers);
+    s->workers = NULL;
+    s->count = 0;
+}
@@ -0,0 +1,96 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JOBS_DEQUE_CAPACITY 4096U /* Jobs one worker can queue (power of two) */
+#define JOBS_MAX_WORKERS 64U      /* Most workers, counting the creating thread */
+#define JOBS_SPIN 256U            /* Failed searches before a worker sleeps */
+
+/* Job function */
+typedef void (*JobFn)(void *arg);
+
+/* Range function for jobs_parallel_for: handles indices [begin, end) */
+typedef void (*JobRangeFn)(void *arg, size_t begin, size_t end);
+
+/*
+ * Structure to Count Unfinished Jobs
+ *
+ * Every job submitted with a counter adds one to it and takes one off when
+ * it finishes; jobs_wait returns once it reaches zero.
+ */
+typedef struct
+{
+    atomic_size_t pending; /* Jobs submitted and not yet finished */
+} JobCounter;
+
+/*
+ * Structure to Hold a Job
+ *
+ * The caller owns the memory and must keep it alive until the job has run.
+ */
+typedef struct
+{
+    JobFn fn;            /* Function to run */
+    void *arg;           /* Its argument */
+    JobCounter *counter; /* Counter to take one off when done, or NULL */
+} Job;
+
+/*
+ * Structure to Hold One Worker's Deque
+ *
+ * A Chase-Lev work-stealing deque: the owner pushes and pops jobs at the
+ * bottom, newest first, while other workers steal from the top, oldest
+ * first. The two ends sit on separate cache lines.
+ */
+typedef struct
+{
+    _Alignas(64) atomic_int_fast64_t top;    /* Next job to steal */
+    _Alignas(64) atomic_int_fast64_t bottom; /* Next free slot */
+    _Alignas(64) _Atomic(Job *) slots[JOBS_DEQUE_CAPACITY];
+} JobDeque;
+
+struct JobSystem;
+
+/*
+ * Structure to Hold One Worker
+ */
+typedef struct
+{
+    JobDeque deque;           /* Jobs this worker queued */
+    struct JobSystem *system; /* Owning job system */
+    pthread_t thread;         /* Thread handle, unused for worker 0 */
+    unsigned index;           /* Worker number; 0 is the creating thread */
+    uint32_t rng;             /* Picks steal victims */
+} JobWorker;
+
+/*
+ * Structure to Hold a Job System
+ *
+ * A job system of n workers is n - 1 threads plus the thread that created
+ * it, which runs jobs while it waits in jobs_wait. Jobs may be submitted
+ * from that thread and from inside jobs. Idle workers look for work to
+ * steal for a while, then sleep until a job is queued.
+ */
+typedef struct JobSystem
+{
+    JobWorker *workers;     /* All workers, worker 0 first */
+    unsigned count;         /* Number of workers */
+    atomic_size_t queued;   /* Jobs sitting in deques */
+    atomic_uint sleeping;   /* Workers asleep or about to sleep */
+    atomic_int quit;        /* Set to stop the threads */
+    pthread_mutex_t lock;   /* Protects sleeping workers' waits */
+    pthread_cond_t wake;    /* Signalled when a job is queued */
+} JobSystem;
+
+int jobs_init(JobSystem *s, unsigned workers);
+void jobs_submit(JobSystem *s, Job *job);
+void jobs_wait(JobSystem *s, JobCounter *counter);
+void jobs_parallel_for(JobSystem *s, size_t count, size_t grain, JobRangeFn fn, void *arg);
+unsigned jobs_worker_index(void);
+void jobs_destroy(JobSystem *s);
+
+#endif /* JOBS_H */
@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "bench.h"
+#include "jobs.h"
+#include "pool.h"
+#include "simd.h"
+
+#define DEMO_OBJECTS 64U           /* Allocations per allocator benchmark iteration */
+#define DEMO_OBJECT_SIZE 48U       /* Bytes per allocation */
+#define DEMO_ELEMENTS (1U << 20)   /* Floats in the sum and dot product arrays */
+
+/*
+ * Structure to Hold One Worker's Partial Sum
+ *
+ * Padded to a cache line so workers do not write to the same line.
+ */
+typedef struct
+{
+    _Alignas(SIMD_CACHE_LINE) double sum;
+} PartialSum;
+
+/*
+ * Structure to Hold the Parallel Sum's Input and Results
+ */
+typedef struct
+{
+    const float *values;                    /* Array to sum */
+    PartialSum partial[JOBS_MAX_WORKERS];   /* One sum per worker */
+} SumTask;
+
+/*
+ * Function to Add One Range of the Array to the Running Worker's Sum
+ */
+static void sum_range(void *arg, size_t begin, size_t end)
+{
+    SumTask *task = (SumTask *)arg;
+    double sum = 0.0;
+    size_t i;
+
+    for (i = begin; i < end; i++)
+    {
+        sum += task->values[i];
+    }
+    task->partial[jobs_worker_index()].sum += sum;
+}
+
+/*
+ * Function to Sum an Array With the Job System
+ */
+static double parallel_sum(JobSystem *jobs, SumTask *task, size_t n)
+{
+    double sum = 0.0;
+    unsigned i;
+
+    for (i = 0; i < jobs->count; i++)
+    {
+        task->partial[i].sum = 0.0;
+    }
+    jobs_parallel_for(jobs, n, 0, sum_range, task);
+    for (i = 0; i < jobs->count; i++)
+    {
+        sum += task->partial[i].sum;
+    }
+    return sum;
+}
+
+/*
+ * Function to Compute a Dot Product One Element at a Time
+ */
+static float scalar_dot(const float *a, const float *b, size_t n)
+{
+    float sum = 0.0f;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+/*
+ * Function to Time Allocating and Releasing Small Blocks
+ */
+static int bench_allocators(void)
+{
+    void *blocks[DEMO_OBJECTS];
+    Arena arena;
+    Pool pool;
+    Bench b;
+    unsigned i;
+
+    if (arena_init(&arena, DEMO_OBJECTS * DEMO_OBJECT_SIZE * 2) != 0 ||
+        pool_init(&pool, DEMO_OBJECT_SIZE, 16, DEMO_OBJECTS) != 0)
+    {
+        fprintf(stderr, "Error: cannot create the allocators\n");
+        return -1;
+    }
+
+    bench_init(&b, "malloc + free");
+    BENCH_LOOP(&b)
+    {
+        for (i = 0; i < DEMO_OBJECTS; i++)
+        {
+            blocks[i] = malloc(DEMO_OBJECT_SIZE);
+            bench_do_not_optimize(blocks[i]);
+        }
+        for (i = 0; i < DEMO_OBJECTS; i++)
+        {
+            free(blocks[i]);
+        }
+    }
+    bench_print(&b);
+
+    bench_init(&b, "arena_alloc + reset");
+    BENCH_LOOP(&b)
+    {
+        for (i = 0; i < DEMO_OBJECTS; i++)
+        {
+            blocks[i] = arena_alloc(&arena, DEMO_OBJECT_SIZE, 16);
+            bench_do_not_optimize(blocks[i]);
+        }
+        arena_reset(&arena);
+    }
+    bench_print(&b);
+
+    bench_init(&b, "pool_alloc + pool_free");
+    BENCH_LOOP(&b)
+    {
+        for (i = 0; i < DEMO_OBJECTS; i++)
+        {
+            blocks[i] = pool_alloc(&pool);
+            bench_do_not_optimize(blocks[i]);
+        }
+        for (i = 0; i < DEMO_OBJECTS; i++)
+        {
+            pool_free(&pool, blocks[i]);
+        }
+    }
+    bench_print(&b);
+
+    pool_destroy(&pool);
+    arena_destroy(&arena);
+    return 0;
+}
+
+/*
+ * Function to Time the Array Sum and Dot Product Serially, in Parallel and With SIMD
+ */
+static int bench_arrays(JobSystem *jobs)
+{
+    float *a = aligned_buffer_alloc(DEMO_ELEMENTS * sizeof(float), SIMD_ALIGN);
+    float *c = aligned_buffer_alloc(DEMO_ELEMENTS * sizeof(float), SIMD_ALIGN);
+    SumTask *task = aligned_buffer_alloc(sizeof(SumTask), SIMD_CACHE_LINE);
+    char name[32];
+    Bench b;
+    size_t i;
+
+    if (!a || !c || !task)
+    {
+        fprintf(stderr, "Error: cannot allocate the arrays\n");
+        aligned_buffer_free(a);
+        aligned_buffer_free(c);
+        aligned_buffer_free(task);
+        return -1;
+    }
+    for (i = 0; i < DEMO_ELEMENTS; i++)
+    {
+        a[i] = (float)(i % 7) * 0.5f;
+        c[i] = (float)(i % 5) * 0.25f;
+    }
+    task->values = a;
+
+    bench_init(&b, "sum, 1 thread");
+    BENCH_LOOP(&b)
+    {
+        double sum = 0.0;
+        for (i = 0; i < DEMO_ELEMENTS; i++)
+        {
+            sum += a[i];
+        }
+        bench_do_not_optimize(sum);
+    }
+    bench_print(&b);
+
+    snprintf(name, sizeof(name), "sum, %u workers", jobs->count);
+    bench_init(&b, name);
+    BENCH_LOOP(&b)
+    {
+        bench_do_not_optimize(parallel_sum(jobs, task, DEMO_ELEMENTS));
+    }
+    bench_print(&b);
+
+    bench_init(&b, "dot, scalar");
+    BENCH_LOOP(&b)
+    {
+        bench_do_not_optimize(scalar_dot(a, c, DEMO_ELEMENTS));
+    }
+    bench_print(&b);
+
+    bench_init(&b, "dot, simd");
+    BENCH_LOOP(&b)
+    {
+        bench_do_not_optimize(simd_dot_f32(a, c, DEMO_ELEMENTS));
+    }
+    bench_print(&b);
+
+    /* The parallel and SIMD versions add in a different order */
+    printf("\nsum %.1f, dot %.1f (simd %.1f)\n", parallel_sum(jobs, task, DEMO_ELEMENTS),
+           (double)scalar_dot(a, c, DEMO_ELEMENTS), (double)simd_dot_f32(a, c, DEMO_ELEMENTS));
+
+    aligned_buffer_free(a);
+    aligned_buffer_free(c);
+    aligned_buffer_free(task);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    JobSystem jobs;
+    unsigned workers = 0;
+    int status;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            workers = (unsigned)strtoul(argv[++i], NULL, 10);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [-j workers]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (jobs_init(&jobs, workers) != 0)
+    {
+        fprintf(stderr, "Error: cannot start the job system\n");
+        return 1;
+    }
+
+    printf("Welcome to {{PROJECT_NAME}}! Timing %u small allocations and %u-element arrays with %u workers.\n\n",
+           DEMO_OBJECTS, DEMO_ELEMENTS, jobs.count);
+    status = bench_allocators() == 0 && bench_arrays(&jobs) == 0 ? 0 : 1;
+
+    jobs_destroy(&jobs);
+    return status;
+}
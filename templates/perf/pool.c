@@ -0,0 +1,98 @@
+#include "pool.h"
+
+#include <stdint.h>
+
+#include "simd.h"
+
+/*
+ * Function to Create a Pool
+ *
+ * Slots are at least pointer-sized and aligned to align, a power of two
+ * (pointer alignment at least). Returns -1 if the block cannot be allocated.
+ */
+int pool_init(Pool *p, size_t slot_size, size_t align, size_t capacity)
+{
+    if (align < sizeof(void *))
+    {
+        align = sizeof(void *);
+    }
+    if (slot_size < sizeof(void *))
+    {
+        slot_size = sizeof(void *);
+    }
+    p->slot_size = (slot_size + align - 1) & ~(align - 1);
+    p->capacity = capacity;
+    p->free_list = NULL;
+    p->fresh = 0;
+    p->used = 0;
+    p->slots = NULL;
+    if (capacity > SIZE_MAX / p->slot_size)
+    {
+        return -1;
+    }
+    p->slots = aligned_buffer_alloc(p->slot_size * capacity, align > SIMD_CACHE_LINE ? align : SIMD_CACHE_LINE);
+    return p->slots || capacity == 0 ? 0 : -1;
+}
+
+/*
+ * Function to Take a Slot From a Pool
+ *
+ * Reuses the most recently freed slot, which is the likeliest to still be
+ * in cache. Returns NULL when every slot is in use.
+ */
+void *pool_alloc(Pool *p)
+{
+    void *slot = p->free_list;
+
+    if (slot)
+    {
+        p->free_list = *(void **)slot;
+    }
+    else if (p->fresh < p->capacity)
+    {
+        slot = p->slots + p->fresh++ * p->slot_size;
+    }
+    else
+    {
+        return NULL;
+    }
+    p->used++;
+    return slot;
+}
+
+/*
+ * Function to Return a Slot to a Pool
+ */
+void pool_free(Pool *p, void *slot)
+{
+    if (slot)
+    {
+        *(void **)slot = p->free_list;
+        p->free_list = slot;
+        p->used--;
+    }
+}
+
+/*
+ * Function to Check Whether a Pointer Is a Slot of a Pool
+ */
+int pool_owns(const Pool *p, const void *slot)
+{
+    const uintptr_t start = (uintptr_t)p->slots;
+    const uintptr_t address = (uintptr_t)slot;
+
+    return address >= start && address < start + p->fresh * p->slot_size && (address - start) % p->slot_size == 0;
+}
+
+/*
+ * Function to Release a Pool's Block
+ */
+void pool_destroy(Pool *p)
+{
+    aligned_buffer_free(p->slots);
+    p->slots = NULL;
+    p->free_list = NULL;
+    p->capacity = 0;
+    p->fresh = 0;
+    p->used = 0;
+}
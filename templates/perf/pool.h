@@ -0,0 +1,30 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/*
+ * Structure to Hold a Fixed-Size Pool Allocator
+ *
+ * A pool hands out slots of one size from a single block. Freed slots are
+ * kept on a list threaded through the slots themselves, and slots that were
+ * never used are handed out in order, so creating a pool does not touch its
+ * memory and both pool_alloc and pool_free take constant time.
+ */
+typedef struct
+{
+    unsigned char *slots; /* Slot storage */
+    void *free_list;      /* Most recently freed slot, or NULL */
+    size_t slot_size;     /* Bytes per slot, rounded up to the alignment */
+    size_t capacity;      /* Number of slots */
+    size_t fresh;         /* Slots handed out at least once */
+    size_t used;          /* Slots handed out now */
+} Pool;
+
+int pool_init(Pool *p, size_t slot_size, size_t align, size_t capacity);
+void *pool_alloc(Pool *p);
+void pool_free(Pool *p, void *slot);
+int pool_owns(const Pool *p, const void *slot);
+void pool_destroy(Pool *p);
+
+#endif /* POOL_H */
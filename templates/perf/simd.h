@@ -0,0 +1,272 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * SIMD Configuration
+ *
+ * F32x4 is four floats in one vector register: SSE on x86, NEON on ARM, and
+ * a plain struct elsewhere, so code written against these helpers builds
+ * everywhere and vectorizes where it can. Buffers from aligned_buffer_alloc
+ * are aligned for the widest loads on either.
+ */
+#define SIMD_CACHE_LINE 64U /* Bytes per cache line */
+#define SIMD_ALIGN 64U      /* Default alignment of SIMD buffers */
+#define SIMD_LANES 4U       /* Floats per F32x4 */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE 1
+typedef __m128 F32x4;
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+typedef float32x4_t F32x4;
+#else
+#define SIMD_SCALAR 1
+typedef struct
+{
+    float v[4];
+} F32x4;
+#endif
+
+/*
+ * Function to Allocate an Aligned Buffer
+ *
+ * The alignment must be a power of two; the size is rounded up to a whole
+ * number of alignments. Free the buffer with aligned_buffer_free.
+ */
+static inline void *aligned_buffer_alloc(size_t size, size_t align)
+{
+    if (align < sizeof(void *))
+    {
+        align = sizeof(void *);
+    }
+    if (size > SIZE_MAX - align)
+    {
+        return NULL;
+    }
+    size = size ? (size + align - 1) & ~(align - 1) : align;
+#if defined(_WIN32)
+    return _aligned_malloc(size, align);
+#else
+    return aligned_alloc(align, size);
+#endif
+}
+
+/*
+ * Function to Free an Aligned Buffer
+ */
+static inline void aligned_buffer_free(void *p)
+{
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+/*
+ * Four-Lane Float Operations
+ *
+ * Aligned loads and stores need 16-byte aligned addresses; the u variants
+ * take any address. f32x4_madd computes a * b + c.
+ */
+#if SIMD_SSE
+static inline F32x4 f32x4_load(const float *p) { return _mm_load_ps(p); }
+static inline F32x4 f32x4_loadu(const float *p) { return _mm_loadu_ps(p); }
+static inline void f32x4_store(float *p, F32x4 a) { _mm_store_ps(p, a); }
+static inline void f32x4_storeu(float *p, F32x4 a) { _mm_storeu_ps(p, a); }
+static inline F32x4 f32x4_splat(float x) { return _mm_set1_ps(x); }
+static inline F32x4 f32x4_add(F32x4 a, F32x4 b) { return _mm_add_ps(a, b); }
+static inline F32x4 f32x4_sub(F32x4 a, F32x4 b) { return _mm_sub_ps(a, b); }
+static inline F32x4 f32x4_mul(F32x4 a, F32x4 b) { return _mm_mul_ps(a, b); }
+static inline F32x4 f32x4_madd(F32x4 a, F32x4 b, F32x4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+static inline F32x4 f32x4_min(F32x4 a, F32x4 b) { return _mm_min_ps(a, b); }
+static inline F32x4 f32x4_max(F32x4 a, F32x4 b) { return _mm_max_ps(a, b); }
+static inline float f32x4_hsum(F32x4 a)
+{
+    const F32x4 pairs = _mm_add_ps(a, _mm_movehl_ps(a, a));
+    return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+}
+#elif SIMD_NEON
+static inline F32x4 f32x4_load(const float *p) { return vld1q_f32(p); }
+static inline F32x4 f32x4_loadu(const float *p) { return vld1q_f32(p); }
+static inline void f32x4_store(float *p, F32x4 a) { vst1q_f32(p, a); }
+static inline void f32x4_storeu(float *p, F32x4 a) { vst1q_f32(p, a); }
+static inline F32x4 f32x4_splat(float x) { return vdupq_n_f32(x); }
+static inline F32x4 f32x4_add(F32x4 a, F32x4 b) { return vaddq_f32(a, b); }
+static inline F32x4 f32x4_sub(F32x4 a, F32x4 b) { return vsubq_f32(a, b); }
+static inline F32x4 f32x4_mul(F32x4 a, F32x4 b) { return vmulq_f32(a, b); }
+static inline F32x4 f32x4_madd(F32x4 a, F32x4 b, F32x4 c) { return vaddq_f32(vmulq_f32(a, b), c); }
+static inline F32x4 f32x4_min(F32x4 a, F32x4 b) { return vminq_f32(a, b); }
+static inline F32x4 f32x4_max(F32x4 a, F32x4 b) { return vmaxq_f32(a, b); }
+static inline float f32x4_hsum(F32x4 a)
+{
+    const float32x2_t pairs = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+    return vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+}
+#else
+static inline F32x4 f32x4_loadu(const float *p)
+{
+    F32x4 r;
+    r.v[0] = p[0];
+    r.v[1] = p[1];
+    r.v[2] = p[2];
+    r.v[3] = p[3];
+    return r;
+}
+static inline F32x4 f32x4_load(const float *p) { return f32x4_loadu(p); }
+static inline void f32x4_storeu(float *p, F32x4 a)
+{
+    p[0] = a.v[0];
+    p[1] = a.v[1];
+    p[2] = a.v[2];
+    p[3] = a.v[3];
+}
+static inline void f32x4_store(float *p, F32x4 a) { f32x4_storeu(p, a); }
+static inline F32x4 f32x4_splat(float x)
+{
+    F32x4 r = {{x, x, x, x}};
+    return r;
+}
+#define SIMD_LANEWISE_(name, expr)                \
+    static inline F32x4 name(F32x4 a, F32x4 b)    \
+    {                                             \
+        F32x4 r;                                  \
+        int i;                                    \
+        for (i = 0; i < 4; i++)                   \
+        {                                         \
+            r.v[i] = (expr);                      \
+        }                                         \
+        return r;                                 \
+    }
+SIMD_LANEWISE_(f32x4_add, a.v[i] + b.v[i])
+SIMD_LANEWISE_(f32x4_sub, a.v[i] - b.v[i])
+SIMD_LANEWISE_(f32x4_mul, a.v[i] * b.v[i])
+SIMD_LANEWISE_(f32x4_min, b.v[i] < a.v[i] ? b.v[i] : a.v[i])
+SIMD_LANEWISE_(f32x4_max, b.v[i] > a.v[i] ? b.v[i] : a.v[i])
+#undef SIMD_LANEWISE_
+static inline F32x4 f32x4_madd(F32x4 a, F32x4 b, F32x4 c) { return f32x4_add(f32x4_mul(a, b), c); }
+static inline float f32x4_hsum(F32x4 a) { return (a.v[0] + a.v[2]) + (a.v[1] + a.v[3]); }
+#endif
+
+/*
+ * Function to Add Two Float Arrays: dst[i] = a[i] + b[i]
+ */
+static inline void simd_add_f32(float *dst, const float *a, const float *b, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + SIMD_LANES <= n; i += SIMD_LANES)
+    {
+        f32x4_storeu(dst + i, f32x4_add(f32x4_loadu(a + i), f32x4_loadu(b + i)));
+    }
+    for (; i < n; i++)
+    {
+        dst[i] = a[i] + b[i];
+    }
+}
+
+/*
+ * Function to Scale and Add a Float Array: y[i] += a * x[i]
+ */
+static inline void simd_axpy_f32(float *y, float a, const float *x, size_t n)
+{
+    const F32x4 va = f32x4_splat(a);
+    size_t i = 0;
+
+    for (; i + SIMD_LANES <= n; i += SIMD_LANES)
+    {
+        f32x4_storeu(y + i, f32x4_madd(va, f32x4_loadu(x + i), f32x4_loadu(y + i)));
+    }
+    for (; i < n; i++)
+    {
+        y[i] += a * x[i];
+    }
+}
+
+/*
+ * Function to Compute the Dot Product of Two Float Arrays
+ *
+ * Two accumulators hide the latency of the adds, so the result can differ
+ * from a sequential sum in the last bits.
+ */
+static inline float simd_dot_f32(const float *a, const float *b, size_t n)
+{
+    F32x4 acc0 = f32x4_splat(0.0f);
+    F32x4 acc1 = f32x4_splat(0.0f);
+    float sum;
+    size_t i = 0;
+
+    for (; i + 2 * SIMD_LANES <= n; i += 2 * SIMD_LANES)
+    {
+        acc0 = f32x4_madd(f32x4_loadu(a + i), f32x4_loadu(b + i), acc0);
+        acc1 = f32x4_madd(f32x4_loadu(a + i + SIMD_LANES), f32x4_loadu(b + i + SIMD_LANES), acc1);
+    }
+    for (; i + SIMD_LANES <= n; i += SIMD_LANES)
+    {
+        acc0 = f32x4_madd(f32x4_loadu(a + i), f32x4_loadu(b + i), acc0);
+    }
+    sum = f32x4_hsum(f32x4_add(acc0, acc1));
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+/*
+ * Function to Find the Smallest and Largest Values of a Float Array
+ *
+ * Leaves *lo and *hi untouched when n is 0.
+ */
+static inline void simd_minmax_f32(const float *a, size_t n, float *lo, float *hi)
+{
+    float lanes[SIMD_LANES];
+    F32x4 vlo;
+    F32x4 vhi;
+    size_t i;
+    float l;
+    float h;
+
+    if (n == 0)
+    {
+        return;
+    }
+    l = h = a[0];
+    if (n >= SIMD_LANES)
+    {
+        vlo = vhi = f32x4_loadu(a);
+        for (i = SIMD_LANES; i + SIMD_LANES <= n; i += SIMD_LANES)
+        {
+            const F32x4 v = f32x4_loadu(a + i);
+            vlo = f32x4_min(vlo, v);
+            vhi = f32x4_max(vhi, v);
+        }
+        f32x4_storeu(lanes, vlo);
+        l = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+        l = lanes[2] < l ? lanes[2] : l;
+        l = lanes[3] < l ? lanes[3] : l;
+        f32x4_storeu(lanes, vhi);
+        h = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+        h = lanes[2] > h ? lanes[2] : h;
+        h = lanes[3] > h ? lanes[3] : h;
+    }
+    else
+    {
+        i = 1;
+    }
+    for (; i < n; i++)
+    {
+        l = a[i] < l ? a[i] : l;
+        h = a[i] > h ? a[i] : h;
+    }
+    *lo = l;
+    *hi = h;
+}
+
+#endif /* SIMD_H */
@@ -0,0 +1,72 @@
+#include "test.h"
+
+#include "arena.h"
+
+TEST(arena_alignment)
+{
+    Arena a;
+    size_t align;
+
+    c_assert_int_eq(0, arena_init(&a, 4096));
+    for (align = 1; align <= 256; align *= 2)
+    {
+        unsigned char *p = arena_alloc(&a, 3, align);
+        c_assert_true(p != NULL);
+        c_assert_size_eq((size_t)0, (size_t)((uintptr_t)p % align));
+    }
+    arena_destroy(&a);
+}
+
+TEST(arena_exhaustion)
+{
+    Arena a;
+
+    c_assert_int_eq(0, arena_init(&a, 64));
+    c_assert_true(arena_alloc(&a, 48, 1) != NULL);
+    c_assert_true(arena_alloc(&a, 17, 1) == NULL);
+    c_assert_true(arena_alloc(&a, 16, 1) != NULL);
+    c_assert_true(arena_alloc(&a, 1, 1) == NULL);
+    c_assert_true(arena_alloc(&a, SIZE_MAX, 1) == NULL);
+    arena_destroy(&a);
+}
+
+TEST(arena_mark_and_rewind)
+{
+    Arena a;
+    size_t mark;
+    void *first;
+
+    c_assert_int_eq(0, arena_init(&a, 1024));
+    c_assert_true(arena_alloc(&a, 100, 8) != NULL);
+    mark = arena_mark(&a);
+    first = arena_alloc(&a, 200, 8);
+    c_assert_true(first != NULL);
+    arena_rewind(&a, mark);
+    c_assert_size_eq(mark, arena_mark(&a));
+    c_assert_true(first == arena_alloc(&a, 200, 8));
+    arena_reset(&a);
+    c_assert_size_eq((size_t)0, arena_mark(&a));
+    arena_destroy(&a);
+}
+
+TEST(arena_calloc_zeroes_and_checks_overflow)
+{
+    unsigned char buffer[256];
+    unsigned char *p;
+    Arena a;
+    int i;
+
+    memset(buffer, 0xAA, sizeof(buffer));
+    arena_init_buffer(&a, buffer, sizeof(buffer));
+    p = arena_calloc(&a, 16, 8, 1);
+    c_assert_true(p != NULL);
+    for (i = 0; i < 128; i++)
+    {
+        c_assert_int_eq(0, p[i]);
+    }
+    c_assert_true(arena_calloc(&a, SIZE_MAX / 2, 4, 1) == NULL);
+    arena_destroy(&a);
+    c_assert_int_eq(0xAA, buffer[200]);
+}
+
+TEST_MAIN()
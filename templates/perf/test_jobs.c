@@ -0,0 +1,164 @@
+#include "test.h"
+
+#include "jobs.h"
+
+#define TEST_JOBS_WORKERS 4U
+#define TEST_JOBS_COUNT 10000U /* More than one deque holds */
+
+static void increment(void *arg)
+{
+    atomic_fetch_add((atomic_uint *)arg, 1);
+}
+
+TEST(jobs_run_every_submitted_job)
+{
+    static Job jobs[TEST_JOBS_COUNT];
+    atomic_uint runs;
+    JobCounter counter;
+    JobSystem s;
+    unsigned i;
+
+    atomic_init(&runs, 0);
+    atomic_init(&counter.pending, 0);
+    c_assert_int_eq(0, jobs_init(&s, TEST_JOBS_WORKERS));
+    for (i = 0; i < TEST_JOBS_COUNT; i++)
+    {
+        jobs[i].fn = increment;
+        jobs[i].arg = &runs;
+        jobs[i].counter = &counter;
+        jobs_submit(&s, &jobs[i]);
+    }
+    jobs_wait(&s, &counter);
+    c_assert_uint_eq(TEST_JOBS_COUNT, atomic_load(&runs));
+    jobs_destroy(&s);
+}
+
+/* A job that submits more jobs and waits for them */
+typedef struct
+{
+    JobSystem *system;
+    atomic_uint *leaves;
+    int depth;
+} TreeJob;
+
+static void tree(void *arg)
+{
+    TreeJob *t = (TreeJob *)arg;
+    TreeJob children[2];
+    Job jobs[2];
+    JobCounter counter;
+    int i;
+
+    if (t->depth == 0)
+    {
+        atomic_fetch_add(t->leaves, 1);
+        return;
+    }
+    atomic_init(&counter.pending, 0);
+    for (i = 0; i < 2; i++)
+    {
+        children[i].system = t->system;
+        children[i].leaves = t->leaves;
+        children[i].depth = t->depth - 1;
+        jobs[i].fn = tree;
+        jobs[i].arg = &children[i];
+        jobs[i].counter = &counter;
+        jobs_submit(t->system, &jobs[i]);
+    }
+    jobs_wait(t->system, &counter);
+}
+
+TEST(jobs_can_submit_and_wait_for_jobs)
+{
+    atomic_uint leaves;
+    TreeJob root;
+    JobSystem s;
+
+    atomic_init(&leaves, 0);
+    c_assert_int_eq(0, jobs_init(&s, TEST_JOBS_WORKERS));
+    root.system = &s;
+    root.leaves = &leaves;
+    root.depth = 12;
+    tree(&root);
+    c_assert_uint_eq(1U << 12, atomic_load(&leaves));
+    jobs_destroy(&s);
+}
+
+/* Counts how often each index is visited and which workers ran ranges */
+typedef struct
+{
+    atomic_uchar *visits;
+    atomic_uint bad_worker;
+} ForTask;
+
+static void visit(void *arg, size_t begin, size_t end)
+{
+    ForTask *task = (ForTask *)arg;
+    size_t i;
+
+    if (jobs_worker_index() >= TEST_JOBS_WORKERS)
+    {
+        atomic_fetch_add(&task->bad_worker, 1);
+    }
+    for (i = begin; i < end; i++)
+    {
+        atomic_fetch_add(&task->visits[i], 1);
+    }
+}
+
+TEST(jobs_parallel_for_visits_each_index_once)
+{
+    static const size_t counts[] = {1, 7, 1000, 100003};
+    static const size_t grains[] = {0, 1, 64, 5000};
+    ForTask task;
+    JobSystem s;
+    size_t c;
+    size_t g;
+    size_t i;
+
+    c_assert_int_eq(0, jobs_init(&s, TEST_JOBS_WORKERS));
+    task.visits = malloc(100003 * sizeof(*task.visits));
+    c_assert_true(task.visits != NULL);
+    for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        for (g = 0; g < sizeof(grains) / sizeof(grains[0]); g++)
+        {
+            for (i = 0; i < counts[c]; i++)
+            {
+                atomic_init(&task.visits[i], 0);
+            }
+            atomic_init(&task.bad_worker, 0);
+            jobs_parallel_for(&s, counts[c], grains[g], visit, &task);
+            for (i = 0; i < counts[c]; i++)
+            {
+                c_assert_int_eq(1, atomic_load(&task.visits[i]));
+            }
+            c_assert_uint_eq(0U, atomic_load(&task.bad_worker));
+        }
+    }
+    free(task.visits);
+    jobs_destroy(&s);
+}
+
+TEST(jobs_single_worker_runs_everything_itself)
+{
+    atomic_uint runs;
+    JobCounter counter;
+    JobSystem s;
+    Job job;
+
+    atomic_init(&runs, 0);
+    atomic_init(&counter.pending, 0);
+    c_assert_int_eq(0, jobs_init(&s, 1));
+    c_assert_uint_eq(1U, s.count);
+    job.fn = increment;
+    job.arg = &runs;
+    job.counter = &counter;
+    jobs_submit(&s, &job);
+    jobs_wait(&s, &counter);
+    c_assert_uint_eq(1U, atomic_load(&runs));
+    c_assert_uint_eq(0U, jobs_worker_index());
+    jobs_destroy(&s);
+}
+
+TEST_MAIN()
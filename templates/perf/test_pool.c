@@ -0,0 +1,61 @@
+#include "test.h"
+
+#include "pool.h"
+
+TEST(pool_fills_and_empties)
+{
+    void *slots[32];
+    Pool p;
+    int i;
+
+    c_assert_int_eq(0, pool_init(&p, 24, 16, 32));
+    for (i = 0; i < 32; i++)
+    {
+        slots[i] = pool_alloc(&p);
+        c_assert_true(slots[i] != NULL);
+        c_assert_size_eq((size_t)0, (size_t)((uintptr_t)slots[i] % 16));
+        c_assert_true(pool_owns(&p, slots[i]));
+        memset(slots[i], 0xFF, 24);
+    }
+    c_assert_true(pool_alloc(&p) == NULL);
+    c_assert_size_eq((size_t)32, p.used);
+    for (i = 0; i < 32; i++)
+    {
+        pool_free(&p, slots[i]);
+    }
+    c_assert_size_eq((size_t)0, p.used);
+    pool_destroy(&p);
+}
+
+TEST(pool_reuses_last_freed_slot)
+{
+    void *a;
+    void *b;
+    Pool p;
+
+    c_assert_int_eq(0, pool_init(&p, 8, 8, 4));
+    a = pool_alloc(&p);
+    b = pool_alloc(&p);
+    pool_free(&p, a);
+    pool_free(&p, b);
+    c_assert_true(b == pool_alloc(&p));
+    c_assert_true(a == pool_alloc(&p));
+    pool_destroy(&p);
+}
+
+TEST(pool_owns_only_its_slots)
+{
+    int outside;
+    unsigned char *slot;
+    Pool p;
+
+    c_assert_int_eq(0, pool_init(&p, 32, 8, 4));
+    slot = pool_alloc(&p);
+    c_assert_true(pool_owns(&p, slot));
+    c_assert_false(pool_owns(&p, slot + 1));
+    c_assert_false(pool_owns(&p, slot + 32));
+    c_assert_false(pool_owns(&p, &outside));
+    pool_destroy(&p);
+}
+
+TEST_MAIN()
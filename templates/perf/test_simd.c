@@ -0,0 +1,60 @@
+#include "test.h"
+
+#include "simd.h"
+
+#define TEST_SIMD_N 1027 /* Not a multiple of the lane count, to reach the tails */
+
+TEST(simd_buffers_are_aligned)
+{
+    void *p = aligned_buffer_alloc(100, SIMD_ALIGN);
+
+    c_assert_true(p != NULL);
+    c_assert_size_eq((size_t)0, (size_t)((uintptr_t)p % SIMD_ALIGN));
+    aligned_buffer_free(p);
+}
+
+TEST(simd_matches_scalar)
+{
+    float *a = aligned_buffer_alloc(TEST_SIMD_N * sizeof(float), SIMD_ALIGN);
+    float *b = aligned_buffer_alloc(TEST_SIMD_N * sizeof(float), SIMD_ALIGN);
+    float *sum = aligned_buffer_alloc(TEST_SIMD_N * sizeof(float), SIMD_ALIGN);
+    double dot = 0.0;
+    float lo;
+    float hi;
+    int i;
+
+    for (i = 0; i < TEST_SIMD_N; i++)
+    {
+        a[i] = (float)(i % 13) - 6.0f;
+        b[i] = (float)(i % 5) * 0.5f;
+        dot += (double)a[i] * b[i];
+    }
+    simd_add_f32(sum, a, b, TEST_SIMD_N);
+    for (i = 0; i < TEST_SIMD_N; i++)
+    {
+        c_assert_float_eq(a[i] + b[i], sum[i], 0.0f);
+    }
+    simd_axpy_f32(sum, -1.0f, b, TEST_SIMD_N);
+    for (i = 0; i < TEST_SIMD_N; i++)
+    {
+        c_assert_float_eq(a[i], sum[i], 0.0f);
+    }
+    c_assert_double_eq(dot, (double)simd_dot_f32(a, b, TEST_SIMD_N), 1e-3);
+    simd_minmax_f32(a, TEST_SIMD_N, &lo, &hi);
+    c_assert_float_eq(-6.0f, lo, 0.0f);
+    c_assert_float_eq(6.0f, hi, 0.0f);
+    aligned_buffer_free(a);
+    aligned_buffer_free(b);
+    aligned_buffer_free(sum);
+}
+
+TEST(simd_handles_short_arrays)
+{
+    const float a[3] = {1.0f, 2.0f, 3.0f};
+    const float b[3] = {4.0f, 5.0f, 6.0f};
+
+    c_assert_float_eq(32.0f, simd_dot_f32(a, b, 3), 0.0f);
+    c_assert_float_eq(0.0f, simd_dot_f32(a, b, 0), 0.0f);
+}
+
+TEST_MAIN()
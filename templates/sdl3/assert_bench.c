@@ -0,0 +1,134 @@
+// Assertion overhead benchmark
+//
+// Times a loop that walks a point around a wrapping grid and reads the cells
+// it visits, once as is and once with assertions checking every step, and
+// compares the two. make bench-assertions builds it at each assertion level
+// and shows the asserted loop's machine code; the program exits with an error
+// if the asserted loop is more than ASSERT_BENCH_TOLERANCE percent slower.
+
+#include <time.h>
+
+#include "assertions.h"
+
+#ifndef ASSERT_BENCH_STEPS
+#define ASSERT_BENCH_STEPS 2000000 // Steps per timed run
+#endif
+
+#ifndef ASSERT_BENCH_RUNS
+#define ASSERT_BENCH_RUNS 50 // Timed runs per loop; the fastest counts
+#endif
+
+#ifndef ASSERT_BENCH_TOLERANCE
+#define ASSERT_BENCH_TOLERANCE 5.0 // Allowed slowdown in percent
+#endif
+
+#define WALK_WIDTH 24  // Grid width in cells
+#define WALK_HEIGHT 14 // Grid height in cells
+
+// Monotonic time in nanoseconds
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint8_t cells[WALK_WIDTH * WALK_HEIGHT]; // Cell types the walk reads
+
+// Walk a point around the grid in random steps, adding up the cells it visits
+__attribute__((noinline)) static uint32_t walk_plain(uint32_t state, int steps)
+{
+  uint32_t sum = 0;
+  int x = 0;
+  int y = 0;
+  int i;
+  for (i = 0; i < steps; i++)
+  {
+    int cell;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    x = (x + (int)(state & 3U) - 1 + WALK_WIDTH) % WALK_WIDTH;
+    y = (y + (int)((state >> 2) & 3U) - 1 + WALK_HEIGHT) % WALK_HEIGHT;
+    cell = cells[y * WALK_WIDTH + x];
+    sum += (uint32_t)cell;
+  }
+  return state ^ sum;
+}
+
+// The same walk, checking the state and every cell it reads
+__attribute__((noinline)) static uint32_t walk_asserted(uint32_t state, int steps)
+{
+  uint32_t sum = 0;
+  int x = 0;
+  int y = 0;
+  int i;
+  for (i = 0; i < steps; i++)
+  {
+    int cell;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    c_assert_uint_ne(0U, state);
+    x = (x + (int)(state & 3U) - 1 + WALK_WIDTH) % WALK_WIDTH;
+    y = (y + (int)((state >> 2) & 3U) - 1 + WALK_HEIGHT) % WALK_HEIGHT;
+    cell = cells[y * WALK_WIDTH + x];
+    c_assert_int_ge(cell, 0);
+    c_assert_int_lt(cell, 8);
+    c_assert_int_eq(0, cell & 0xF8);
+    sum += (uint32_t)cell;
+  }
+  return state ^ sum;
+}
+
+// Time one run of a walk in nanoseconds per step, keeping the fastest in *best
+static uint32_t time_walk(uint32_t (*walk)(uint32_t, int), int run, double *best)
+{
+  double start = now_ns();
+  uint32_t result = walk(0x5EED5EEDU + (uint32_t)run, ASSERT_BENCH_STEPS);
+  double ns = (now_ns() - start) / ASSERT_BENCH_STEPS;
+  if (run == 0 || ns < *best)
+  {
+    *best = ns;
+  }
+  return result;
+}
+
+int main(void)
+{
+  static const char *const levels[] = {"off", "cheap", "full"};
+  uint32_t plain_result = 0;
+  uint32_t asserted_result = 0;
+  double plain = 0.0;
+  double asserted = 0.0;
+  double overhead;
+  int run;
+
+  for (run = 0; run < WALK_WIDTH * WALK_HEIGHT; run++)
+  {
+    cells[run] = (uint8_t)((run * 7) % 5);
+  }
+
+  // Alternate the two loops so both see the same machine state
+  for (run = 0; run < ASSERT_BENCH_RUNS; run++)
+  {
+    plain_result ^= time_walk(walk_plain, run, &plain);
+    asserted_result ^= time_walk(walk_asserted, run, &asserted);
+  }
+  overhead = (asserted / plain - 1.0) * 100.0;
+
+  printf("C_ASSERT_LEVEL=%d (%s): plain %.3f ns/step, asserted %.3f ns/step, overhead %+.1f%%\n",
+         C_ASSERT_LEVEL, levels[C_ASSERT_LEVEL < 0 ? 0 : C_ASSERT_LEVEL > 2 ? 2 : C_ASSERT_LEVEL],
+         plain, asserted, overhead);
+  if (plain_result != asserted_result)
+  {
+    fprintf(stderr, "Error: the walks disagree (0x%08x vs 0x%08x)\n", plain_result, asserted_result);
+    return 1;
+  }
+  if (overhead > ASSERT_BENCH_TOLERANCE)
+  {
+    fprintf(stderr, "Error: assertions cost more than %.1f%%\n", ASSERT_BENCH_TOLERANCE);
+    return 1;
+  }
+  return 0;
+}
@@ -9,9 +9,53 @@
 #include <float.h>
 #include <math.h>
 
+// Assertion level, set with -DC_ASSERT_LEVEL=N:
+//   0  off: conditions are type-checked but never evaluated
+//   1  cheap: conditions are checked; a failure reports the file, line and
+//      expression, but not the values
+//   2  full: a failure also reports the values (default)
+// At every level the check is hinted as likely to pass and the failure
+// handlers are cold and never inlined, so a passing check costs a compare
+// and a predicted branch, and the reporting code stays out of hot loops.
+#ifndef C_ASSERT_LEVEL
+#define C_ASSERT_LEVEL 2
+#endif
+
+// What a failed assertion does after printing its message; test.h overrides
+// this to record the failure and let the test continue
+#ifndef C_ASSERT_FAIL
+#define C_ASSERT_FAIL() exit(1)
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define C_ASSERT_LIKELY(cond) __builtin_expect(!!(cond), 1)
+#define C_ASSERT_COLD __attribute__((cold, noinline, unused))
+#elif defined(_MSC_VER)
+#define C_ASSERT_LIKELY(cond) (cond)
+#define C_ASSERT_COLD __declspec(noinline)
+#else
+#define C_ASSERT_LIKELY(cond) (cond)
+#define C_ASSERT_COLD
+#endif
+
+// Helper macro that every assertion expands to: check cond and, if it fails,
+// report through text (cheap) or the report call (full). The result passes
+// through c_assert_result_ so an assertion used as a statement does not warn
+// about an unused value.
+#if C_ASSERT_LEVEL <= 0
+#define _c_assert_check(cond, text, report) c_assert_result_(((void)sizeof(cond), true))
+#elif C_ASSERT_LEVEL == 1
+#define _c_assert_check(cond, text, report) \
+  c_assert_result_(C_ASSERT_LIKELY(cond) ? (true) : (assertion_failed_site(__FILE__, __LINE__, text), false))
+#else
+#define _c_assert_check(cond, text, report) \
+  c_assert_result_(C_ASSERT_LIKELY(cond) ? (true) : (report, false))
+#endif
+
 // Helper macro for generic comparison assertions
 #define _c_assert_compare(expected, actual, op, fmt) \
-  ((expected)op(actual) ? (true) : (assertion_failed_fmt(__FILE__, __LINE__, #expected, #actual, #op, fmt, expected, actual), false))
+  _c_assert_check((expected)op(actual), #expected " " #op " " #actual, \
+                  assertion_failed_fmt(__FILE__, __LINE__, #expected, #actual, #op, fmt, expected, actual))
 
 // Integer comparisons (signed)
 #define c_assert_int_eq(expected, actual) _c_assert_compare(expected, actual, ==, "%d")
@@ -71,10 +115,12 @@
 
 // Floating point comparisons (with epsilon)
 #define c_assert_float_eq(expected, actual, epsilon) \
-  (fabs((expected) - (actual)) <= (epsilon) ? (true) : (assertion_failed_float(__FILE__, __LINE__, #expected, #actual, expected, actual, epsilon), false))
+  _c_assert_check(fabs((expected) - (actual)) <= (epsilon), #expected " == " #actual, \
+                  assertion_failed_float(__FILE__, __LINE__, #expected, #actual, expected, actual, epsilon))
 
 #define c_assert_double_eq(expected, actual, epsilon) \
-  (fabs((expected) - (actual)) <= (epsilon) ? (true) : (assertion_failed_double(__FILE__, __LINE__, #expected, #actual, expected, actual, epsilon), false))
+  _c_assert_check(fabs((expected) - (actual)) <= (epsilon), #expected " == " #actual, \
+                  assertion_failed_double(__FILE__, __LINE__, #expected, #actual, expected, actual, epsilon))
 
 // Pointer comparisons
 #define c_assert_ptr_eq(expected, actual) _c_assert_compare(expected, actual, ==, "%p")
@@ -84,40 +130,61 @@
 
 // String comparisons
 #define c_assert_str_eq(expected, actual) \
-  (strcmp(expected, actual) == 0 ? (true) : (assertion_failed_str(__FILE__, __LINE__, #expected, #actual, expected, actual), false))
+  _c_assert_check(strcmp(expected, actual) == 0, #expected " == " #actual, \
+                  assertion_failed_str(__FILE__, __LINE__, #expected, #actual, expected, actual))
 
 #define c_assert_str_ne(expected, actual) \
-  (strcmp(expected, actual) != 0 ? (true) : (assertion_failed_str(__FILE__, __LINE__, #expected, #actual, expected, actual), false))
+  _c_assert_check(strcmp(expected, actual) != 0, #expected " != " #actual, \
+                  assertion_failed_str(__FILE__, __LINE__, #expected, #actual, expected, actual))
 
 #define c_assert_strn_eq(expected, actual, n) \
-  (strncmp(expected, actual, n) == 0 ? (true) : (assertion_failed_strn(__FILE__, __LINE__, #expected, #actual, expected, actual, n), false))
+  _c_assert_check(strncmp(expected, actual, n) == 0, #expected " == " #actual, \
+                  assertion_failed_strn(__FILE__, __LINE__, #expected, #actual, expected, actual, n))
 
 // Bitwise operations
 #define c_assert_bits_set(value, mask) \
-  (((value) & (mask)) == (mask) ? (true) : (assertion_failed_bits(__FILE__, __LINE__, #value, #mask, value, mask, "set"), false))
+  _c_assert_check(((value) & (mask)) == (mask), "bits " #mask " set in " #value, \
+                  assertion_failed_bits(__FILE__, __LINE__, #value, #mask, value, mask, "set"))
 
 #define c_assert_bits_clear(value, mask) \
-  (((value) & (mask)) == 0 ? (true) : (assertion_failed_bits(__FILE__, __LINE__, #value, #mask, value, mask, "clear"), false))
+  _c_assert_check(((value) & (mask)) == 0, "bits " #mask " clear in " #value, \
+                  assertion_failed_bits(__FILE__, __LINE__, #value, #mask, value, mask, "clear"))
 
 #define c_assert_bits_any_set(value, mask) \
-  (((value) & (mask)) != 0 ? (true) : (assertion_failed_bits(__FILE__, __LINE__, #value, #mask, value, mask, "any set"), false))
+  _c_assert_check(((value) & (mask)) != 0, "bits " #mask " any set in " #value, \
+                  assertion_failed_bits(__FILE__, __LINE__, #value, #mask, value, mask, "any set"))
 
 #define c_assert_bits_any_clear(value, mask) \
-  (((value) & (mask)) != (mask) ? (true) : (assertion_failed_bits(__FILE__, __LINE__, #value, #mask, value, mask, "any clear"), false))
+  _c_assert_check(((value) & (mask)) != (mask), "bits " #mask " any clear in " #value, \
+                  assertion_failed_bits(__FILE__, __LINE__, #value, #mask, value, mask, "any clear"))
 
 // Range comparisons
 #define c_assert_in_range(value, min, max) \
-  (((value) >= (min) && (value) <= (max)) ? (true) : (assertion_failed_range(__FILE__, __LINE__, #value, value, min, max), false))
+  _c_assert_check((value) >= (min) && (value) <= (max), #value " in [" #min ", " #max "]", \
+                  assertion_failed_range(__FILE__, __LINE__, #value, value, min, max))
 
 #define c_assert_not_in_range(value, min, max) \
-  (((value) < (min) || (value) > (max)) ? (true) : (assertion_failed_not_range(__FILE__, __LINE__, #value, value, min, max), false))
+  _c_assert_check((value) < (min) || (value) > (max), #value " not in [" #min ", " #max "]", \
+                  assertion_failed_not_range(__FILE__, __LINE__, #value, value, min, max))
 
 // Boolean assertions
 #define c_assert_true(value) _c_assert_compare(value, true, ==, "%d")
 #define c_assert_false(value) _c_assert_compare(value, false, ==, "%d")
 
 // Implementation functions
-static inline void assertion_failed_fmt(const char *file, int line,
+static inline bool c_assert_result_(bool ok)
+{
+  return ok;
+}
+
+static C_ASSERT_COLD void assertion_failed_site(const char *file, int line, const char *expr)
+{
+  fprintf(stderr, "Assertion failed: %s:%d\n", file, line);
+  fprintf(stderr, "Expected: %s\n", expr);
+  C_ASSERT_FAIL();
+}
+
+static C_ASSERT_COLD void assertion_failed_fmt(const char *file, int line,
                                         const char *expected_expr, const char *actual_expr,
                                         const char *op, const char *fmt,
                                         long long expected, long long actual)
@@ -129,50 +196,50 @@ static inline void assertion_failed_fmt(const char *file, int line,
   fprintf(stderr, " %s ", op);
   fprintf(stderr, fmt, actual);
   fprintf(stderr, "\n");
-  exit(1);
+  C_ASSERT_FAIL();
 }
 
-static inline void assertion_failed_float(const char *file, int line,
+static C_ASSERT_COLD void assertion_failed_float(const char *file, int line,
                                           const char *expected_expr, const char *actual_expr,
                                           float expected, float actual, float epsilon)
 {
   fprintf(stderr, "Assertion failed: %s:%d\n", file, line);
   fprintf(stderr, "Expected: %s == %s (within %g)\n", expected_expr, actual_expr, epsilon);
   fprintf(stderr, "Values  : %g != %g (diff: %g)\n", expected, actual, fabs(expected - actual));
-  exit(1);
+  C_ASSERT_FAIL();
 }
 
-static inline void assertion_failed_double(const char *file, int line,
+static C_ASSERT_COLD void assertion_failed_double(const char *file, int line,
                                            const char *expected_expr, const char *actual_expr,
                                            double expected, double actual, double epsilon)
 {
   fprintf(stderr, "Assertion failed: %s:%d\n", file, line);
   fprintf(stderr, "Expected: %s == %s (within %g)\n", expected_expr, actual_expr, epsilon);
   fprintf(stderr, "Values  : %g != %g (diff: %g)\n", expected, actual, fabs(expected - actual));
-  exit(1);
+  C_ASSERT_FAIL();
 }
 
-static inline void assertion_failed_str(const char *file, int line,
+static C_ASSERT_COLD void assertion_failed_str(const char *file, int line,
                                         const char *expected_expr, const char *actual_expr,
                                         const char *expected, const char *actual)
 {
   fprintf(stderr, "Assertion failed: %s:%d\n", file, line);
   fprintf(stderr, "Expected: %s = \"%s\"\n", expected_expr, expected);
   fprintf(stderr, "Actual  : %s = \"%s\"\n", actual_expr, actual);
-  exit(1);
+  C_ASSERT_FAIL();
 }
 
-static inline void assertion_failed_strn(const char *file, int line,
+static C_ASSERT_COLD void assertion_failed_strn(const char *file, int line,
                                          const char *expected_expr, const char *actual_expr,
                                          const char *expected, const char *actual, size_t n)
 {
   fprintf(stderr, "Assertion failed: %s:%d\n", file, line);
   fprintf(stderr, "Expected first %zu chars: %s = \"%.*s\"\n", n, expected_expr, (int)n, expected);
   fprintf(stderr, "Actual first %zu chars  : %s = \"%.*s\"\n", n, actual_expr, (int)n, actual);
-  exit(1);
+  C_ASSERT_FAIL();
 }
 
-static inline void assertion_failed_bits(const char *file, int line,
+static C_ASSERT_COLD void assertion_failed_bits(const char *file, int line,
                                          const char *value_expr, const char *mask_expr,
                                          unsigned long long value, unsigned long long mask,
                                          const char *expected_state)
@@ -182,27 +249,27 @@ static inline void assertion_failed_bits(const char *file, int line,
   fprintf(stderr, "Value: %s = 0x%llx\n", value_expr, value);
   fprintf(stderr, "Mask : %s = 0x%llx\n", mask_expr, mask);
   fprintf(stderr, "Bits : 0x%llx\n", value & mask);
-  exit(1);
+  C_ASSERT_FAIL();
 }
 
-static inline void assertion_failed_range(const char *file, int line,
+static C_ASSERT_COLD void assertion_failed_range(const char *file, int line,
                                           const char *value_expr,
                                           long long value, long long min, long long max)
 {
   fprintf(stderr, "Assertion failed: %s:%d\n", file, line);
   fprintf(stderr, "Expected %s to be in range [%lld, %lld]\n", value_expr, min, max);
   fprintf(stderr, "Actual value: %lld\n", value);
-  exit(1);
+  C_ASSERT_FAIL();
 }
 
-static inline void assertion_failed_not_range(const char *file, int line,
+static C_ASSERT_COLD void assertion_failed_not_range(const char *file, int line,
                                               const char *value_expr,
                                               long long value, long long min, long long max)
 {
   fprintf(stderr, "Assertion failed: %s:%d\n", file, line);
   fprintf(stderr, "Expected %s to be outside range [%lld, %lld]\n", value_expr, min, max);
   fprintf(stderr, "Actual value: %lld\n", value);
-  exit(1);
+  C_ASSERT_FAIL();
 }
 
 #endif // ASSERTIONS_H
@@ -0,0 +1,448 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Microbenchmark helpers
+//
+//   #include "bench.h"
+//
+//   Bench b;
+//   bench_init(&b, "cell_at");
+//   BENCH_LOOP(&b)
+//   {
+//     bench_do_not_optimize(cell_at(&ctx, x, y));
+//   }
+//   bench_print(&b);
+//
+// BENCH_LOOP runs its body in batches. Warmup batches double in size until a
+// batch lasts a whole sample time, and carry on until the warmup time has
+// passed; the last one calibrates how many iterations fill a sample. Then it
+// takes the timed samples. Each sample is timed with the monotonic clock and
+// the CPU's timestamp counter, and on Linux with hardware counters (cycles,
+// instructions, branch and cache misses) read through perf_event_open. Where
+// the counters cannot be opened, such as under a strict perf_event_paranoid,
+// in containers or in virtual machines, results leave them out. Times are per
+// iteration and include the loop's own decrement and branch.
+//
+// Wrap results the compiler could otherwise discard in bench_do_not_optimize,
+// and call bench_clobber to make it assume memory was read and written.
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef BENCH_PERF
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/perf_event.h>)
+#define BENCH_PERF 1
+#endif
+#endif
+#endif
+#ifndef BENCH_PERF
+#define BENCH_PERF 0
+#endif
+
+#if BENCH_PERF
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifndef BENCH_WARMUP_NS
+#define BENCH_WARMUP_NS 50e6 // Default warmup time in nanoseconds
+#endif
+
+#ifndef BENCH_SAMPLE_NS
+#define BENCH_SAMPLE_NS 2e6 // Default time per sample in nanoseconds
+#endif
+
+#ifndef BENCH_SAMPLES
+#define BENCH_SAMPLES 51 // Default number of samples
+#endif
+
+#ifndef BENCH_MAX_SAMPLES
+#define BENCH_MAX_SAMPLES 256 // Most samples one Bench can hold
+#endif
+
+// Keep value, and everything it depends on, from being optimized away
+#if defined(__GNUC__) || defined(__clang__)
+#define bench_do_not_optimize(value) __asm__ volatile("" : : "r,m"(value) : "memory")
+#define bench_clobber() __asm__ volatile("" : : : "memory")
+#else
+static volatile uintptr_t bench_sink_;
+#define bench_do_not_optimize(value) ((void)(bench_sink_ = (uintptr_t)(value)))
+#define bench_clobber() ((void)0)
+#endif
+
+// Hardware counters, in the order they are read
+enum
+{
+  BENCH_CYCLES,
+  BENCH_INSTRUCTIONS,
+  BENCH_BRANCH_MISSES,
+  BENCH_CACHE_MISSES,
+  BENCH_COUNTERS
+};
+
+// Summary of one measurement over all samples, per iteration
+typedef struct
+{
+  double min;
+  double p5;
+  double median;
+  double mad; // Median absolute deviation from the median
+  double p95;
+  double p99;
+  double max;
+} BenchStats;
+
+// One benchmark: settings, samples and results
+typedef struct
+{
+  // Settings, filled in by bench_init and changeable before BENCH_LOOP
+  const char *name;   // Name to print
+  int samples;        // Samples to take, at most BENCH_MAX_SAMPLES
+  double warmup_ns;   // Least time to spend warming up
+  double sample_ns;   // Time each sample should last
+  bool use_counters;  // Read hardware counters if they can be opened
+
+  // Progress, kept by BENCH_LOOP
+  uint64_t iterations; // Iterations in the current batch, then in each sample
+  int count;           // Samples taken
+  int phase_;          // 0 before, 1 warming up, 2 sampling, 3 done
+  uint64_t warmup_start_;
+  uint64_t start_ns_;
+  uint64_t start_ticks_;
+  double start_counts_[BENCH_COUNTERS];
+  int perf_fds_[BENCH_COUNTERS]; // Counter group, leader first, or -1
+
+  // Per-iteration samples
+  double ns[BENCH_MAX_SAMPLES];
+  double ticks[BENCH_MAX_SAMPLES];
+  double counts[BENCH_COUNTERS][BENCH_MAX_SAMPLES];
+
+  // Results, set when BENCH_LOOP ends
+  bool has_ticks;    // The timestamp counter was read
+  bool has_counters; // Hardware counters were read for every sample
+  BenchStats time;   // Nanoseconds per iteration
+  BenchStats tick;   // Timestamp counter ticks per iteration
+  double counter[BENCH_COUNTERS]; // Median of each hardware counter per iteration
+} Bench;
+
+// Run the loop body in warmup batches and then in timed samples
+#define BENCH_LOOP(b)                  \
+  for (bench_start_(b); bench_next_(b);) \
+    for (uint64_t bench_i_ = (b)->iterations; bench_i_ > 0; bench_i_--)
+
+// Monotonic time in nanoseconds
+static inline uint64_t bench_now_ns(void)
+{
+  struct timespec ts;
+#if defined(_WIN32)
+  timespec_get(&ts, TIME_UTC);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+// CPU timestamp counter, or 0 where there is none
+static inline uint64_t bench_ticks(void)
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t v;
+  __asm__ volatile("mrs %0, cntvct_el0" : "=r"(v));
+  return v;
+#else
+  return 0;
+#endif
+}
+
+// Set up a benchmark with the default settings
+static inline void bench_init(Bench *b, const char *name)
+{
+  memset(b, 0, sizeof(*b));
+  b->name = name;
+  b->samples = BENCH_SAMPLES;
+  b->warmup_ns = BENCH_WARMUP_NS;
+  b->sample_ns = BENCH_SAMPLE_NS;
+  b->use_counters = true;
+  b->perf_fds_[0] = -1;
+}
+
+#if BENCH_PERF
+// Open one hardware counter, in the group led by group or as a new leader
+static inline int bench_perf_open_(uint64_t config, int group)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = group < 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+// Open and start the counter group; leaves perf_fds_[0] at -1 if that fails
+static inline void bench_counters_open_(Bench *b)
+{
+#if BENCH_PERF
+  static const uint64_t configs[BENCH_COUNTERS] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES};
+  int fds[BENCH_COUNTERS];
+  int i;
+  fds[0] = bench_perf_open_(configs[0], -1);
+  for (i = 1; i < BENCH_COUNTERS && fds[0] >= 0; i++)
+  {
+    fds[i] = bench_perf_open_(configs[i], fds[0]);
+    if (fds[i] < 0)
+    {
+      // All or nothing: close what was opened
+      while (i-- > 0)
+      {
+        close(fds[i]);
+      }
+      fds[0] = -1;
+    }
+  }
+  if (fds[0] >= 0 && ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == 0)
+  {
+    memcpy(b->perf_fds_, fds, sizeof(fds));
+  }
+  else if (fds[0] >= 0)
+  {
+    for (i = 0; i < BENCH_COUNTERS; i++)
+    {
+      close(fds[i]);
+    }
+  }
+#else
+  (void)b;
+#endif
+}
+
+// Read the counter group, scaled for any time it was not scheduled; returns
+// false if the counters are closed or did not run
+static inline bool bench_counters_read_(const Bench *b, double counts[BENCH_COUNTERS])
+{
+#if BENCH_PERF
+  uint64_t buf[3 + BENCH_COUNTERS];
+  int i;
+  if (b->perf_fds_[0] < 0 || read(b->perf_fds_[0], buf, sizeof(buf)) != (ssize_t)sizeof(buf) || buf[2] == 0)
+  {
+    return false;
+  }
+  for (i = 0; i < BENCH_COUNTERS; i++)
+  {
+    counts[i] = (double)buf[3 + i] * ((double)buf[1] / (double)buf[2]);
+  }
+  return true;
+#else
+  (void)b;
+  (void)counts;
+  return false;
+#endif
+}
+
+// Close the counter group
+static inline void bench_counters_close_(Bench *b)
+{
+#if BENCH_PERF
+  int i;
+  for (i = 0; b->perf_fds_[0] >= 0 && i < BENCH_COUNTERS; i++)
+  {
+    close(b->perf_fds_[i]);
+  }
+#endif
+  b->perf_fds_[0] = -1;
+}
+
+// Compare doubles for qsort
+static inline int bench_compare_(const void *a, const void *b)
+{
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Percentile p (0 to 100) of n sorted values, interpolating between them
+static inline double bench_percentile(const double *sorted, int n, double p)
+{
+  const double rank = p / 100.0 * (double)(n - 1);
+  const int lo = (int)rank;
+  if (n <= 0)
+  {
+    return 0.0;
+  }
+  if (lo >= n - 1)
+  {
+    return sorted[n - 1];
+  }
+  return sorted[lo] + (sorted[lo + 1] - sorted[lo]) * (rank - (double)lo);
+}
+
+// Summarize n values, sorting them in place
+static inline BenchStats bench_stats(double *values, int n)
+{
+  BenchStats s;
+  double deviation[BENCH_MAX_SAMPLES];
+  int i;
+  memset(&s, 0, sizeof(s));
+  if (n <= 0)
+  {
+    return s;
+  }
+  qsort(values, (size_t)n, sizeof(double), bench_compare_);
+  s.min = values[0];
+  s.p5 = bench_percentile(values, n, 5.0);
+  s.median = bench_percentile(values, n, 50.0);
+  s.p95 = bench_percentile(values, n, 95.0);
+  s.p99 = bench_percentile(values, n, 99.0);
+  s.max = values[n - 1];
+  for (i = 0; i < n; i++)
+  {
+    deviation[i] = values[i] > s.median ? values[i] - s.median : s.median - values[i];
+  }
+  qsort(deviation, (size_t)n, sizeof(double), bench_compare_);
+  s.mad = bench_percentile(deviation, n, 50.0);
+  return s;
+}
+
+// Start BENCH_LOOP
+static inline void bench_start_(Bench *b)
+{
+  b->samples = b->samples < 1 ? 1 : b->samples > BENCH_MAX_SAMPLES ? BENCH_MAX_SAMPLES : b->samples;
+  b->count = 0;
+  b->iterations = 1;
+  b->phase_ = 0;
+  b->has_counters = false;
+  if (b->use_counters)
+  {
+    bench_counters_open_(b);
+  }
+  b->has_counters = b->perf_fds_[0] >= 0;
+}
+
+// Work out the results once the samples are in
+static inline void bench_finish_(Bench *b)
+{
+  double scratch[BENCH_MAX_SAMPLES];
+  int i;
+  bench_counters_close_(b);
+  memcpy(scratch, b->ns, sizeof(double) * (size_t)b->count);
+  b->time = bench_stats(scratch, b->count);
+  memcpy(scratch, b->ticks, sizeof(double) * (size_t)b->count);
+  b->tick = bench_stats(scratch, b->count);
+  b->has_ticks = b->tick.max > 0.0;
+  for (i = 0; i < BENCH_COUNTERS; i++)
+  {
+    memcpy(scratch, b->counts[i], sizeof(double) * (size_t)b->count);
+    b->counter[i] = b->has_counters ? bench_stats(scratch, b->count).median : 0.0;
+  }
+  b->phase_ = 3;
+}
+
+// End one batch of BENCH_LOOP and start the next; returns false when done
+static inline bool bench_next_(Bench *b)
+{
+  // Stop the clocks first, in the reverse order they were started
+  const uint64_t end_ticks = bench_ticks();
+  const uint64_t end_ns = bench_now_ns();
+  double end_counts[BENCH_COUNTERS];
+  const bool counted = b->has_counters && bench_counters_read_(b, end_counts);
+  const double elapsed = (double)(end_ns - b->start_ns_);
+  int i;
+
+  if (b->phase_ == 0)
+  {
+    b->phase_ = 1;
+    b->warmup_start_ = end_ns;
+  }
+  else if (b->phase_ == 1)
+  {
+    if (elapsed >= b->sample_ns * 0.5 && (double)(end_ns - b->warmup_start_) >= b->warmup_ns)
+    {
+      // Calibrate from the last warmup batch
+      const double per_iteration = elapsed / (double)b->iterations;
+      const double n = per_iteration > 0.0 ? b->sample_ns / per_iteration : 1.0;
+      b->iterations = n > 1.0 ? (uint64_t)n : 1;
+      b->phase_ = 2;
+    }
+    else if (elapsed < b->sample_ns)
+    {
+      b->iterations *= 2;
+    }
+  }
+  else if (b->phase_ == 2)
+  {
+    const double n = (double)b->iterations;
+    b->ns[b->count] = elapsed / n;
+    b->ticks[b->count] = (double)(end_ticks - b->start_ticks_) / n;
+    for (i = 0; i < BENCH_COUNTERS; i++)
+    {
+      b->counts[i][b->count] = counted ? (end_counts[i] - b->start_counts_[i]) / n : 0.0;
+    }
+    b->has_counters = b->has_counters && counted;
+    if (++b->count == b->samples)
+    {
+      bench_finish_(b);
+      return false;
+    }
+  }
+  else
+  {
+    return false;
+  }
+
+  // Start the clocks for the next batch
+  if (b->has_counters && !bench_counters_read_(b, b->start_counts_))
+  {
+    b->has_counters = false;
+  }
+  b->start_ns_ = bench_now_ns();
+  b->start_ticks_ = bench_ticks();
+  return true;
+}
+
+// Print a benchmark's results
+static inline void bench_print(const Bench *b)
+{
+  const BenchStats *t = &b->time;
+  printf("%-24s median %10.3f ns  MAD %8.3f ns (%4.1f%%)  p5 %.3f  p95 %.3f  p99 %.3f  max %.3f ns\n",
+         b->name, t->median, t->mad, t->median > 0.0 ? t->mad / t->median * 100.0 : 0.0, t->p5, t->p95, t->p99, t->max);
+  printf("%-24s %d samples x %llu iterations", "", b->count, (unsigned long long)b->iterations);
+  if (b->has_ticks)
+  {
+    printf(", %.2f TSC ticks", b->tick.median);
+  }
+  if (b->has_counters)
+  {
+    printf(", %.2f cycles, %.2f instructions (IPC %.2f), %.4f branch misses, %.4f cache misses",
+           b->counter[BENCH_CYCLES], b->counter[BENCH_INSTRUCTIONS],
+           b->counter[BENCH_CYCLES] > 0.0 ? b->counter[BENCH_INSTRUCTIONS] / b->counter[BENCH_CYCLES] : 0.0,
+           b->counter[BENCH_BRANCH_MISSES], b->counter[BENCH_CACHE_MISSES]);
+  }
+  else if (b->use_counters)
+  {
+    printf(", no hardware counters");
+  }
+  printf("\n");
+}
+
+#endif // BENCH_H
@@ -1,6 +1,9 @@
 #define SDL_MAIN_USE_CALLBACKS 1 /* Use callbacks instead of main() */
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
+#include <time.h>
+
+#include "bench.h"
 
 /*
  * Game Configuration
@@ -11,13 +14,148 @@
  */
 #define STEP_RATE_IN_MILLISECONDS 125                         /* Game logic update rate in milliseconds */
 #define BLOCK_SIZE_IN_PIXELS 48                               /* Size of each block (cell) in pixels */
+#ifndef GAME_GRID_WIDTH
 #define GAME_GRID_WIDTH 24U                                   /* Width of the game grid in blocks */
+#endif
+#ifndef GAME_GRID_HEIGHT
 #define GAME_GRID_HEIGHT 14U                                  /* Height of the game grid in blocks */
+#endif
 #define GAME_MATRIX_SIZE (GAME_GRID_WIDTH * GAME_GRID_HEIGHT) /* Total number of cells */
 
-/* Window dimensions calculated based on block size and grid size */
-#define SDL_WINDOW_WIDTH (BLOCK_SIZE_IN_PIXELS * GAME_GRID_WIDTH)
-#define SDL_WINDOW_HEIGHT (BLOCK_SIZE_IN_PIXELS * GAME_GRID_HEIGHT)
+/*
+ * Viewport Configuration
+ *
+ * The window shows at most VIEW_MAX_WIDTH x VIEW_MAX_HEIGHT blocks. On a
+ * larger grid the view follows the player and only visible cells are drawn.
+ */
+#define VIEW_MAX_WIDTH 24U                                    /* Widest view in blocks */
+#define VIEW_MAX_HEIGHT 14U                                   /* Tallest view in blocks */
+#define VIEW_GRID_WIDTH SDL_min(GAME_GRID_WIDTH, VIEW_MAX_WIDTH) /* Width of the view in blocks */
+#define VIEW_GRID_HEIGHT SDL_min(GAME_GRID_HEIGHT, VIEW_MAX_HEIGHT) /* Height of the view in blocks */
+#define VIEW_MATRIX_SIZE (VIEW_GRID_WIDTH * VIEW_GRID_HEIGHT) /* Cells in the view */
+#define VIEW_IS_WORLD (VIEW_GRID_WIDTH == GAME_GRID_WIDTH && VIEW_GRID_HEIGHT == GAME_GRID_HEIGHT)
+
+/*
+ * Headless Simulation Configuration
+ *
+ * Running the program as "./game --headless STEPS [--seed SEED]" skips the
+ * window entirely and runs STEPS game steps back to back, driven by an input
+ * script generated from SEED. The same seed always produces the same script,
+ * so the final state checksum can be compared between runs and builds.
+ * "--grid-bench ROUNDS" times the grid operations instead, and "--bench"
+ * times single cell_at and game_step calls with bench.h.
+ */
+#define HEADLESS_DEFAULT_SEED 0x5EED5EEDU /* Seed used when --seed is not given */
+#define HEADLESS_REDIR_CHANCE 8U          /* One step in N changes direction */
+#define HEADLESS_RESTART_CHANCE 4096U     /* One step in N restarts the game */
+#define MICRO_BENCH_INPUTS 4096U          /* Cells and inputs cycled through by --bench (power of two) */
+
+/*
+ * Input Commands
+ *
+ * Player input is reduced to one byte per command: a Direction, or one of
+ * the values below. The headless input script and the simulation thread's
+ * input queue both carry these.
+ */
+#define INPUT_NONE 0xFFU    /* No input */
+#define INPUT_RESTART 0xFEU /* Restart the game */
+
+/*
+ * Input Journal Configuration
+ *
+ * Running with "--record FILE" writes every input command to FILE, keyed by
+ * the number of steps taken before it, plus a checkpoint (a raw copy of the
+ * GameContext) every JOURNAL_CHECKPOINT_INTERVAL steps. "--replay FILE"
+ * plays the session back as fast as possible, and "--seek STEP" stops at a
+ * step after starting from the last checkpoint before it. Checkpoints are
+ * raw memory, so only a build with the same grid configuration can replay
+ * a journal.
+ */
+#define JOURNAL_CHECKPOINT_INTERVAL 1024U /* Steps between checkpoints */
+#define JOURNAL_MAGIC "BOILJRNL"          /* First 8 bytes of a journal */
+#define JOURNAL_INDEX_MAGIC "BOILJIDX"    /* Last 8 bytes of a complete journal */
+#define JOURNAL_VERSION 1U                /* Journal format version */
+#define JOURNAL_INPUT 0U                  /* Record kind: one input command */
+#define JOURNAL_CHECKPOINT 1U             /* Record kind: a raw GameContext */
+#define JOURNAL_END 2U                    /* Record kind: end of the session */
+
+/*
+ * Simulation Thread Configuration
+ *
+ * Running with "--sim-thread" moves game_step onto its own thread, which
+ * publishes a snapshot of the game state after every step. Rendering reads
+ * the newest snapshot and moves the player smoothly between the last two.
+ */
+#define SNAPSHOT_FRESH 4         /* Flag in TripleBuffer.latest: slot not yet read */
+#define INPUT_QUEUE_SIZE 64U     /* Capacity of the input queue (power of two) */
+
+/*
+ * Frame Statistics Configuration
+ *
+ * With FRAME_STATS set, SDL_AppIterate times its step, draw and present
+ * phases for the last FRAME_STATS_CAPACITY frames. F3 toggles an overlay of
+ * p50/p99/max times, and "--trace FILE" writes the recorded frames on exit,
+ * as Chrome trace JSON if FILE ends in ".json" and as CSV otherwise.
+ * Building with -DFRAME_STATS=0 removes all of it.
+ */
+#ifndef FRAME_STATS
+#define FRAME_STATS 1
+#endif
+#define FRAME_STATS_CAPACITY 1024U /* Frames kept in the ring buffer */
+#define FRAME_STATS_REFRESH 30U    /* Frames between overlay updates */
+
+/*
+ * Frame Pacing Configuration
+ *
+ * By default SDL_AppIterate draws a frame every time SDL calls it, as often
+ * as the driver's vsync lets it. "--on-change" draws only after a game
+ * step, an event, or while the player is between cells, and otherwise lets
+ * SDL sleep until the next event; a timer (or the simulation thread) sends
+ * one when the next step is due. "--fps N" caps the frame rate: each frame
+ * waits for its deadline by sleeping until PACING_SPIN_NS before it, since
+ * sleeps overshoot by up to a scheduler tick, and spinning for the rest.
+ * "--vsync on|off|adaptive" overrides the driver's vsync. "--measure
+ * SECONDS" runs for that long and logs frames per second, CPU time per
+ * second and frame-time jitter, so the modes can be compared.
+ */
+#define PACING_SPIN_NS 1000000U      /* Last part of a frame wait that is spun rather than slept */
+#define PACING_MEASURE_FRAMES 8192U  /* Frame intervals kept for the jitter percentiles */
+
+/*
+ * Whole-Grid Update Configuration
+ *
+ * With -DGRID_UPDATE=1, every game step starts by applying cell_rule_ to
+ * every cell at once. The new grid is computed from the old one into a
+ * second buffer, a tile of UPDATE_TILE_WORDS bitplane words at a time, on a
+ * pool of worker threads that steal tiles from each other, then copied back.
+ * A tile only reads the old grid and only writes its own words of the new
+ * one, so the result is the same for any number of threads. "--jobs N" sets
+ * the number of threads (0, the default, means one per core) and
+ * "--update-bench ROUNDS" times the update on its own. Tiles are runs of
+ * whole words, so the update needs GRID_LAYOUT_BITPLANE.
+ */
+#ifndef GRID_UPDATE
+#define GRID_UPDATE 0
+#endif
+#define UPDATE_TILE_WORDS 16U  /* Bitplane words (64 cells each) per tile */
+#define UPDATE_MAX_JOBS 64U    /* Most threads in the update pool */
+#define UPDATE_SOUP_CHANCE 4U  /* One cell in N starts out as CELL_TYPE2 */
+
+/*
+ * Entity Configuration
+ *
+ * Besides the player, the game can run a pool of entities that move one
+ * cell per step and turn back when the cell ahead is occupied. Running with
+ * "--entities N" spawns N of them; "--entity-bench ROUNDS" times stepping
+ * them on their own.
+ */
+#define ENTITY_ALIGN 64U           /* Alignment of each entity array, for vector loads */
+#define ENTITY_BENCH_COUNT 100000U /* Entities in the benchmark when --entities is not given */
+#define ENTITY_BENCH_CHURN 64U     /* Entities despawned and respawned per benchmark round */
+
+/* Window dimensions calculated based on block size and view size */
+#define SDL_WINDOW_WIDTH (BLOCK_SIZE_IN_PIXELS * VIEW_GRID_WIDTH)
+#define SDL_WINDOW_HEIGHT (BLOCK_SIZE_IN_PIXELS * VIEW_GRID_HEIGHT)
 
 /*
  * Bitmasking Definitions for Cell Storage
@@ -29,6 +167,59 @@
 #define THREE_BITS 0x7U                                               /* Bitmask for 3 bits (binary 111) */
 #define SHIFT(x, y) (((x) + ((y) * GAME_GRID_WIDTH)) * CELL_MAX_BITS) /* Bit shift amount for cell at (x, y) */
 
+/*
+ * Grid Layout Selection
+ *
+ * The grid can be stored in one of three layouts, chosen at compile time
+ * with -DGRID_LAYOUT=...:
+ *
+ * GRID_LAYOUT_PACKED stores each cell in 3 consecutive bits, which is the
+ * smallest layout but needs a multiply, a divide and an unaligned 16-bit
+ * access per cell.
+ *
+ * GRID_LAYOUT_BITPLANE stores bit N of every cell's CellType in plane N,
+ * an array of 64-bit words with one bit per cell. A single cell costs a
+ * shift and a mask per plane, and the bulk operations below handle 64
+ * cells per word operation.
+ *
+ * GRID_LAYOUT_CHUNKED splits the grid into CHUNK_SIZE x CHUNK_SIZE chunks,
+ * each stored as bitplanes with one 64-bit word per row. Chunks are found
+ * through a table of regions of REGION_CHUNKS x REGION_CHUNKS chunks; both
+ * are allocated when a cell in them is set and freed when they empty, so
+ * memory follows the occupied area rather than the grid size. Grids of up
+ * to 65536 x 65536 cells are supported. The packed and bitplane grids live
+ * inline in GameContext; the chunked grid does not, so it cannot be copied
+ * with the context, which rules out the simulation thread and dirty-region
+ * rendering.
+ */
+#define GRID_LAYOUT_PACKED 0
+#define GRID_LAYOUT_BITPLANE 1
+#define GRID_LAYOUT_CHUNKED 2
+#ifndef GRID_LAYOUT
+#define GRID_LAYOUT GRID_LAYOUT_PACKED
+#endif
+#define GRID_INLINE (GRID_LAYOUT != GRID_LAYOUT_CHUNKED) /* Whether copying a GameContext copies its grid */
+
+#define GRID_WORDS ((GAME_MATRIX_SIZE + 63U) / 64U) /* 64-bit words per bitplane */
+
+#define UPDATE_TILES ((GRID_WORDS + UPDATE_TILE_WORDS - 1U) / UPDATE_TILE_WORDS) /* Tiles per whole-grid update */
+#if GRID_UPDATE && GRID_LAYOUT != GRID_LAYOUT_BITPLANE
+#error "GRID_UPDATE needs the bitplane grid layout (-DGRID_LAYOUT=1)"
+#endif
+#if GRID_UPDATE && UPDATE_TILES > 65535U
+#error "Too many update tiles for a TileRange; raise UPDATE_TILE_WORDS"
+#endif
+
+#define CHUNK_SIZE 64U                                               /* Chunk width and height in cells */
+#define REGION_CHUNKS 32U                                            /* Region width and height in chunks */
+#define CHUNKS_X ((GAME_GRID_WIDTH + CHUNK_SIZE - 1U) / CHUNK_SIZE)  /* Chunks across the grid */
+#define CHUNKS_Y ((GAME_GRID_HEIGHT + CHUNK_SIZE - 1U) / CHUNK_SIZE) /* Chunks down the grid */
+#define REGIONS_X ((CHUNKS_X + REGION_CHUNKS - 1U) / REGION_CHUNKS)  /* Regions across the grid */
+#define REGIONS_Y ((CHUNKS_Y + REGION_CHUNKS - 1U) / REGION_CHUNKS)  /* Regions down the grid */
+
+/* Dirty-region rendering compares whole grids, so it needs an inline grid that fits the view */
+#define DIRTY_RENDERING (GRID_INLINE && VIEW_IS_WORLD)
+
 /*
  * Enumeration of Possible Cell Types
  *
@@ -45,6 +236,8 @@ typedef enum
     CELL_TYPE5 = 5U   /* Placeholder for other cell types */
 } CellType;
 
+#define CELL_TYPES (CELL_TYPE5 + 1U) /* Number of cell types, including CELL_EMPTY */
+
 /*
  * Enumeration of Possible Directions
  *
@@ -58,6 +251,72 @@ typedef enum
     DIR_DOWN
 } Direction;
 
+/*
+ * Structure to Hold One Chunk of a Chunked Grid
+ *
+ * Bit x of planes[p][y] is bit p of the CellType of cell (x, y) in the chunk.
+ */
+typedef struct
+{
+    Uint64 planes[CELL_MAX_BITS][CHUNK_SIZE]; /* One word per row for each bit of a CellType */
+    unsigned occupied;                        /* Number of non-empty cells */
+} GridChunk;
+
+/*
+ * Structure to Hold One Region of a Chunked Grid
+ */
+typedef struct
+{
+    GridChunk *chunks[REGION_CHUNKS * REGION_CHUNKS]; /* Chunks, row by row, or NULL if empty */
+    unsigned count;                                   /* Number of allocated chunks */
+} GridRegion;
+
+/*
+ * Structure to Hold the Part of the Grid in View
+ */
+typedef struct
+{
+    int x; /* Leftmost visible column */
+    int y; /* Topmost visible row */
+} Camera;
+
+/*
+ * Structure to Hold a Bump Allocator
+ *
+ * Everything allocated from an arena is freed at once with the arena.
+ */
+typedef struct
+{
+    Uint8 *base; /* Start of the arena's memory */
+    size_t size; /* Bytes in the arena */
+    size_t used; /* Bytes handed out so far */
+} Arena;
+
+/*
+ * Structure to Hold the Entities
+ *
+ * Each field is a separate array indexed by entity, so the step loops read
+ * only the fields they need and compile to vector code. Slots [0, end) have
+ * been used; despawned slots among them are dead and listed in free_list,
+ * which spawn reuses before growing end.
+ */
+typedef struct
+{
+    Sint32 *x;         /* Column of each entity */
+    Sint32 *y;         /* Row of each entity */
+    Sint32 *next_x;    /* Column each entity moves to this step (scratch) */
+    Sint32 *next_y;    /* Row each entity moves to this step (scratch) */
+    Uint8 *blocked;    /* Whether the cell ahead is occupied this step (scratch) */
+    Uint8 *dir;        /* Direction of each entity */
+    Uint8 *type;       /* CellType each entity is drawn as */
+    Uint8 *alive;      /* 1 for live entities, 0 for free slots */
+    Uint32 *free_list; /* Free slots below end, used as a stack */
+    Uint32 free_count; /* Entries in free_list */
+    Uint32 end;        /* One past the highest slot ever used */
+    Uint32 capacity;   /* Number of slots */
+    SDL_FRect *rects;  /* Rectangles to fill when drawing, one per slot */
+} EntityPool;
+
 /*
  * Structure to Hold the Game State
  *
@@ -66,12 +325,232 @@ typedef enum
  */
 typedef struct
 {
-    unsigned char cells[(GAME_MATRIX_SIZE * CELL_MAX_BITS) / 8U]; /* Game grid represented using bitmasking */
-    char player_xpos;                                             /* Player's x position on the grid */
-    char player_ypos;                                             /* Player's y position on the grid */
-    char next_dir;                                                /* Next direction of movement for the player */
+#if GRID_LAYOUT == GRID_LAYOUT_CHUNKED
+    GridRegion *regions[REGIONS_X * REGIONS_Y]; /* Regions, row by row, or NULL if empty */
+#elif GRID_LAYOUT == GRID_LAYOUT_BITPLANE
+    Uint64 planes[CELL_MAX_BITS][GRID_WORDS]; /* One bit per cell for each bit of its CellType */
+#else
+    unsigned char cells[(GAME_MATRIX_SIZE * CELL_MAX_BITS + 15U) / 8U]; /* Game grid represented using bitmasking */
+#endif
+    int player_xpos; /* Player's x position on the grid */
+    int player_ypos; /* Player's y position on the grid */
+    char next_dir;   /* Next direction of movement for the player */
 } GameContext;
 
+/*
+ * Structure to Hold a Published Game State
+ */
+typedef struct
+{
+    GameContext ctx; /* Game state after the step */
+    Uint64 step;     /* Number of steps taken so far */
+    Uint64 time;     /* SDL_GetTicksNS() when the step completed */
+} Snapshot;
+
+/*
+ * Structure to Hand Snapshots From One Writer to One Reader
+ *
+ * The writer fills its back slot, then swaps it with latest; the reader
+ * swaps its front slot with latest whenever latest holds a fresh snapshot.
+ * Neither side ever waits, and the reader always sees a complete state.
+ */
+typedef struct
+{
+    Snapshot slots[3];    /* Back, latest and front slots, in some order */
+    SDL_AtomicInt latest; /* Index of the latest slot, | SNAPSHOT_FRESH if unread */
+    int back;             /* Slot the writer fills next (writer only) */
+    int front;            /* Slot the reader holds (reader only) */
+} TripleBuffer;
+
+/*
+ * Structure to Pass Input Commands From One Producer to One Consumer
+ *
+ * A fixed-size ring: pushing and popping each finish in a bounded number
+ * of steps. When the ring is full, new input is dropped.
+ */
+typedef struct
+{
+    Uint8 items[INPUT_QUEUE_SIZE]; /* Input commands */
+    SDL_AtomicInt head;            /* Total commands popped (consumer writes) */
+    SDL_AtomicInt tail;            /* Total commands pushed (producer writes) */
+} InputQueue;
+
+/*
+ * Structure at the Start of a Journal
+ *
+ * A journal holds this header, then records in step order, then an index
+ * of its checkpoints and a JournalFooter. Each record starts with a varint
+ * tag, (steps since the previous record << 2) | kind, followed by an input
+ * command byte (JOURNAL_INPUT), a raw GameContext (JOURNAL_CHECKPOINT) or
+ * nothing (JOURNAL_END). The index holds a (step, file offset) pair of
+ * Uint64s per checkpoint, in step order.
+ */
+typedef struct
+{
+    char magic[8];       /* JOURNAL_MAGIC */
+    Uint32 version;      /* JOURNAL_VERSION */
+    Uint32 layout;       /* GRID_LAYOUT of the recording build */
+    Uint32 width;        /* GAME_GRID_WIDTH of the recording build */
+    Uint32 height;       /* GAME_GRID_HEIGHT of the recording build */
+    Uint32 context_size; /* sizeof(GameContext) in the recording build */
+    Uint32 interval;     /* Steps between checkpoints */
+} JournalHeader;
+
+/*
+ * Structure at the End of a Complete Journal
+ */
+typedef struct
+{
+    Uint64 checkpoints;  /* Entries in the index */
+    Uint64 index_offset; /* File offset of the index */
+    char magic[8];       /* JOURNAL_INDEX_MAGIC */
+} JournalFooter;
+
+/*
+ * Structure to Hold a Journal Being Written
+ */
+typedef struct
+{
+    SDL_IOStream *io;   /* File being written, or NULL when not recording */
+    Uint64 offset;      /* Bytes written so far */
+    Uint64 last_step;   /* Step of the last record */
+    Uint64 *index;      /* Step and file offset of each checkpoint */
+    Uint64 checkpoints; /* Checkpoints written */
+    Uint64 capacity;    /* Checkpoints the index has room for */
+} Journal;
+
+/*
+ * Structure to Hold the Simulation Thread State
+ */
+typedef struct
+{
+    GameContext ctx;     /* Game state, owned by the simulation thread */
+    Uint64 steps;        /* Steps taken by the simulation thread */
+    TripleBuffer frames; /* Snapshots from the simulation thread to rendering */
+    InputQueue inputs;   /* Input from SDL_AppEvent to the simulation thread */
+    Journal *journal;    /* Journal to record input and checkpoints to */
+    Uint32 wake_event;   /* Event pushed after every step, or 0 */
+    SDL_AtomicInt quit;  /* Set to stop the simulation thread */
+} SimState;
+
+/*
+ * Structure to Hold One Worker's Share of the Tiles in a Pass
+ *
+ * The tiles left, [next, end), are packed into one atomic with next in the
+ * low 16 bits and end in the high 16 bits. The owner takes tiles from the
+ * front and idle workers steal from the back, each with one compare-and-swap.
+ */
+typedef struct
+{
+    SDL_AtomicInt range;                  /* next | end << 16 */
+    char pad[64 - sizeof(SDL_AtomicInt)]; /* Keeps each range on its own cache line */
+} TileRange;
+
+/* Function run by the tile pool for each tile of a pass */
+typedef void (*TileFunc)(void *arg, unsigned tile);
+
+typedef struct TilePool TilePool;
+
+/*
+ * Structure to Hold What a Tile Pool Thread Needs to Know
+ */
+typedef struct
+{
+    TilePool *pool; /* Pool the thread belongs to */
+    unsigned index; /* Worker index, from 1 */
+} TileWorker;
+
+/*
+ * Structure to Hold a Pool of Threads Working Through Tiles
+ *
+ * The thread that runs a pass works as worker 0; the pool's own threads
+ * are workers 1 to jobs - 1.
+ */
+struct TilePool
+{
+    TileRange ranges[UPDATE_MAX_JOBS];    /* Tiles left to each worker in this pass */
+    SDL_Thread *threads[UPDATE_MAX_JOBS]; /* Worker threads; threads[0] is unused */
+    TileWorker workers[UPDATE_MAX_JOBS];  /* Argument of each worker thread */
+    unsigned jobs;                        /* Number of workers, including the caller */
+    TileFunc func;                        /* Function run for each tile of this pass */
+    void *arg;                            /* Argument to func */
+    SDL_Mutex *lock;                      /* Guards the fields below */
+    SDL_Condition *wake;                  /* Signalled when a pass starts or the pool stops */
+    SDL_Condition *idle;                  /* Signalled when the last thread finishes a pass */
+    unsigned pass;                        /* Passes started so far */
+    unsigned busy;                        /* Threads still working on this pass */
+    bool quit;                            /* Set to stop the threads */
+};
+
+/*
+ * Frame Phases Timed by the Frame Statistics
+ */
+typedef enum
+{
+    PHASE_STEP,    /* Game logic, or taking the newest snapshot */
+    PHASE_DRAW,    /* Drawing the grid */
+    PHASE_PRESENT, /* SDL_RenderPresent */
+    PHASE_COUNT
+} FramePhase;
+
+/*
+ * Structure to Hold the Timings of One Frame
+ *
+ * Phase i runs from the end of phase i - 1 (or from start) to end[i].
+ * All values are SDL_GetPerformanceCounter() readings.
+ */
+typedef struct
+{
+    Uint64 start;            /* Start of the frame */
+    Uint64 end[PHASE_COUNT]; /* End of each phase */
+} FrameRecord;
+
+/*
+ * Structure to Hold the Frame Statistics
+ */
+typedef struct
+{
+    FrameRecord frames[FRAME_STATS_CAPACITY]; /* Ring buffer of the most recent frames */
+    Uint64 count;                             /* Frames recorded so far */
+    float summary[PHASE_COUNT + 1][3];        /* p50, p99 and max in ms per phase, then for whole frames */
+    bool overlay;                             /* Whether the overlay is shown */
+    const char *trace_path;                   /* File to write the frames to on exit, or NULL */
+} FrameStats;
+
+#if FRAME_STATS
+#define STATS_BEGIN_FRAME(as) ((as)->stats.frames[(as)->stats.count % FRAME_STATS_CAPACITY].start = SDL_GetPerformanceCounter())
+#define STATS_END_PHASE(as, phase) ((as)->stats.frames[(as)->stats.count % FRAME_STATS_CAPACITY].end[phase] = SDL_GetPerformanceCounter())
+#define STATS_END_FRAME(as) ((as)->stats.count++)
+#else
+#define STATS_BEGIN_FRAME(as) ((void)0)
+#define STATS_END_PHASE(as, phase) ((void)0)
+#define STATS_END_FRAME(as) ((void)0)
+#endif
+
+/*
+ * Structure to Hold the Frame Pacing State
+ *
+ * Deadlines and intervals are SDL_GetPerformanceCounter() readings.
+ */
+typedef struct
+{
+    bool on_change;                           /* Draw only when something changed */
+    bool changed;                             /* Something changed since the last drawn frame */
+    Uint32 wake_event;                        /* Event that only wakes SDL_AppIterate, or 0 */
+    SDL_AtomicInt wake_pending;               /* Set while a wake timer is pending */
+    SDL_TimerID wake_timer;                   /* Last wake timer added, or 0 */
+    Uint64 frame_ticks;                       /* Shortest time between frames, or 0 for no cap */
+    Uint64 deadline;                          /* Earliest start of the next frame */
+    Uint64 measure_ticks;                     /* Length of the measured run, or 0 */
+    Uint64 measure_start;                     /* Start of the measured run */
+    Uint64 cpu_start;                         /* Process CPU time at the start, in ns */
+    Uint64 iterations;                        /* SDL_AppIterate calls so far */
+    Uint64 frames;                            /* Frames presented so far */
+    Uint64 last_present;                      /* End of the last present */
+    Uint64 intervals[PACING_MEASURE_FRAMES];  /* Ring buffer of the time between presents */
+    char label[64];                           /* Options being measured, for the report */
+} Pacing;
+
 /*
  * Structure to Hold the Application State
  *
@@ -79,182 +558,2755 @@ typedef struct
  */
 typedef struct
 {
-    SDL_Window *window;     /* SDL window */
-    SDL_Renderer *renderer; /* SDL renderer */
-    GameContext game_ctx;   /* Game context/state */
-    Uint64 last_step;       /* Time of last game logic update */
+    SDL_Window *window;                            /* SDL window */
+    SDL_Renderer *renderer;                        /* SDL renderer */
+    GameContext game_ctx;                          /* Game context/state */
+    Uint64 last_step;                              /* Time of last game logic update */
+    Uint64 steps;                                  /* Steps taken by SDL_AppIterate */
+    Journal journal;                               /* Input journal being recorded */
+    SDL_Texture *target;                           /* Persistent render target for dirty-region rendering, or NULL */
+    bool target_valid;                             /* Whether target currently shows drawn */
+    GameContext drawn;                             /* Game state as last drawn on target */
+    SDL_FRect batch[CELL_TYPES][VIEW_MATRIX_SIZE]; /* Rectangles to fill, grouped by CellType */
+    SDL_Thread *sim_thread;                        /* Simulation thread, or NULL to step in SDL_AppIterate */
+    SimState sim;                                  /* State shared with the simulation thread */
+    Uint64 shown_step;                             /* Step of the snapshot in game_ctx */
+    int prev_xpos;                                 /* Player position one step before game_ctx */
+    int prev_ypos;
+    Camera camera;                                 /* Part of the grid in view */
+    Arena arena;                                   /* Memory for the entities */
+    EntityPool entities;                           /* Entities besides the player */
+    Pacing pacing;                                 /* When frames are drawn */
+#if FRAME_STATS
+    FrameStats stats; /* Frame timings */
+#endif
 } AppState;
 
+/*
+ * Colors of Each Cell Type
+ *
+ * Empty cells are drawn in the background color, which lets dirty-region
+ * rendering erase a cell by filling it like any other.
+ */
+static const SDL_Color cell_colors_[CELL_TYPES] = {
+    {0, 0, 0, SDL_ALPHA_OPAQUE},     /* CELL_EMPTY: background */
+    {255, 255, 0, SDL_ALPHA_OPAQUE}, /* CELL_PLAYER */
+    {0, 128, 0, SDL_ALPHA_OPAQUE},   /* Other cells */
+    {0, 128, 0, SDL_ALPHA_OPAQUE},
+    {0, 128, 0, SDL_ALPHA_OPAQUE},
+    {0, 128, 0, SDL_ALPHA_OPAQUE},
+};
+
+/*
+ * Function to Hash One Cell for the Grid Hash
+ *
+ * A splitmix64 finalizer over the cell's index and type; sums of these are
+ * order-independent, so every layout can visit cells in its own order.
+ */
+static Uint64 cell_hash_(Uint64 index, CellType ct)
+{
+    Uint64 z = (index << 3) | (Uint64)ct;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+#if GRID_LAYOUT != GRID_LAYOUT_PACKED
+
+/*
+ * Function to Count the Set Bits in a Word
+ */
+static unsigned popcount64_(Uint64 w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(w);
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ULL);
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (unsigned)((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/*
+ * Function to Find the Lowest Set Bit in a Non-Zero Word
+ */
+static unsigned lowest_bit64_(Uint64 w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(w);
+#else
+    return popcount64_((w & (0 - w)) - 1);
+#endif
+}
+
+/*
+ * Function to Build the Mask of Bits [lo, hi) in a Word
+ */
+static Uint64 bit_range64_(unsigned lo, unsigned hi)
+{
+    const Uint64 upto_hi = hi >= 64U ? ~0ULL : (1ULL << hi) - 1;
+    return upto_hi & ~((1ULL << lo) - 1);
+}
+
+#endif /* GRID_LAYOUT != GRID_LAYOUT_PACKED */
+
+#if GRID_LAYOUT == GRID_LAYOUT_CHUNKED
+
+/*
+ * Function to Find a Chunk by Chunk Coordinates
+ *
+ * Returns NULL if the chunk holds no cells.
+ */
+static GridChunk *chunk_at_(const GameContext *ctx, unsigned cx, unsigned cy)
+{
+    const GridRegion *region = ctx->regions[(cy / REGION_CHUNKS) * REGIONS_X + cx / REGION_CHUNKS];
+    return region ? region->chunks[(cy % REGION_CHUNKS) * REGION_CHUNKS + cx % REGION_CHUNKS] : NULL;
+}
+
+/*
+ * Function to Find or Allocate a Chunk by Chunk Coordinates
+ *
+ * Returns NULL if memory runs out.
+ */
+static GridChunk *chunk_alloc_(GameContext *ctx, unsigned cx, unsigned cy)
+{
+    GridRegion **region = &ctx->regions[(cy / REGION_CHUNKS) * REGIONS_X + cx / REGION_CHUNKS];
+    GridChunk **chunk;
+
+    if (!*region && (*region = SDL_calloc(1, sizeof(GridRegion))) == NULL)
+    {
+        return NULL;
+    }
+    chunk = &(*region)->chunks[(cy % REGION_CHUNKS) * REGION_CHUNKS + cx % REGION_CHUNKS];
+    if (!*chunk)
+    {
+        if ((*chunk = SDL_calloc(1, sizeof(GridChunk))) == NULL)
+        {
+            if ((*region)->count == 0)
+            {
+                SDL_free(*region);
+                *region = NULL;
+            }
+            return NULL;
+        }
+        (*region)->count++;
+    }
+    return *chunk;
+}
+
+/*
+ * Function to Free a Chunk Once It Holds No Cells
+ *
+ * The chunk's region is freed along with its last chunk.
+ */
+static void chunk_release_(GameContext *ctx, unsigned cx, unsigned cy)
+{
+    GridRegion **region = &ctx->regions[(cy / REGION_CHUNKS) * REGIONS_X + cx / REGION_CHUNKS];
+    GridChunk **chunk = &(*region)->chunks[(cy % REGION_CHUNKS) * REGION_CHUNKS + cx % REGION_CHUNKS];
+
+    if ((*chunk)->occupied > 0)
+    {
+        return;
+    }
+    SDL_free(*chunk);
+    *chunk = NULL;
+    if (--(*region)->count == 0)
+    {
+        SDL_free(*region);
+        *region = NULL;
+    }
+}
+
 /*
  * Function to Get the CellType at a Given Position
  *
- * This function retrieves the type of cell at the specified (x, y) position
- * in the game grid using bit manipulation for efficient storage.
+ * This function gathers one bit from each bitplane of the cell's chunk.
  */
-CellType cell_at(const GameContext *ctx, char x, char y)
+CellType cell_at(const GameContext *ctx, int x, int y)
 {
-    const int shift = SHIFT(x, y);
-    unsigned short range;
-    SDL_memcpy(&range, ctx->cells + (shift / 8), sizeof(range));
-    return (CellType)((range >> (shift % 8)) & THREE_BITS);
+    const GridChunk *chunk = chunk_at_(ctx, (unsigned)x / CHUNK_SIZE, (unsigned)y / CHUNK_SIZE);
+    const unsigned row = (unsigned)y % CHUNK_SIZE;
+    const unsigned bit = (unsigned)x % CHUNK_SIZE;
+    if (!chunk)
+    {
+        return CELL_EMPTY;
+    }
+    return (CellType)(((chunk->planes[0][row] >> bit) & 1U) |
+                      (((chunk->planes[1][row] >> bit) & 1U) << 1) |
+                      (((chunk->planes[2][row] >> bit) & 1U) << 2));
+}
+
+/*
+ * Function to Set the CellType at a Given Position
+ *
+ * This function allocates the cell's chunk on first use and frees it when
+ * its last cell is emptied. If memory runs out the cell is left unchanged.
+ */
+static void put_cell_at_(GameContext *ctx, int x, int y, CellType ct)
+{
+    const unsigned cx = (unsigned)x / CHUNK_SIZE;
+    const unsigned cy = (unsigned)y / CHUNK_SIZE;
+    const unsigned row = (unsigned)y % CHUNK_SIZE;
+    const Uint64 mask = 1ULL << ((unsigned)x % CHUNK_SIZE);
+    GridChunk *chunk = ct == CELL_EMPTY ? chunk_at_(ctx, cx, cy) : chunk_alloc_(ctx, cx, cy);
+    unsigned was_occupied;
+    unsigned p;
+
+    if (!chunk)
+    {
+        return;
+    }
+    was_occupied = ((chunk->planes[0][row] | chunk->planes[1][row] | chunk->planes[2][row]) & mask) != 0;
+    for (p = 0; p < CELL_MAX_BITS; p++)
+    {
+        const Uint64 set = 0 - (Uint64)((ct >> p) & 1U); /* All ones if bit p of ct is set */
+        chunk->planes[p][row] = (chunk->planes[p][row] & ~mask) | (set & mask);
+    }
+    chunk->occupied = chunk->occupied - was_occupied + (ct != CELL_EMPTY);
+    chunk_release_(ctx, cx, cy);
+}
+
+/*
+ * Function to Clear the Whole Game Grid
+ *
+ * This function frees every chunk and region.
+ */
+static void grid_clear_(GameContext *ctx)
+{
+    unsigned r;
+    unsigned c;
+    for (r = 0; r < REGIONS_X * REGIONS_Y; r++)
+    {
+        if (ctx->regions[r])
+        {
+            for (c = 0; c < REGION_CHUNKS * REGION_CHUNKS; c++)
+            {
+                SDL_free(ctx->regions[r]->chunks[c]);
+            }
+            SDL_free(ctx->regions[r]);
+            ctx->regions[r] = NULL;
+        }
+    }
+}
+
+/*
+ * Function to Count the Cells of One Type
+ *
+ * Only allocated chunks are visited; empty cells are counted as the rest.
+ */
+Uint64 grid_count(const GameContext *ctx, CellType ct)
+{
+    Uint64 n = 0;
+    unsigned r;
+    unsigned c;
+    unsigned row;
+    for (r = 0; r < REGIONS_X * REGIONS_Y; r++)
+    {
+        for (c = 0; ctx->regions[r] && c < REGION_CHUNKS * REGION_CHUNKS; c++)
+        {
+            const GridChunk *chunk = ctx->regions[r]->chunks[c];
+            if (!chunk)
+            {
+                continue;
+            }
+            for (row = 0; ct != CELL_EMPTY && row < CHUNK_SIZE; row++)
+            {
+                n += popcount64_((ct & 1U ? chunk->planes[0][row] : ~chunk->planes[0][row]) &
+                                 (ct & 2U ? chunk->planes[1][row] : ~chunk->planes[1][row]) &
+                                 (ct & 4U ? chunk->planes[2][row] : ~chunk->planes[2][row]));
+            }
+            n += ct == CELL_EMPTY ? chunk->occupied : 0;
+        }
+    }
+    return ct == CELL_EMPTY ? (Uint64)GAME_GRID_WIDTH * GAME_GRID_HEIGHT - n : n;
+}
+
+/*
+ * Function to Clear a Rectangular Region of the Game Grid
+ *
+ * Each allocated chunk overlapping the region is cleared a row word at a
+ * time, and freed if nothing is left in it. The region is clipped to the
+ * grid.
+ */
+void grid_clear_region(GameContext *ctx, unsigned x, unsigned y, unsigned w, unsigned h)
+{
+    unsigned cx;
+    unsigned cy;
+    unsigned row;
+    if (x >= GAME_GRID_WIDTH || y >= GAME_GRID_HEIGHT)
+    {
+        return;
+    }
+    w = SDL_min(w, GAME_GRID_WIDTH - x);
+    h = SDL_min(h, GAME_GRID_HEIGHT - y);
+    if (w == 0 || h == 0)
+    {
+        return;
+    }
+    for (cy = y / CHUNK_SIZE; cy <= (y + h - 1U) / CHUNK_SIZE; cy++)
+    {
+        for (cx = x / CHUNK_SIZE; cx <= (x + w - 1U) / CHUNK_SIZE; cx++)
+        {
+            GridChunk *chunk = chunk_at_(ctx, cx, cy);
+            const unsigned lo = SDL_max(x, cx * CHUNK_SIZE) - cx * CHUNK_SIZE;
+            const unsigned hi = SDL_min(x + w, (cx + 1U) * CHUNK_SIZE) - cx * CHUNK_SIZE;
+            const unsigned top = SDL_max(y, cy * CHUNK_SIZE) - cy * CHUNK_SIZE;
+            const unsigned bottom = SDL_min(y + h, (cy + 1U) * CHUNK_SIZE) - cy * CHUNK_SIZE;
+            const Uint64 mask = bit_range64_(lo, hi);
+            if (!chunk)
+            {
+                continue;
+            }
+            for (row = top; row < bottom; row++)
+            {
+                chunk->occupied -= popcount64_((chunk->planes[0][row] | chunk->planes[1][row] | chunk->planes[2][row]) & mask);
+                chunk->planes[0][row] &= ~mask;
+                chunk->planes[1][row] &= ~mask;
+                chunk->planes[2][row] &= ~mask;
+            }
+            chunk_release_(ctx, cx, cy);
+        }
+    }
+}
+
+/*
+ * Function to List the Non-Empty Cells in View
+ *
+ * This function writes the view index (x + y * VIEW_GRID_WIDTH, relative to
+ * the camera) of every non-empty visible cell to out and returns how many
+ * it wrote. Only chunks overlapping the view are visited. out must hold
+ * VIEW_MATRIX_SIZE entries.
+ */
+unsigned grid_visible(const GameContext *ctx, const Camera *cam, Uint32 *out)
+{
+    const unsigned x0 = (unsigned)cam->x;
+    const unsigned y0 = (unsigned)cam->y;
+    unsigned n = 0;
+    unsigned cx;
+    unsigned cy;
+    unsigned y;
+    for (cy = y0 / CHUNK_SIZE; cy <= (y0 + VIEW_GRID_HEIGHT - 1U) / CHUNK_SIZE; cy++)
+    {
+        for (cx = x0 / CHUNK_SIZE; cx <= (x0 + VIEW_GRID_WIDTH - 1U) / CHUNK_SIZE; cx++)
+        {
+            const GridChunk *chunk = chunk_at_(ctx, cx, cy);
+            const unsigned lo = SDL_max(x0, cx * CHUNK_SIZE) - cx * CHUNK_SIZE;
+            const unsigned hi = SDL_min(x0 + VIEW_GRID_WIDTH, (cx + 1U) * CHUNK_SIZE) - cx * CHUNK_SIZE;
+            const Uint64 mask = bit_range64_(lo, hi);
+            if (!chunk)
+            {
+                continue;
+            }
+            for (y = SDL_max(y0, cy * CHUNK_SIZE); y < SDL_min(y0 + VIEW_GRID_HEIGHT, (cy + 1U) * CHUNK_SIZE); y++)
+            {
+                const unsigned row = y % CHUNK_SIZE;
+                Uint64 m = (chunk->planes[0][row] | chunk->planes[1][row] | chunk->planes[2][row]) & mask;
+                while (m)
+                {
+                    const unsigned x = cx * CHUNK_SIZE + lowest_bit64_(m);
+                    out[n++] = (Uint32)((x - x0) + (y - y0) * VIEW_GRID_WIDTH);
+                    m &= m - 1;
+                }
+            }
+        }
+    }
+    return n;
+}
+
+/*
+ * Function to Hash the Grid
+ *
+ * This function sums a hash of the position and type of every non-empty
+ * cell, visiting only allocated chunks. Any layout gives the same value
+ * for the same cells.
+ */
+static Uint64 grid_hash_(const GameContext *ctx)
+{
+    Uint64 h = 0;
+    unsigned r;
+    unsigned c;
+    unsigned row;
+    for (r = 0; r < REGIONS_X * REGIONS_Y; r++)
+    {
+        for (c = 0; ctx->regions[r] && c < REGION_CHUNKS * REGION_CHUNKS; c++)
+        {
+            const GridChunk *chunk = ctx->regions[r]->chunks[c];
+            const unsigned cx = (r % REGIONS_X) * REGION_CHUNKS + c % REGION_CHUNKS;
+            const unsigned cy = (r / REGIONS_X) * REGION_CHUNKS + c / REGION_CHUNKS;
+            for (row = 0; chunk && row < CHUNK_SIZE; row++)
+            {
+                Uint64 m = chunk->planes[0][row] | chunk->planes[1][row] | chunk->planes[2][row];
+                while (m)
+                {
+                    const unsigned bit = lowest_bit64_(m);
+                    const Uint64 x = cx * CHUNK_SIZE + bit;
+                    const Uint64 y = cy * CHUNK_SIZE + row;
+                    const unsigned ct = (unsigned)(((chunk->planes[0][row] >> bit) & 1U) |
+                                                   (((chunk->planes[1][row] >> bit) & 1U) << 1) |
+                                                   (((chunk->planes[2][row] >> bit) & 1U) << 2));
+                    h += cell_hash_(x + y * GAME_GRID_WIDTH, (CellType)ct);
+                    m &= m - 1;
+                }
+            }
+        }
+    }
+    return h;
+}
+
+#elif GRID_LAYOUT == GRID_LAYOUT_BITPLANE
+
+/*
+ * Function to Get the CellType at a Given Position
+ *
+ * This function gathers one bit from each bitplane of the game grid.
+ */
+CellType cell_at(const GameContext *ctx, int x, int y)
+{
+    const unsigned index = (unsigned)x + (unsigned)y * GAME_GRID_WIDTH;
+    const unsigned word = index / 64U;
+    const unsigned bit = index % 64U;
+    return (CellType)(((ctx->planes[0][word] >> bit) & 1U) |
+                      (((ctx->planes[1][word] >> bit) & 1U) << 1) |
+                      (((ctx->planes[2][word] >> bit) & 1U) << 2));
+}
+
+/*
+ * Function to Set the CellType at a Given Position
+ *
+ * This function clears the cell's bit in every bitplane and sets it again
+ * in the planes selected by ct.
+ */
+static void put_cell_at_(GameContext *ctx, int x, int y, CellType ct)
+{
+    const unsigned index = (unsigned)x + (unsigned)y * GAME_GRID_WIDTH;
+    const unsigned word = index / 64U;
+    const Uint64 mask = 1ULL << (index % 64U);
+    unsigned p;
+    for (p = 0; p < CELL_MAX_BITS; p++)
+    {
+        const Uint64 set = 0 - (Uint64)((ct >> p) & 1U); /* All ones if bit p of ct is set */
+        ctx->planes[p][word] = (ctx->planes[p][word] & ~mask) | (set & mask);
+    }
+}
+
+/*
+ * Function to Build the Mask of Cells of One Type in a Word
+ *
+ * Cells outside the grid in the last word are never reported.
+ */
+static Uint64 type_mask_(const GameContext *ctx, unsigned word, CellType ct)
+{
+    Uint64 m = word == GRID_WORDS - 1 ? bit_range64_(0, GAME_MATRIX_SIZE - word * 64U) : ~0ULL;
+    unsigned p;
+    for (p = 0; p < CELL_MAX_BITS; p++)
+    {
+        m &= (ct >> p) & 1U ? ctx->planes[p][word] : ~ctx->planes[p][word];
+    }
+    return m;
+}
+
+/*
+ * Function to Clear the Whole Game Grid
+ */
+static void grid_clear_(GameContext *ctx)
+{
+    SDL_zeroa(ctx->planes);
+}
+
+/*
+ * Function to List All Non-Empty Cells
+ *
+ * This function writes the index (x + y * GAME_GRID_WIDTH) of every
+ * non-empty cell to out, in ascending order, and returns how many it wrote.
+ * out must hold GAME_MATRIX_SIZE entries.
+ */
+unsigned grid_occupied(const GameContext *ctx, Uint32 *out)
+{
+    unsigned n = 0;
+    unsigned w;
+    for (w = 0; w < GRID_WORDS; w++)
+    {
+        Uint64 m = ctx->planes[0][w] | ctx->planes[1][w] | ctx->planes[2][w];
+        while (m)
+        {
+            out[n++] = (Uint32)(w * 64U + lowest_bit64_(m));
+            m &= m - 1;
+        }
+    }
+    return n;
+}
+
+/*
+ * Function to Count the Cells of One Type
+ */
+Uint64 grid_count(const GameContext *ctx, CellType ct)
+{
+    Uint64 n = 0;
+    unsigned w;
+    for (w = 0; w < GRID_WORDS; w++)
+    {
+        n += popcount64_(type_mask_(ctx, w, ct));
+    }
+    return n;
+}
+
+/*
+ * Function to Clear a Rectangular Region of the Game Grid
+ *
+ * Each row of the region is a contiguous run of bits, cleared a word at a
+ * time in every plane. The region is clipped to the grid.
+ */
+void grid_clear_region(GameContext *ctx, unsigned x, unsigned y, unsigned w, unsigned h)
+{
+    unsigned row;
+    if (x >= GAME_GRID_WIDTH || y >= GAME_GRID_HEIGHT)
+    {
+        return;
+    }
+    w = SDL_min(w, GAME_GRID_WIDTH - x);
+    h = SDL_min(h, GAME_GRID_HEIGHT - y);
+    for (row = y; row < y + h; row++)
+    {
+        unsigned lo = row * GAME_GRID_WIDTH + x;
+        const unsigned hi = lo + w;
+        while (lo < hi)
+        {
+            const unsigned word = lo / 64U;
+            const unsigned end = SDL_min(hi, (word + 1U) * 64U);
+            const Uint64 keep = ~bit_range64_(lo % 64U, end - word * 64U);
+            unsigned p;
+            for (p = 0; p < CELL_MAX_BITS; p++)
+            {
+                ctx->planes[p][word] &= keep;
+            }
+            lo = end;
+        }
+    }
+}
+
+/*
+ * Function to List the Cells That Differ Between Two Grids
+ *
+ * This function writes the index of every cell whose type differs between
+ * a and b to out, in ascending order, and returns how many it wrote.
+ * out must hold GAME_MATRIX_SIZE entries.
+ */
+unsigned grid_diff(const GameContext *a, const GameContext *b, Uint32 *out)
+{
+    unsigned n = 0;
+    unsigned w;
+    for (w = 0; w < GRID_WORDS; w++)
+    {
+        Uint64 m = (a->planes[0][w] ^ b->planes[0][w]) |
+                   (a->planes[1][w] ^ b->planes[1][w]) |
+                   (a->planes[2][w] ^ b->planes[2][w]);
+        while (m)
+        {
+            out[n++] = (Uint32)(w * 64U + lowest_bit64_(m));
+            m &= m - 1;
+        }
+    }
+    return n;
+}
+
+#else /* GRID_LAYOUT_PACKED */
+
+/*
+ * Function to Get the CellType at a Given Position
+ *
+ * This function retrieves the type of cell at the specified (x, y) position
+ * in the game grid using bit manipulation for efficient storage.
+ */
+CellType cell_at(const GameContext *ctx, int x, int y)
+{
+    const int shift = SHIFT(x, y);
+    unsigned short range;
+    SDL_memcpy(&range, ctx->cells + (shift / 8), sizeof(range));
+    return (CellType)((range >> (shift % 8)) & THREE_BITS);
+}
+
+/*
+ * Function to Set the CellType at a Given Position
+ *
+ * This function sets the type of cell at the specified (x, y) position
+ * in the game grid using bit manipulation for efficient storage.
+ */
+static void put_cell_at_(GameContext *ctx, int x, int y, CellType ct)
+{
+    const int shift = SHIFT(x, y);
+    const int adjust = shift % 8;
+    unsigned char *const pos = ctx->cells + (shift / 8);
+    unsigned short range;
+    SDL_memcpy(&range, pos, sizeof(range));
+    range &= ~(THREE_BITS << adjust);     /* Clear bits */
+    range |= (ct & THREE_BITS) << adjust; /* Set bits */
+    SDL_memcpy(pos, &range, sizeof(range));
+}
+
+/*
+ * Function to Clear the Whole Game Grid
+ */
+static void grid_clear_(GameContext *ctx)
+{
+    SDL_zeroa(ctx->cells);
+}
+
+/*
+ * Function to List All Non-Empty Cells
+ *
+ * This function writes the index (x + y * GAME_GRID_WIDTH) of every
+ * non-empty cell to out, in ascending order, and returns how many it wrote.
+ * out must hold GAME_MATRIX_SIZE entries.
+ */
+unsigned grid_occupied(const GameContext *ctx, Uint32 *out)
+{
+    unsigned n = 0;
+    unsigned i;
+    for (i = 0; i < GAME_MATRIX_SIZE; i++)
+    {
+        if (cell_at(ctx, i % GAME_GRID_WIDTH, i / GAME_GRID_WIDTH) != CELL_EMPTY)
+        {
+            out[n++] = (Uint32)i;
+        }
+    }
+    return n;
+}
+
+/*
+ * Function to Count the Cells of One Type
+ */
+Uint64 grid_count(const GameContext *ctx, CellType ct)
+{
+    Uint64 n = 0;
+    unsigned i;
+    for (i = 0; i < GAME_MATRIX_SIZE; i++)
+    {
+        n += cell_at(ctx, i % GAME_GRID_WIDTH, i / GAME_GRID_WIDTH) == ct;
+    }
+    return n;
+}
+
+/*
+ * Function to Clear a Rectangular Region of the Game Grid
+ *
+ * The region is clipped to the grid.
+ */
+void grid_clear_region(GameContext *ctx, unsigned x, unsigned y, unsigned w, unsigned h)
+{
+    unsigned i;
+    unsigned j;
+    if (x >= GAME_GRID_WIDTH || y >= GAME_GRID_HEIGHT)
+    {
+        return;
+    }
+    w = SDL_min(w, GAME_GRID_WIDTH - x);
+    h = SDL_min(h, GAME_GRID_HEIGHT - y);
+    for (j = y; j < y + h; j++)
+    {
+        for (i = x; i < x + w; i++)
+        {
+            put_cell_at_(ctx, i, j, CELL_EMPTY);
+        }
+    }
+}
+
+/*
+ * Function to List the Cells That Differ Between Two Grids
+ *
+ * This function writes the index of every cell whose type differs between
+ * a and b to out, in ascending order, and returns how many it wrote.
+ * out must hold GAME_MATRIX_SIZE entries.
+ */
+unsigned grid_diff(const GameContext *a, const GameContext *b, Uint32 *out)
+{
+    unsigned n = 0;
+    unsigned i;
+    for (i = 0; i < GAME_MATRIX_SIZE; i++)
+    {
+        const int x = i % GAME_GRID_WIDTH;
+        const int y = i / GAME_GRID_WIDTH;
+        if (cell_at(a, x, y) != cell_at(b, x, y))
+        {
+            out[n++] = (Uint32)i;
+        }
+    }
+    return n;
+}
+
+#endif /* GRID_LAYOUT */
+
+#if GRID_INLINE
+
+/*
+ * Function to List the Non-Empty Cells in View
+ *
+ * This function writes the view index (x + y * VIEW_GRID_WIDTH, relative to
+ * the camera) of every non-empty visible cell to out and returns how many
+ * it wrote. out must hold VIEW_MATRIX_SIZE entries.
+ */
+unsigned grid_visible(const GameContext *ctx, const Camera *cam, Uint32 *out)
+{
+    unsigned n = 0;
+    unsigned x;
+    unsigned y;
+#if VIEW_IS_WORLD
+    (void)cam; /* The whole grid is in view, so view and grid indices match */
+    (void)x;
+    (void)y;
+    n = grid_occupied(ctx, out);
+#else
+    for (y = 0; y < VIEW_GRID_HEIGHT; y++)
+    {
+        for (x = 0; x < VIEW_GRID_WIDTH; x++)
+        {
+            if (cell_at(ctx, cam->x + (int)x, cam->y + (int)y) != CELL_EMPTY)
+            {
+                out[n++] = (Uint32)(x + y * VIEW_GRID_WIDTH);
+            }
+        }
+    }
+#endif
+    return n;
+}
+
+/*
+ * Function to Hash the Grid
+ *
+ * This function sums a hash of the position and type of every non-empty
+ * cell. Any layout gives the same value for the same cells.
+ */
+static Uint64 grid_hash_(const GameContext *ctx)
+{
+    Uint64 h = 0;
+    unsigned i;
+    for (i = 0; i < GAME_MATRIX_SIZE; i++)
+    {
+        const CellType ct = cell_at(ctx, i % GAME_GRID_WIDTH, i / GAME_GRID_WIDTH);
+        if (ct != CELL_EMPTY)
+        {
+            h += cell_hash_(i, ct);
+        }
+    }
+    return h;
+}
+
+#endif /* GRID_INLINE */
+
+/*
+ * Function to Set the Position of an SDL_FRect Based on Grid Coordinates
+ *
+ * This function calculates the pixel position of a rectangle (used for rendering)
+ * based on grid coordinates and the size of each block.
+ */
+static void set_rect_xy_(SDL_FRect *r, short x, short y)
+{
+    r->x = (float)(x * BLOCK_SIZE_IN_PIXELS);
+    r->y = (float)(y * BLOCK_SIZE_IN_PIXELS);
+}
+
+/*
+ * Function to Wrap Around Grid Boundaries
+ *
+ * This function ensures that a value wraps around if it goes beyond the grid boundaries,
+ * allowing for continuous movement from one edge of the grid to the opposite edge.
+ * The value may be at most one cell outside the grid. There are no branches, so
+ * loops that wrap many values can be vectorized.
+ */
+static void wrap_around_(int *val, int max)
+{
+    *val += max & -(*val < 0);
+    *val -= max & -(*val > max - 1);
+}
+
+/*
+ * Functions to Get the Column and Row Change of a Step in a Direction
+ *
+ * Computed with comparisons rather than a switch, so they vectorize.
+ */
+static int dir_dx_(int dir)
+{
+    return (dir == DIR_RIGHT) - (dir == DIR_LEFT);
+}
+
+static int dir_dy_(int dir)
+{
+    return (dir == DIR_DOWN) - (dir == DIR_UP);
+}
+
+#if GRID_UPDATE
+
+static TilePool update_pool_;                          /* Threads that run the whole-grid update */
+static Uint64 update_next_[CELL_MAX_BITS][GRID_WORDS]; /* The new grid while it is being computed */
+
+/*
+ * Function to Take One Tile From a Worker's Range
+ *
+ * The owner takes from the front, thieves take from the back. Returns the
+ * tile, or -1 once the range is empty; an empty range stays empty until
+ * the next pass.
+ */
+static int tile_take_(TileRange *r, bool steal)
+{
+    for (;;)
+    {
+        const Uint32 range = (Uint32)SDL_GetAtomicInt(&r->range);
+        const Uint32 next = range & 0xFFFFU;
+        const Uint32 end = range >> 16;
+        if (next >= end)
+        {
+            return -1;
+        }
+        if (SDL_CompareAndSwapAtomicInt(&r->range, (int)range, (int)(steal ? next | (end - 1U) << 16 : (next + 1U) | end << 16)))
+        {
+            return (int)(steal ? end - 1U : next);
+        }
+    }
+}
+
+/*
+ * Function to Work Through Tiles Until None Are Left
+ *
+ * A worker first empties its own range, then steals from every other
+ * worker's range in turn.
+ */
+static void tile_work_(TilePool *pool, unsigned self)
+{
+    unsigned i;
+    int tile;
+    while ((tile = tile_take_(&pool->ranges[self], false)) >= 0)
+    {
+        pool->func(pool->arg, (unsigned)tile);
+    }
+    for (i = 1; i < pool->jobs; i++)
+    {
+        TileRange *victim = &pool->ranges[(self + i) % pool->jobs];
+        while ((tile = tile_take_(victim, true)) >= 0)
+        {
+            pool->func(pool->arg, (unsigned)tile);
+        }
+    }
+}
+
+/*
+ * Tile Pool Thread Function
+ *
+ * This function sleeps until a pass starts, works through tiles until the
+ * pass has none left, and reports back, until the pool stops.
+ */
+static int SDLCALL tile_worker_(void *data)
+{
+    const TileWorker *worker = (const TileWorker *)data;
+    TilePool *pool = worker->pool;
+    unsigned seen = 0;
+
+    for (;;)
+    {
+        SDL_LockMutex(pool->lock);
+        while (!pool->quit && pool->pass == seen)
+        {
+            SDL_WaitCondition(pool->wake, pool->lock);
+        }
+        if (pool->quit)
+        {
+            SDL_UnlockMutex(pool->lock);
+            return 0;
+        }
+        seen = pool->pass;
+        SDL_UnlockMutex(pool->lock);
+
+        tile_work_(pool, worker->index);
+
+        SDL_LockMutex(pool->lock);
+        if (--pool->busy == 0)
+        {
+            SDL_SignalCondition(pool->idle);
+        }
+        SDL_UnlockMutex(pool->lock);
+    }
+}
+
+/*
+ * Function to Start a Tile Pool
+ *
+ * jobs is the number of workers including the calling thread; 0 means one
+ * per core. If threads cannot be created the pool runs with fewer, down to
+ * the calling thread alone.
+ */
+static void tile_pool_start_(TilePool *pool, unsigned jobs)
+{
+    unsigned i;
+    SDL_zerop(pool);
+    if (jobs == 0)
+    {
+        jobs = (unsigned)SDL_max(SDL_GetNumLogicalCPUCores(), 1);
+    }
+    pool->jobs = 1;
+    pool->lock = SDL_CreateMutex();
+    pool->wake = SDL_CreateCondition();
+    pool->idle = SDL_CreateCondition();
+    if (!pool->lock || !pool->wake || !pool->idle)
+    {
+        return;
+    }
+    for (i = 1; i < SDL_min(jobs, UPDATE_MAX_JOBS); i++)
+    {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        pool->threads[i] = SDL_CreateThread(tile_worker_, "tile", &pool->workers[i]);
+        if (!pool->threads[i])
+        {
+            SDL_Log("Failed to start tile worker %u: %s", i, SDL_GetError());
+            break;
+        }
+        pool->jobs++;
+    }
+}
+
+/*
+ * Function to Stop a Tile Pool and Wait for Its Threads
+ */
+static void tile_pool_stop_(TilePool *pool)
+{
+    unsigned i;
+    if (pool->lock)
+    {
+        SDL_LockMutex(pool->lock);
+        pool->quit = true;
+        SDL_BroadcastCondition(pool->wake);
+        SDL_UnlockMutex(pool->lock);
+    }
+    for (i = 1; i < pool->jobs; i++)
+    {
+        SDL_WaitThread(pool->threads[i], NULL);
+    }
+    SDL_DestroyCondition(pool->idle);
+    SDL_DestroyCondition(pool->wake);
+    SDL_DestroyMutex(pool->lock);
+    SDL_zerop(pool);
+}
+
+/*
+ * Function to Run func on Every Tile, Spread Over the Pool
+ *
+ * Each worker starts with an equal, contiguous share of the tiles; workers
+ * that finish early steal from the others. Returns once every tile is done.
+ * Small passes run on the calling thread alone.
+ */
+static void tile_pool_run_(TilePool *pool, unsigned tiles, TileFunc func, void *arg)
+{
+    unsigned i;
+    if (pool->jobs <= 1 || tiles <= 1)
+    {
+        for (i = 0; i < tiles; i++)
+        {
+            func(arg, i);
+        }
+        return;
+    }
+    for (i = 0; i < pool->jobs; i++)
+    {
+        const Uint32 first = tiles * i / pool->jobs;
+        const Uint32 end = tiles * (i + 1U) / pool->jobs;
+        SDL_SetAtomicInt(&pool->ranges[i].range, (int)(first | end << 16));
+    }
+
+    SDL_LockMutex(pool->lock);
+    pool->func = func;
+    pool->arg = arg;
+    pool->busy = pool->jobs - 1;
+    pool->pass++;
+    SDL_BroadcastCondition(pool->wake);
+    SDL_UnlockMutex(pool->lock);
+
+    tile_work_(pool, 0);
+
+    SDL_LockMutex(pool->lock);
+    while (pool->busy > 0)
+    {
+        SDL_WaitCondition(pool->idle, pool->lock);
+    }
+    SDL_UnlockMutex(pool->lock);
+}
+
+/*
+ * Function to Compute the Next Type of One Cell
+ *
+ * This is the rule of the whole-grid update. CELL_TYPE2 cells follow
+ * Conway's Game of Life on the wrapping grid: one with two or three
+ * CELL_TYPE2 neighbours survives, and an empty cell with exactly three
+ * becomes one. All other cells, the player included, are left alone.
+ */
+static CellType cell_rule_(const GameContext *ctx, int x, int y)
+{
+    const CellType ct = cell_at(ctx, x, y);
+    const int left = x > 0 ? x - 1 : (int)GAME_GRID_WIDTH - 1;
+    const int right = x < (int)GAME_GRID_WIDTH - 1 ? x + 1 : 0;
+    const int up = y > 0 ? y - 1 : (int)GAME_GRID_HEIGHT - 1;
+    const int down = y < (int)GAME_GRID_HEIGHT - 1 ? y + 1 : 0;
+    unsigned n;
+
+    if (ct != CELL_EMPTY && ct != CELL_TYPE2)
+    {
+        return ct;
+    }
+    n = (cell_at(ctx, left, up) == CELL_TYPE2) + (cell_at(ctx, x, up) == CELL_TYPE2) +
+        (cell_at(ctx, right, up) == CELL_TYPE2) + (cell_at(ctx, left, y) == CELL_TYPE2) +
+        (cell_at(ctx, right, y) == CELL_TYPE2) + (cell_at(ctx, left, down) == CELL_TYPE2) +
+        (cell_at(ctx, x, down) == CELL_TYPE2) + (cell_at(ctx, right, down) == CELL_TYPE2);
+    return n == 3 || (n == 2 && ct == CELL_TYPE2) ? CELL_TYPE2 : CELL_EMPTY;
+}
+
+/*
+ * Function to Compute One Tile of the New Grid
+ *
+ * Reads only the current grid and writes only this tile's words of
+ * update_next_, so tiles can be computed in any order on any thread.
+ */
+static void update_tile_(void *arg, unsigned tile)
+{
+    const GameContext *ctx = (const GameContext *)arg;
+    const unsigned first = tile * UPDATE_TILE_WORDS;
+    const unsigned last = SDL_min(first + UPDATE_TILE_WORDS, GRID_WORDS);
+    unsigned w;
+    unsigned bit;
+    unsigned p;
+
+    for (w = first; w < last; w++)
+    {
+        Uint64 out[CELL_MAX_BITS] = {0};
+        const unsigned cells = SDL_min(64U, GAME_MATRIX_SIZE - w * 64U);
+        for (bit = 0; bit < cells; bit++)
+        {
+            const unsigned index = w * 64U + bit;
+            const unsigned ct = cell_rule_(ctx, (int)(index % GAME_GRID_WIDTH), (int)(index / GAME_GRID_WIDTH));
+            for (p = 0; p < CELL_MAX_BITS; p++)
+            {
+                out[p] |= (Uint64)((ct >> p) & 1U) << bit;
+            }
+        }
+        for (p = 0; p < CELL_MAX_BITS; p++)
+        {
+            update_next_[p][w] = out[p];
+        }
+    }
+}
+
+/*
+ * Function to Copy One Tile of the New Grid Into the Game State
+ */
+static void commit_tile_(void *arg, unsigned tile)
+{
+    GameContext *ctx = (GameContext *)arg;
+    const unsigned first = tile * UPDATE_TILE_WORDS;
+    const unsigned last = SDL_min(first + UPDATE_TILE_WORDS, GRID_WORDS);
+    unsigned p;
+    for (p = 0; p < CELL_MAX_BITS; p++)
+    {
+        SDL_memcpy(&ctx->planes[p][first], &update_next_[p][first], (last - first) * sizeof(Uint64));
+    }
+}
+
+/*
+ * Function to Apply cell_rule_ to the Whole Grid at Once
+ *
+ * The first pass computes every tile of the new grid from the old one; the
+ * second, which can only start once the first is done, copies it back.
+ */
+void grid_update(GameContext *ctx)
+{
+    tile_pool_run_(&update_pool_, UPDATE_TILES, update_tile_, ctx);
+    tile_pool_run_(&update_pool_, UPDATE_TILES, commit_tile_, ctx);
+}
+
+#endif /* GRID_UPDATE */
+
+/*
+ * Function to Initialize the Game State
+ *
+ * This function resets the game state to its initial conditions, placing the player
+ * at the center of the grid and clearing all other cells. With GRID_UPDATE set,
+ * it also scatters CELL_TYPE2 cells for the whole-grid update to work on.
+ */
+void game_initialize(GameContext *ctx)
+{
+#if GRID_UPDATE
+    unsigned i;
+#endif
+    grid_clear_(ctx);                       /* Clear the game grid */
+    ctx->player_xpos = GAME_GRID_WIDTH / 2; /* Set player position to center */
+    ctx->player_ypos = GAME_GRID_HEIGHT / 2;
+    ctx->next_dir = DIR_RIGHT;                                          /* Set initial direction */
+#if GRID_UPDATE
+    /* Scatter the same CELL_TYPE2 cells every time, leaving room around the player */
+    for (i = 0; i < GAME_MATRIX_SIZE; i++)
+    {
+        if (cell_hash_(i, CELL_TYPE2) % UPDATE_SOUP_CHANCE == 0)
+        {
+            put_cell_at_(ctx, (int)(i % GAME_GRID_WIDTH), (int)(i / GAME_GRID_WIDTH), CELL_TYPE2);
+        }
+    }
+    grid_clear_region(ctx, (unsigned)SDL_max(ctx->player_xpos - 2, 0), (unsigned)SDL_max(ctx->player_ypos - 2, 0), 5U, 5U);
+#endif
+    put_cell_at_(ctx, ctx->player_xpos, ctx->player_ypos, CELL_PLAYER); /* Place the player on the grid */
+}
+
+/*
+ * Function to Update the Player's Next Direction Based on Input
+ *
+ * This function sets the player's next movement direction, which will be used
+ * in the game logic update to move the player.
+ */
+void player_redir(GameContext *ctx, Direction dir)
+{
+    ctx->next_dir = dir;
+}
+
+/*
+ * Function to Update the Game Logic
+ *
+ * This function updates the game state, moving the player based on the current direction,
+ * wrapping around the grid boundaries, and handling interactions with other cells.
+ */
+void game_step(GameContext *ctx)
+{
+    CellType ct;
+    int prev_xpos = ctx->player_xpos;
+    int prev_ypos = ctx->player_ypos;
+
+#if GRID_UPDATE
+    /* Update every cell of the grid before the player moves */
+    grid_update(ctx);
+#endif
+
+    /* Move player based on next direction */
+    ctx->player_xpos += dir_dx_(ctx->next_dir);
+    ctx->player_ypos += dir_dy_(ctx->next_dir);
+
+    /* Wrap around the grid boundaries */
+    wrap_around_(&ctx->player_xpos, GAME_GRID_WIDTH);
+    wrap_around_(&ctx->player_ypos, GAME_GRID_HEIGHT);
+
+    /* Check for collisions or interactions */
+    ct = cell_at(ctx, ctx->player_xpos, ctx->player_ypos);
+    if (ct != CELL_EMPTY)
+    {
+        /* Handle collision or interaction (e.g., restart game) */
+        game_initialize(ctx);
+        return;
+    }
+
+    /* Update the player's position on the grid; setting first keeps a chunked grid from freeing the chunk in between */
+    put_cell_at_(ctx, ctx->player_xpos, ctx->player_ypos, CELL_PLAYER); /* Set new position */
+    put_cell_at_(ctx, prev_xpos, prev_ypos, CELL_EMPTY);                /* Clear previous position */
+}
+
+/*
+ * Function to Apply an Input Command to the Game State
+ */
+static void apply_input_(GameContext *ctx, Uint8 input)
+{
+    if (input == INPUT_RESTART)
+    {
+        game_initialize(ctx);
+    }
+    else if (input != INPUT_NONE)
+    {
+        player_redir(ctx, (Direction)input);
+    }
+}
+
+/*
+ * Function to Stop Recording After a Failed Write
+ */
+static void journal_fail_(Journal *j)
+{
+    SDL_Log("Journal: write failed, recording stopped: %s", SDL_GetError());
+    SDL_CloseIO(j->io);
+    j->io = NULL;
+}
+
+/*
+ * Function to Append Bytes to a Journal
+ */
+static void journal_write_(Journal *j, const void *data, size_t size)
+{
+    if (j->io && size > 0 && SDL_WriteIO(j->io, data, size) != size)
+    {
+        journal_fail_(j);
+    }
+    j->offset += size;
+}
+
+/*
+ * Function to Append One Record to a Journal
+ *
+ * The tag is written as a little-endian base-128 varint, so the records of
+ * a session with an input every few steps take two bytes each.
+ */
+static void journal_record_(Journal *j, Uint64 step, unsigned kind, const void *payload, size_t size)
+{
+    Uint64 tag = (step - j->last_step) << 2 | kind;
+    Uint8 bytes[10];
+    size_t n = 0;
+    do
+    {
+        bytes[n++] = (Uint8)((tag & 0x7FU) | (tag > 0x7FU ? 0x80U : 0U));
+        tag >>= 7;
+    } while (tag);
+    j->last_step = step;
+    journal_write_(j, bytes, n);
+    journal_write_(j, payload, size);
+}
+
+/*
+ * Function to Append a Checkpoint to a Journal
+ */
+static void journal_checkpoint_(Journal *j, Uint64 step, const GameContext *ctx)
+{
+    if (j->checkpoints == j->capacity)
+    {
+        const Uint64 capacity = j->capacity ? j->capacity * 2 : 64;
+        Uint64 *index = SDL_realloc(j->index, (size_t)capacity * 2 * sizeof(Uint64));
+        if (!index)
+        {
+            journal_fail_(j);
+            return;
+        }
+        j->index = index;
+        j->capacity = capacity;
+    }
+    j->index[j->checkpoints * 2] = step;
+    j->index[j->checkpoints * 2 + 1] = j->offset;
+    j->checkpoints++;
+    journal_record_(j, step, JOURNAL_CHECKPOINT, ctx, sizeof(*ctx));
+}
+
+/*
+ * Function to Start Recording a Journal
+ *
+ * ctx is the state before the first step; it becomes the first checkpoint.
+ */
+static bool journal_open_(Journal *j, const char *path, const GameContext *ctx)
+{
+    JournalHeader h;
+    SDL_zerop(j);
+    SDL_zero(h);
+    SDL_memcpy(h.magic, JOURNAL_MAGIC, sizeof(h.magic));
+    h.version = JOURNAL_VERSION;
+    h.layout = GRID_LAYOUT;
+    h.width = GAME_GRID_WIDTH;
+    h.height = GAME_GRID_HEIGHT;
+    h.context_size = sizeof(GameContext);
+    h.interval = JOURNAL_CHECKPOINT_INTERVAL;
+
+    j->io = SDL_IOFromFile(path, "wb");
+    if (!j->io)
+    {
+        SDL_Log("Journal: cannot create '%s': %s", path, SDL_GetError());
+        return false;
+    }
+    journal_write_(j, &h, sizeof(h));
+    journal_checkpoint_(j, 0, ctx);
+    return j->io != NULL;
+}
+
+/*
+ * Function to Record an Input Command Applied After step Steps
+ */
+static void journal_input_(Journal *j, Uint64 step, Uint8 input)
+{
+    if (j->io)
+    {
+        journal_record_(j, step, JOURNAL_INPUT, &input, sizeof(input));
+    }
+}
+
+/*
+ * Function to Note That step Steps Have Been Taken
+ *
+ * Writes a checkpoint every JOURNAL_CHECKPOINT_INTERVAL steps.
+ */
+static void journal_step_(Journal *j, Uint64 step, const GameContext *ctx)
+{
+    if (j->io && step % JOURNAL_CHECKPOINT_INTERVAL == 0)
+    {
+        journal_checkpoint_(j, step, ctx);
+    }
+}
+
+/*
+ * Function to Finish a Journal
+ *
+ * A last checkpoint of the final state lets a replay check that it ended
+ * where the recording did. The index and footer follow the end record.
+ */
+static void journal_close_(Journal *j, Uint64 step, const GameContext *ctx)
+{
+    JournalFooter f;
+    if (!j->io)
+    {
+        SDL_free(j->index);
+        SDL_zerop(j);
+        return;
+    }
+    if (j->index[(j->checkpoints - 1) * 2] != step)
+    {
+        journal_checkpoint_(j, step, ctx);
+    }
+    journal_record_(j, step, JOURNAL_END, NULL, 0);
+    SDL_zero(f);
+    f.checkpoints = j->checkpoints;
+    f.index_offset = j->offset;
+    SDL_memcpy(f.magic, JOURNAL_INDEX_MAGIC, sizeof(f.magic));
+    journal_write_(j, j->index, (size_t)j->checkpoints * 2 * sizeof(Uint64));
+    journal_write_(j, &f, sizeof(f));
+    if (j->io && !SDL_CloseIO(j->io))
+    {
+        SDL_Log("Journal: cannot finish writing: %s", SDL_GetError());
+    }
+    SDL_free(j->index);
+    SDL_zerop(j);
+}
+
+/*
+ * Function to Queue an Input Command
+ *
+ * Called only by the producer. Returns false if the queue is full.
+ */
+static bool input_push_(InputQueue *q, Uint8 input)
+{
+    const int tail = SDL_GetAtomicInt(&q->tail);
+    if ((unsigned)(tail - SDL_GetAtomicInt(&q->head)) >= INPUT_QUEUE_SIZE)
+    {
+        return false;
+    }
+    q->items[(unsigned)tail % INPUT_QUEUE_SIZE] = input;
+    SDL_MemoryBarrierRelease();
+    SDL_SetAtomicInt(&q->tail, tail + 1);
+    return true;
+}
+
+/*
+ * Function to Take the Oldest Queued Input Command
+ *
+ * Called only by the consumer. Returns false if the queue is empty.
+ */
+static bool input_pop_(InputQueue *q, Uint8 *input)
+{
+    const int head = SDL_GetAtomicInt(&q->head);
+    if (head == SDL_GetAtomicInt(&q->tail))
+    {
+        return false;
+    }
+    SDL_MemoryBarrierAcquire();
+    *input = q->items[(unsigned)head % INPUT_QUEUE_SIZE];
+    SDL_SetAtomicInt(&q->head, head + 1);
+    return true;
+}
+
+/*
+ * Function to Publish the Writer's Back Snapshot
+ */
+static void frames_publish_(TripleBuffer *tb)
+{
+    tb->back = SDL_SetAtomicInt(&tb->latest, tb->back | SNAPSHOT_FRESH) & ~SNAPSHOT_FRESH;
+}
+
+/*
+ * Function to Get the Newest Published Snapshot
+ *
+ * The returned snapshot stays valid until the next call.
+ */
+static const Snapshot *frames_read_(TripleBuffer *tb)
+{
+    if (SDL_GetAtomicInt(&tb->latest) & SNAPSHOT_FRESH)
+    {
+        tb->front = SDL_SetAtomicInt(&tb->latest, tb->front) & ~SNAPSHOT_FRESH;
+    }
+    return &tb->slots[tb->front];
+}
+
+/*
+ * Function to Reset the Simulation Thread State
+ *
+ * All three snapshot slots start out holding the initial game state, so
+ * the reader has a valid snapshot before the first step.
+ */
+static void sim_initialize_(SimState *sim)
+{
+    int i;
+    game_initialize(&sim->ctx);
+    for (i = 0; i < 3; i++)
+    {
+        sim->frames.slots[i].ctx = sim->ctx;
+        sim->frames.slots[i].time = SDL_GetTicksNS();
+    }
+    SDL_SetAtomicInt(&sim->frames.latest, 0);
+    sim->frames.back = 1;
+    sim->frames.front = 2;
+}
+
+/*
+ * Simulation Thread Function
+ *
+ * This function applies queued input and steps the game at a fixed rate,
+ * publishing a snapshot after every step. After a hitch it resumes from the
+ * current time instead of running the missed steps back to back.
+ */
+static int SDLCALL sim_thread_(void *data)
+{
+    SimState *sim = (SimState *)data;
+    Uint64 next = SDL_GetTicksNS();
+    Uint8 input;
+
+    while (!SDL_GetAtomicInt(&sim->quit))
+    {
+        Snapshot *snap = &sim->frames.slots[sim->frames.back];
+        Uint64 now;
+
+        while (input_pop_(&sim->inputs, &input))
+        {
+            journal_input_(sim->journal, sim->steps, input);
+            apply_input_(&sim->ctx, input);
+        }
+        game_step(&sim->ctx);
+        snap->ctx = sim->ctx;
+        snap->step = ++sim->steps;
+        journal_step_(sim->journal, sim->steps, &sim->ctx);
+        snap->time = SDL_GetTicksNS();
+        frames_publish_(&sim->frames);
+        if (sim->wake_event)
+        {
+            SDL_Event wake;
+            SDL_zero(wake);
+            wake.type = sim->wake_event;
+            SDL_PushEvent(&wake);
+        }
+
+        next += SDL_MS_TO_NS(STEP_RATE_IN_MILLISECONDS);
+        now = SDL_GetTicksNS();
+        if (now < next)
+        {
+            SDL_DelayNS(next - now);
+        }
+        else
+        {
+            next = now;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function to Handle Keyboard Input Events
+ *
+ * This function processes keyboard input and updates the game state accordingly.
+ * It handles movement input, restarting the game, and quitting the application.
+ * With a simulation thread, input is queued for that thread instead.
+ */
+static int handle_key_event_(AppState *as, SDL_Scancode key_code)
+{
+    Uint8 input;
+    switch (key_code)
+    {
+    /* Quit application */
+    case SDL_SCANCODE_ESCAPE:
+    case SDL_SCANCODE_Q:
+        return SDL_APP_SUCCESS;
+    /* Restart the game */
+    case SDL_SCANCODE_R:
+        input = INPUT_RESTART;
+        break;
+    /* Change player direction */
+    case SDL_SCANCODE_RIGHT:
+        input = DIR_RIGHT;
+        break;
+    case SDL_SCANCODE_UP:
+        input = DIR_UP;
+        break;
+    case SDL_SCANCODE_LEFT:
+        input = DIR_LEFT;
+        break;
+    case SDL_SCANCODE_DOWN:
+        input = DIR_DOWN;
+        break;
+    default:
+        return SDL_APP_CONTINUE;
+    }
+    if (as->sim_thread)
+    {
+        input_push_(&as->sim.inputs, input);
+    }
+    else
+    {
+        journal_input_(&as->journal, as->steps, input);
+        apply_input_(&as->game_ctx, input);
+    }
+    return SDL_APP_CONTINUE;
+}
+
+/*
+ * Function to Advance the Headless Input Script Generator
+ *
+ * A 32-bit xorshift generator; cheap, and identical on every platform.
+ */
+static Uint32 xorshift32_(Uint32 *state)
+{
+    Uint32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/*
+ * Function to Set Up an Arena
+ */
+static bool arena_init_(Arena *arena, size_t size)
+{
+    arena->base = SDL_malloc(size);
+    arena->size = arena->base ? size : 0;
+    arena->used = 0;
+    return arena->base != NULL;
+}
+
+/*
+ * Function to Allocate From an Arena
+ *
+ * Returns size bytes aligned to align (a power of two), or NULL if the
+ * arena is full.
+ */
+static void *arena_alloc_(Arena *arena, size_t size, size_t align)
+{
+    const size_t start = ((size_t)(arena->base + arena->used) + align - 1) & ~(align - 1);
+    const size_t offset = start - (size_t)arena->base;
+    if (!arena->base || offset > arena->size || size > arena->size - offset)
+    {
+        return NULL;
+    }
+    arena->used = offset + size;
+    return arena->base + offset;
+}
+
+/*
+ * Function to Free an Arena and Everything Allocated From It
+ */
+static void arena_free_(Arena *arena)
+{
+    SDL_free(arena->base);
+    SDL_zerop(arena);
+}
+
+/*
+ * Function to Set Up an Empty Entity Pool
+ *
+ * Every array of the pool is allocated from one arena sized to fit them.
+ * Returns false if memory runs out.
+ */
+static bool entities_init_(EntityPool *pool, Arena *arena, Uint32 capacity)
+{
+    const size_t n = capacity ? capacity : 1;
+    const size_t per_entity = 4 * sizeof(Sint32) + 4 * sizeof(Uint8) + sizeof(Uint32) + sizeof(SDL_FRect);
+
+    SDL_zerop(pool);
+    if (!arena_init_(arena, n * per_entity + 10 * ENTITY_ALIGN))
+    {
+        return false;
+    }
+    pool->x = arena_alloc_(arena, n * sizeof(Sint32), ENTITY_ALIGN);
+    pool->y = arena_alloc_(arena, n * sizeof(Sint32), ENTITY_ALIGN);
+    pool->next_x = arena_alloc_(arena, n * sizeof(Sint32), ENTITY_ALIGN);
+    pool->next_y = arena_alloc_(arena, n * sizeof(Sint32), ENTITY_ALIGN);
+    pool->blocked = arena_alloc_(arena, n, ENTITY_ALIGN);
+    pool->dir = arena_alloc_(arena, n, ENTITY_ALIGN);
+    pool->type = arena_alloc_(arena, n, ENTITY_ALIGN);
+    pool->alive = arena_alloc_(arena, n, ENTITY_ALIGN);
+    pool->free_list = arena_alloc_(arena, n * sizeof(Uint32), ENTITY_ALIGN);
+    pool->rects = arena_alloc_(arena, n * sizeof(SDL_FRect), ENTITY_ALIGN);
+    pool->capacity = capacity;
+    return pool->rects != NULL;
+}
+
+/*
+ * Function to Spawn an Entity
+ *
+ * Reuses the most recently freed slot if there is one. Returns the new
+ * entity's slot, or -1 if the pool is full.
+ */
+Sint64 entity_spawn(EntityPool *pool, int x, int y, Direction dir, CellType type)
+{
+    Uint32 i;
+    if (pool->free_count > 0)
+    {
+        i = pool->free_list[--pool->free_count];
+    }
+    else if (pool->end < pool->capacity)
+    {
+        i = pool->end++;
+    }
+    else
+    {
+        return -1;
+    }
+    pool->x[i] = x;
+    pool->y[i] = y;
+    pool->dir[i] = (Uint8)dir;
+    pool->type[i] = (Uint8)type;
+    pool->alive[i] = 1;
+    return i;
+}
+
+/*
+ * Function to Despawn an Entity
+ *
+ * The slot stays in place, dead, until a later spawn reuses it.
+ */
+void entity_despawn(EntityPool *pool, Uint32 i)
+{
+    if (i < pool->end && pool->alive[i])
+    {
+        pool->alive[i] = 0;
+        pool->free_list[pool->free_count++] = i;
+    }
+}
+
+/*
+ * Function to Compute the Cell Each Entity Moves To
+ *
+ * The arrays must not overlap; restrict lets the compiler vectorize the
+ * loop without checking that at run time.
+ */
+static void entities_advance_(const Sint32 *restrict x, const Sint32 *restrict y, const Uint8 *restrict dir,
+                              Sint32 *restrict next_x, Sint32 *restrict next_y, Uint32 n)
+{
+    Uint32 i;
+    for (i = 0; i < n; i++)
+    {
+        int nx = x[i] + dir_dx_(dir[i]);
+        int ny = y[i] + dir_dy_(dir[i]);
+        wrap_around_(&nx, GAME_GRID_WIDTH);
+        wrap_around_(&ny, GAME_GRID_HEIGHT);
+        next_x[i] = nx;
+        next_y[i] = ny;
+    }
+}
+
+/*
+ * Function to Move the Entities That Are Not Blocked
+ *
+ * Blocked entities stay put and turn back; dead ones do not change at all.
+ */
+static void entities_apply_(Sint32 *restrict x, Sint32 *restrict y, Uint8 *restrict dir,
+                            const Sint32 *restrict next_x, const Sint32 *restrict next_y,
+                            const Uint8 *restrict blocked, const Uint8 *restrict alive, Uint32 n)
+{
+    Uint32 i;
+    for (i = 0; i < n; i++)
+    {
+        const Sint32 stay = -(Sint32)(blocked[i] | (alive[i] ^ 1U)); /* All ones if the entity does not move */
+        x[i] = (x[i] & stay) | (next_x[i] & ~stay);
+        y[i] = (y[i] & stay) | (next_y[i] & ~stay);
+        dir[i] ^= (Uint8)((blocked[i] & alive[i]) << 1); /* DIR_RIGHT <-> DIR_LEFT, DIR_UP <-> DIR_DOWN */
+    }
+}
+
+/*
+ * Function to Step Every Entity
+ *
+ * Each entity moves one cell in its direction, wrapping around the grid;
+ * an entity whose next cell is occupied stays put and turns back instead.
+ * The work is split into three loops over all used slots, none with a
+ * branch per entity: computing the next cells, which vectorizes; looking
+ * them up in the grid; and applying the moves, which vectorizes again.
+ * Dead slots go through the same loops but never move.
+ */
+void entities_step(EntityPool *pool, const GameContext *ctx)
+{
+    Uint32 i;
+    entities_advance_(pool->x, pool->y, pool->dir, pool->next_x, pool->next_y, pool->end);
+    for (i = 0; i < pool->end; i++)
+    {
+        pool->blocked[i] = cell_at(ctx, pool->next_x[i], pool->next_y[i]) != CELL_EMPTY;
+    }
+    entities_apply_(pool->x, pool->y, pool->dir, pool->next_x, pool->next_y, pool->blocked, pool->alive, pool->end);
+}
+
+/*
+ * Function to Set Up a Pool Filled With Entities
+ *
+ * The entities get positions, directions and types drawn from the seed,
+ * so the same seed always gives the same entities.
+ */
+static bool entities_create_(EntityPool *pool, Arena *arena, Uint32 count, Uint32 seed)
+{
+    Uint32 state = seed ? seed : HEADLESS_DEFAULT_SEED;
+    Uint32 i;
+    if (!entities_init_(pool, arena, count))
+    {
+        arena_free_(arena);
+        return false;
+    }
+    for (i = 0; i < count; i++)
+    {
+        const Uint32 r = xorshift32_(&state);
+        const Uint32 s = xorshift32_(&state);
+        entity_spawn(pool, (int)(r % GAME_GRID_WIDTH), (int)(s % GAME_GRID_HEIGHT), (Direction)(r >> 30), (CellType)(CELL_TYPE3 + (s >> 30) % 3U));
+    }
+    return true;
+}
+
+/*
+ * Function to Hash the Entities
+ *
+ * Covers the slot, position and direction of every live entity.
+ */
+static Uint64 entities_hash_(const EntityPool *pool)
+{
+    Uint64 h = 0;
+    Uint32 i;
+    for (i = 0; i < pool->end; i++)
+    {
+        if (pool->alive[i])
+        {
+            h += cell_hash_((Uint64)i * GAME_MATRIX_SIZE + (Uint64)pool->x[i] + (Uint64)pool->y[i] * GAME_GRID_WIDTH, (CellType)pool->dir[i]);
+        }
+    }
+    return h;
+}
+
+/*
+ * Function to Checksum the Game State
+ *
+ * This function folds the grid hash and the player state into a 64-bit
+ * FNV-1a hash so that two headless runs can be checked for identical
+ * results. Only the logical state is hashed, so every grid layout gives
+ * the same checksum.
+ */
+static Uint64 game_checksum_(const GameContext *ctx)
+{
+    const Uint64 state[4] = {grid_hash_(ctx), (Uint64)ctx->player_xpos, (Uint64)ctx->player_ypos, (Uint64)ctx->next_dir};
+    const unsigned char *p = (const unsigned char *)state;
+    Uint64 h = 0xcbf29ce484222325ULL;
+    size_t i;
+    for (i = 0; i < sizeof(state); i++)
+    {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/*
+ * Function to Benchmark the Grid Layout
+ *
+ * This function fills the view-sized area at the top left of a grid from
+ * the seed and times the per-cell and bulk grid operations on it, so builds
+ * with different GRID_LAYOUT values can be compared (see "make bench-grid").
+ */
+static SDL_AppResult run_grid_bench_(Uint64 rounds, Uint32 seed)
+{
+    static const char *const layouts[] = {"packed", "bitplane", "chunked"};
+    static const char *const layout = layouts[GRID_LAYOUT];
+    static Uint32 visible[VIEW_MATRIX_SIZE];
+    static GameContext ctx;
+    const Camera origin = {0, 0};
+    Uint32 state = seed ? seed : HEADLESS_DEFAULT_SEED;
+    Uint64 sink = 0;
+    Uint64 start;
+    Uint64 i;
+    unsigned c;
+    double freq = (double)SDL_GetPerformanceFrequency();
+
+    rounds = rounds ? rounds : 1;
+    for (c = 0; c < VIEW_MATRIX_SIZE; c++)
+    {
+        const Uint32 r = xorshift32_(&state);
+        put_cell_at_(&ctx, c % VIEW_GRID_WIDTH, c / VIEW_GRID_WIDTH, r % 4U == 0 ? (CellType)(1U + (r >> 8) % CELL_TYPE5) : CELL_EMPTY);
+    }
+
+    start = SDL_GetPerformanceCounter();
+    for (i = 0; i < rounds; i++)
+    {
+        for (c = 0; c < VIEW_MATRIX_SIZE; c++)
+        {
+            sink += cell_at(&ctx, c % VIEW_GRID_WIDTH, c / VIEW_GRID_WIDTH);
+        }
+    }
+    SDL_Log("Grid %s: cell_at sweep      %8.1f ns/view", layout, (double)(SDL_GetPerformanceCounter() - start) * 1e9 / freq / (double)rounds);
+
+    start = SDL_GetPerformanceCounter();
+    for (i = 0; i < rounds; i++)
+    {
+        sink += grid_visible(&ctx, &origin, visible);
+    }
+    SDL_Log("Grid %s: grid_visible       %8.1f ns/view", layout, (double)(SDL_GetPerformanceCounter() - start) * 1e9 / freq / (double)rounds);
+
+    start = SDL_GetPerformanceCounter();
+    for (i = 0; i < rounds; i++)
+    {
+        sink += grid_count(&ctx, (CellType)(1U + i % CELL_TYPE5));
+    }
+    SDL_Log("Grid %s: grid_count         %8.1f ns/grid", layout, (double)(SDL_GetPerformanceCounter() - start) * 1e9 / freq / (double)rounds);
+
+    start = SDL_GetPerformanceCounter();
+    for (i = 0; i < rounds; i++)
+    {
+        const Uint32 r = xorshift32_(&state);
+        put_cell_at_(&ctx, r % VIEW_GRID_WIDTH, (r >> 8) % VIEW_GRID_HEIGHT, (CellType)((r >> 16) % (CELL_TYPE5 + 1U)));
+    }
+    SDL_Log("Grid %s: put_cell_at_       %8.1f ns/cell", layout, (double)(SDL_GetPerformanceCounter() - start) * 1e9 / freq / (double)rounds);
+
+    start = SDL_GetPerformanceCounter();
+    for (i = 0; i < rounds; i++)
+    {
+        const Uint32 r = xorshift32_(&state);
+        grid_clear_region(&ctx, r % VIEW_GRID_WIDTH, (r >> 8) % VIEW_GRID_HEIGHT, 8U, 4U);
+    }
+    SDL_Log("Grid %s: grid_clear_region  %8.1f ns/8x4", layout, (double)(SDL_GetPerformanceCounter() - start) * 1e9 / freq / (double)rounds);
+
+    SDL_Log("Grid %s: %llu rounds, result %016llx", layout, (unsigned long long)rounds, (unsigned long long)(sink ^ game_checksum_(&ctx)));
+    grid_clear_(&ctx);
+    return SDL_APP_SUCCESS;
+}
+
+/*
+ * Function to Microbenchmark cell_at and game_step
+ *
+ * This function times single calls with bench.h: cell_at on cells picked
+ * from the seed in a view-sized area filled the same way as --grid-bench,
+ * and game_step fed an input script like a headless run's. Each reports the
+ * median, MAD and percentiles per call, with hardware counters where the
+ * system allows them.
+ */
+static SDL_AppResult run_micro_bench_(Uint32 seed)
+{
+    static GameContext ctx;
+    static Bench b;
+    static int xs[MICRO_BENCH_INPUTS];
+    static int ys[MICRO_BENCH_INPUTS];
+    static Uint8 script[MICRO_BENCH_INPUTS];
+    Uint32 state = seed ? seed : HEADLESS_DEFAULT_SEED;
+    unsigned i;
+
+    for (i = 0; i < VIEW_MATRIX_SIZE; i++)
+    {
+        const Uint32 r = xorshift32_(&state);
+        put_cell_at_(&ctx, (int)(i % VIEW_GRID_WIDTH), (int)(i / VIEW_GRID_WIDTH), r % 4U == 0 ? (CellType)(1U + (r >> 8) % CELL_TYPE5) : CELL_EMPTY);
+    }
+    for (i = 0; i < MICRO_BENCH_INPUTS; i++)
+    {
+        const Uint32 r = xorshift32_(&state);
+        xs[i] = (int)(r % VIEW_GRID_WIDTH);
+        ys[i] = (int)((r >> 16) % VIEW_GRID_HEIGHT);
+        script[i] = (r >> 8) % HEADLESS_REDIR_CHANCE == 0 ? (Uint8)((r >> 12) & 3U) : INPUT_NONE;
+    }
+
+    i = 0;
+    bench_init(&b, "cell_at");
+    BENCH_LOOP(&b)
+    {
+        i = (i + 1) & (MICRO_BENCH_INPUTS - 1);
+        bench_do_not_optimize(cell_at(&ctx, xs[i], ys[i]));
+    }
+    bench_print(&b);
+
+    grid_clear_(&ctx);
+    game_initialize(&ctx);
+    bench_init(&b, "game_step");
+    BENCH_LOOP(&b)
+    {
+        i = (i + 1) & (MICRO_BENCH_INPUTS - 1);
+        apply_input_(&ctx, script[i]);
+        game_step(&ctx);
+    }
+    bench_print(&b);
+
+    grid_clear_(&ctx);
+    return SDL_APP_SUCCESS;
+}
+
+#if GRID_UPDATE
+
+/*
+ * Function to Benchmark the Whole-Grid Update
+ *
+ * This function times grid_update alone on a freshly initialized grid. The
+ * result value depends only on the grid size and ROUNDS, never on --jobs.
+ */
+static SDL_AppResult run_update_bench_(Uint64 rounds)
+{
+    static GameContext ctx;
+    Uint64 start;
+    Uint64 i;
+    double ns;
+
+    rounds = rounds ? rounds : 1;
+    game_initialize(&ctx);
+    start = SDL_GetPerformanceCounter();
+    for (i = 0; i < rounds; i++)
+    {
+        grid_update(&ctx);
+    }
+    ns = (double)(SDL_GetPerformanceCounter() - start) * 1e9 / (double)SDL_GetPerformanceFrequency();
+
+    SDL_Log("Update: %ux%u grid, %u tiles, %u threads", GAME_GRID_WIDTH, GAME_GRID_HEIGHT, UPDATE_TILES, update_pool_.jobs);
+    SDL_Log("Update: %.3f ms/update, %.1f Mcells/s", ns / 1e6 / (double)rounds, ns > 0.0 ? (double)GAME_MATRIX_SIZE * (double)rounds * 1e3 / ns : 0.0);
+    SDL_Log("Update: %llu rounds, result %016llx", (unsigned long long)rounds, (unsigned long long)game_checksum_(&ctx));
+    return SDL_APP_SUCCESS;
+}
+
+#endif /* GRID_UPDATE */
+
+/*
+ * Function to Benchmark the Entity Step
+ *
+ * This function fills the view-sized area at the top left of the grid from
+ * the seed, spawns count entities and times entities_step on them. Each
+ * round also despawns and respawns ENTITY_BENCH_CHURN entities.
+ */
+static SDL_AppResult run_entity_bench_(Uint64 rounds, Uint32 count, Uint32 seed)
+{
+    static GameContext ctx;
+    Arena arena;
+    EntityPool pool;
+    Uint32 state = seed ? seed : HEADLESS_DEFAULT_SEED;
+    Uint64 start;
+    Uint64 i;
+    unsigned c;
+    double ns;
+
+    rounds = rounds ? rounds : 1;
+    count = count ? count : ENTITY_BENCH_COUNT;
+    game_initialize(&ctx);
+    for (c = 0; c < VIEW_MATRIX_SIZE; c++)
+    {
+        if (xorshift32_(&state) % 8U == 0)
+        {
+            put_cell_at_(&ctx, c % VIEW_GRID_WIDTH, c / VIEW_GRID_WIDTH, CELL_TYPE2);
+        }
+    }
+    if (!entities_create_(&pool, &arena, count, seed))
+    {
+        SDL_Log("Entities: cannot allocate %u entities", (unsigned)count);
+        grid_clear_(&ctx);
+        return SDL_APP_FAILURE;
+    }
+
+    start = SDL_GetPerformanceCounter();
+    for (i = 0; i < rounds; i++)
+    {
+        for (c = 0; c < ENTITY_BENCH_CHURN; c++)
+        {
+            const Uint32 r = xorshift32_(&state);
+            entity_despawn(&pool, r % pool.end);
+            entity_spawn(&pool, (int)(r % GAME_GRID_WIDTH), (int)((r >> 8) % GAME_GRID_HEIGHT), (Direction)(r >> 30), CELL_TYPE3);
+        }
+        entities_step(&pool, &ctx);
+    }
+    ns = (double)(SDL_GetPerformanceCounter() - start) * 1e9 / (double)SDL_GetPerformanceFrequency();
+
+    SDL_Log("Entities: %u entities, %.1f us/step, %.2f ns/entity", (unsigned)count, ns / 1e3 / (double)rounds, ns / (double)rounds / (double)count);
+    SDL_Log("Entities: %llu rounds, result %016llx", (unsigned long long)rounds, (unsigned long long)entities_hash_(&pool));
+    arena_free_(&arena);
+    grid_clear_(&ctx);
+    return SDL_APP_SUCCESS;
+}
+
+/*
+ * Function to Run the Simulation Without a Window
+ *
+ * This function builds the whole input script up front, then times only the
+ * loop that feeds it to game_step, and reports steps/sec and ns/step. The
+ * entities, if any, are stepped along with the game. With record_path set,
+ * the run is also recorded as a journal.
+ */
+static SDL_AppResult run_headless_(GameContext *ctx, EntityPool *entities, Uint64 steps, Uint32 seed, const char *record_path)
+{
+    Journal journal = {0};
+    Uint8 *script = SDL_malloc(steps ? steps : 1);
+    Uint32 state = seed ? seed : HEADLESS_DEFAULT_SEED; /* xorshift must not start at zero */
+    Uint64 start;
+    Uint64 elapsed;
+    Uint64 i;
+    double ns;
+
+    if (!script)
+    {
+        SDL_Log("Headless: cannot allocate an input script of %llu steps", (unsigned long long)steps);
+        return SDL_APP_FAILURE;
+    }
+    for (i = 0; i < steps; i++)
+    {
+        const Uint32 r = xorshift32_(&state);
+        if (r % HEADLESS_RESTART_CHANCE == 0)
+        {
+            script[i] = INPUT_RESTART;
+        }
+        else if ((r >> 12) % HEADLESS_REDIR_CHANCE == 0)
+        {
+            script[i] = (Uint8)((r >> 16) & 3U);
+        }
+        else
+        {
+            script[i] = INPUT_NONE;
+        }
+    }
+
+    SDL_zerop(ctx); /* A chunked grid must start with no chunks */
+    game_initialize(ctx);
+    if (record_path && !journal_open_(&journal, record_path, ctx))
+    {
+        SDL_free(script);
+        return SDL_APP_FAILURE;
+    }
+    start = SDL_GetPerformanceCounter();
+    for (i = 0; i < steps; i++)
+    {
+        if (script[i] != INPUT_NONE)
+        {
+            journal_input_(&journal, i, script[i]);
+        }
+        apply_input_(ctx, script[i]);
+        game_step(ctx);
+        journal_step_(&journal, i + 1, ctx);
+        entities_step(entities, ctx);
+    }
+    elapsed = SDL_GetPerformanceCounter() - start;
+    SDL_free(script);
+    journal_close_(&journal, steps, ctx);
+
+    ns = (double)elapsed * 1e9 / (double)SDL_GetPerformanceFrequency();
+    SDL_Log("Headless: %llu steps in %.3f ms (seed 0x%08x)", (unsigned long long)steps, ns / 1e6, (unsigned)seed);
+    SDL_Log("Headless: %.0f steps/sec, %.2f ns/step", ns > 0.0 ? (double)steps * 1e9 / ns : 0.0, steps ? ns / (double)steps : 0.0);
+    SDL_Log("Headless: state checksum %016llx", (unsigned long long)game_checksum_(ctx));
+    if (entities->end > 0)
+    {
+        SDL_Log("Headless: %u entities, checksum %016llx", (unsigned)entities->end, (unsigned long long)entities_hash_(entities));
+    }
+    grid_clear_(ctx);
+    return SDL_APP_SUCCESS;
+}
+
+/*
+ * Function to Read a Record Tag From a Journal
+ *
+ * Returns false if the varint runs past end.
+ */
+static bool journal_read_tag_(const Uint8 *data, size_t end, size_t *pos, Uint64 *tag)
+{
+    unsigned shift;
+    *tag = 0;
+    for (shift = 0; *pos < end && shift < 64; shift += 7)
+    {
+        const Uint8 b = data[(*pos)++];
+        *tag |= (Uint64)(b & 0x7FU) << shift;
+        if (!(b & 0x80U))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Function to Replay a Journal Without a Window
+ *
+ * This function finds the last checkpoint at or before seek through the
+ * journal's index, restores it and replays the recorded input from there,
+ * so reaching any step costs at most one checkpoint interval of game steps.
+ * Every checkpoint passed on the way is compared with the replayed state.
+ * A seek of ~0 replays the whole session from step 0.
+ */
+static SDL_AppResult run_replay_(const char *path, Uint64 seek)
+{
+    static GameContext ctx;
+    static GameContext saved;
+    JournalHeader h;
+    JournalFooter f;
+    size_t size = 0;
+    Uint8 *data = SDL_LoadFile(path, &size);
+    const char *error = NULL;
+    Uint64 lo = 0;
+    Uint64 hi;
+    Uint64 from = 0;
+    Uint64 offset = 0;
+    Uint64 step;
+    Uint64 checked = 0;
+    Uint64 tag;
+    Uint64 start;
+    size_t pos;
+    double ns;
+
+    if (!data)
+    {
+        SDL_Log("Replay: cannot read '%s': %s", path, SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+    if (size < sizeof(h) + sizeof(f))
+    {
+        error = "not a journal";
+    }
+    else
+    {
+        SDL_memcpy(&h, data, sizeof(h));
+        SDL_memcpy(&f, data + size - sizeof(f), sizeof(f));
+        if (SDL_memcmp(h.magic, JOURNAL_MAGIC, sizeof(h.magic)) != 0 || h.version != JOURNAL_VERSION)
+        {
+            error = "not a journal";
+        }
+        else if (h.layout != GRID_LAYOUT || h.width != GAME_GRID_WIDTH || h.height != GAME_GRID_HEIGHT || h.context_size != sizeof(GameContext))
+        {
+            error = "recorded by a build with a different grid";
+        }
+        else if (SDL_memcmp(f.magic, JOURNAL_INDEX_MAGIC, sizeof(f.magic)) != 0 || f.checkpoints == 0 ||
+                 f.index_offset > size - sizeof(f) || (size - sizeof(f) - f.index_offset) / (2 * sizeof(Uint64)) != f.checkpoints)
+        {
+            error = "incomplete journal";
+        }
+    }
+    if (error)
+    {
+        SDL_Log("Replay: '%s': %s", path, error);
+        SDL_free(data);
+        return SDL_APP_FAILURE;
+    }
+
+    /* Binary search the index for the last checkpoint at or before seek; a full replay starts at step 0 */
+    hi = seek == ~0ULL ? 1 : f.checkpoints;
+    while (hi - lo > 1)
+    {
+        const Uint64 mid = lo + (hi - lo) / 2;
+        Uint64 mid_step;
+        SDL_memcpy(&mid_step, data + f.index_offset + mid * 2 * sizeof(Uint64), sizeof(mid_step));
+        if (mid_step <= seek)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    SDL_memcpy(&from, data + f.index_offset + lo * 2 * sizeof(Uint64), sizeof(from));
+    SDL_memcpy(&offset, data + f.index_offset + (lo * 2 + 1) * sizeof(Uint64), sizeof(offset));
+    pos = (size_t)SDL_min(offset, f.index_offset);
+    if (!journal_read_tag_(data, f.index_offset, &pos, &tag) || (tag & 3U) != JOURNAL_CHECKPOINT || pos + sizeof(ctx) > f.index_offset)
+    {
+        SDL_Log("Replay: '%s': corrupt checkpoint index", path);
+        SDL_free(data);
+        return SDL_APP_FAILURE;
+    }
+    SDL_memcpy(&ctx, data + pos, sizeof(ctx));
+    pos += sizeof(ctx);
+    step = from;
+
+    start = SDL_GetPerformanceCounter();
+    for (;;)
+    {
+        Uint64 next;
+        unsigned kind;
+        if (!journal_read_tag_(data, f.index_offset, &pos, &tag))
+        {
+            error = "journal ends without an end record";
+            break;
+        }
+        next = step + (tag >> 2);
+        kind = (unsigned)(tag & 3U);
+        if (next > seek || (next == seek && kind == JOURNAL_INPUT))
+        {
+            next = seek; /* Input at the seek step comes after it */
+            kind = JOURNAL_END;
+        }
+        while (step < next)
+        {
+            game_step(&ctx);
+            step++;
+        }
+        if (kind == JOURNAL_END)
+        {
+            break;
+        }
+        if (kind == JOURNAL_INPUT && pos < f.index_offset)
+        {
+            apply_input_(&ctx, data[pos++]);
+        }
+        else if (kind == JOURNAL_CHECKPOINT && pos + sizeof(saved) <= f.index_offset)
+        {
+            SDL_memcpy(&saved, data + pos, sizeof(saved));
+            pos += sizeof(saved);
+            if (game_checksum_(&saved) != game_checksum_(&ctx))
+            {
+                error = "replay diverged from the recording";
+                break;
+            }
+            checked++;
+        }
+        else
+        {
+            error = "corrupt record";
+            break;
+        }
+    }
+    ns = (double)(SDL_GetPerformanceCounter() - start) * 1e9 / (double)SDL_GetPerformanceFrequency();
+    SDL_free(data);
+
+    SDL_Log("Replay: from checkpoint at step %llu to step %llu in %.3f ms, %.0f steps/sec", (unsigned long long)from,
+            (unsigned long long)step, ns / 1e6, ns > 0.0 ? (double)(step - from) * 1e9 / ns : 0.0);
+    SDL_Log("Replay: %llu checkpoints matched, state checksum %016llx", (unsigned long long)checked, (unsigned long long)game_checksum_(&ctx));
+    grid_clear_(&ctx);
+    if (error)
+    {
+        SDL_Log("Replay: '%s': %s at step %llu", path, error, (unsigned long long)step);
+        return SDL_APP_FAILURE;
+    }
+    return SDL_APP_SUCCESS;
+}
+
+/*
+ * Function to Draw a List of Cells in One Batch per CellType
+ *
+ * This function groups the given cells (as view indices) by type and fills
+ * each group with a single SDL_RenderFillRects call, so the number of draw
+ * calls depends on the number of cell types rather than the number of cells.
+ */
+static void draw_cells_(AppState *as, const Uint32 *cells, unsigned n)
+{
+    unsigned count[CELL_TYPES] = {0};
+    unsigned i;
+
+    for (i = 0; i < n; i++)
+    {
+        const int x = cells[i] % VIEW_GRID_WIDTH;
+        const int y = cells[i] / VIEW_GRID_WIDTH;
+        const CellType ct = cell_at(&as->game_ctx, as->camera.x + x, as->camera.y + y);
+        SDL_FRect *r = &as->batch[ct][count[ct]++];
+        r->w = r->h = BLOCK_SIZE_IN_PIXELS;
+        set_rect_xy_(r, x, y);
+    }
+    for (i = 0; i < CELL_TYPES; i++)
+    {
+        if (count[i] > 0)
+        {
+            const SDL_Color c = cell_colors_[i];
+            SDL_SetRenderDrawColor(as->renderer, c.r, c.g, c.b, c.a);
+            SDL_RenderFillRects(as->renderer, as->batch[i], (int)count[i]);
+        }
+    }
+}
+
+/*
+ * Function to Create the Persistent Render Target
+ *
+ * Without a render target every frame is redrawn in full.
+ */
+static void create_target_(AppState *as)
+{
+    as->target = SDL_CreateTexture(as->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, SDL_WINDOW_WIDTH, SDL_WINDOW_HEIGHT);
+    if (as->target)
+    {
+        SDL_SetTextureScaleMode(as->target, SDL_SCALEMODE_NEAREST);
+    }
+    as->target_valid = false;
+}
+
+/*
+ * Function to Render the Whole Grid
+ */
+static void render_full_(AppState *as, Uint32 *cells)
+{
+    const SDL_Color bg = cell_colors_[CELL_EMPTY];
+    SDL_SetRenderDrawColor(as->renderer, bg.r, bg.g, bg.b, bg.a); /* Clear color */
+    SDL_RenderClear(as->renderer);
+    draw_cells_(as, cells, grid_visible(&as->game_ctx, &as->camera, cells));
+}
+
+#if DIRTY_RENDERING
+
+/*
+ * Function to Render Only the Cells That Changed
+ *
+ * The grid is kept on a render target between frames. Each frame only the
+ * cells that differ from the last drawn state are filled on the target,
+ * which is then copied to the screen in one call. Frames where nothing
+ * moved redraw nothing but that copy.
+ */
+static void render_dirty_(AppState *as, Uint32 *cells)
+{
+    SDL_SetRenderTarget(as->renderer, as->target);
+    if (!as->target_valid)
+    {
+        render_full_(as, cells);
+        as->target_valid = true;
+    }
+    else
+    {
+        draw_cells_(as, cells, grid_diff(&as->game_ctx, &as->drawn, cells));
+    }
+    SDL_SetRenderTarget(as->renderer, NULL);
+    as->drawn = as->game_ctx;
+    SDL_RenderTexture(as->renderer, as->target, NULL, NULL);
+}
+
+#endif /* DIRTY_RENDERING */
+
+/*
+ * Function to Move the Camera to the Player
+ *
+ * The camera centers on the player but stays within the grid.
+ */
+static void camera_follow_(AppState *as)
+{
+    const int x = as->game_ctx.player_xpos - (int)VIEW_GRID_WIDTH / 2;
+    const int y = as->game_ctx.player_ypos - (int)VIEW_GRID_HEIGHT / 2;
+    as->camera.x = SDL_clamp(x, 0, (int)(GAME_GRID_WIDTH - VIEW_GRID_WIDTH));
+    as->camera.y = SDL_clamp(y, 0, (int)(GAME_GRID_HEIGHT - VIEW_GRID_HEIGHT));
+}
+
+/*
+ * Function to Take the Newest Snapshot From the Simulation Thread
+ *
+ * The snapshot's state is copied into game_ctx, so the rest of rendering
+ * works the same with or without a simulation thread.
+ */
+static const Snapshot *take_snapshot_(AppState *as)
+{
+    const Snapshot *snap = frames_read_(&as->sim.frames);
+    if (snap->step != as->shown_step)
+    {
+        /* Interpolate only between consecutive steps */
+        const GameContext *from = snap->step == as->shown_step + 1 ? &as->game_ctx : &snap->ctx;
+        as->prev_xpos = from->player_xpos;
+        as->prev_ypos = from->player_ypos;
+        as->game_ctx = snap->ctx;
+        as->shown_step = snap->step;
+    }
+    return snap;
+}
+
+/*
+ * Function to Draw the Entities in View
+ *
+ * Entities are drawn as smaller squares on top of the grid, with one
+ * SDL_RenderFillRects call per CellType.
+ */
+static void draw_entities_(AppState *as)
+{
+    const EntityPool *pool = &as->entities;
+    const float inset = BLOCK_SIZE_IN_PIXELS / 4.0f;
+    unsigned count[CELL_TYPES] = {0};
+    unsigned first[CELL_TYPES];
+    unsigned next[CELL_TYPES];
+    unsigned total = 0;
+    Uint32 i;
+    unsigned t;
+
+    for (i = 0; i < pool->end; i++)
+    {
+        const unsigned vx = (unsigned)(pool->x[i] - as->camera.x);
+        const unsigned vy = (unsigned)(pool->y[i] - as->camera.y);
+        count[pool->type[i]] += pool->alive[i] && vx < VIEW_GRID_WIDTH && vy < VIEW_GRID_HEIGHT;
+    }
+    for (t = 0; t < CELL_TYPES; t++)
+    {
+        first[t] = next[t] = total;
+        total += count[t];
+    }
+    for (i = 0; i < pool->end; i++)
+    {
+        const unsigned vx = (unsigned)(pool->x[i] - as->camera.x);
+        const unsigned vy = (unsigned)(pool->y[i] - as->camera.y);
+        if (pool->alive[i] && vx < VIEW_GRID_WIDTH && vy < VIEW_GRID_HEIGHT)
+        {
+            SDL_FRect *r = &pool->rects[next[pool->type[i]]++];
+            set_rect_xy_(r, (short)vx, (short)vy);
+            r->x += inset;
+            r->y += inset;
+            r->w = r->h = BLOCK_SIZE_IN_PIXELS - 2.0f * inset;
+        }
+    }
+    for (t = 0; t < CELL_TYPES; t++)
+    {
+        if (count[t] > 0)
+        {
+            const SDL_Color c = cell_colors_[t];
+            SDL_SetRenderDrawColor(as->renderer, c.r, c.g, c.b, c.a);
+            SDL_RenderFillRects(as->renderer, pool->rects + first[t], (int)count[t]);
+        }
+    }
+}
+
+/*
+ * Function to Draw the Player Between Two Steps
+ *
+ * This function redraws the player part of the way from its previous cell
+ * to its current one, according to how much of the step period has passed
+ * since the snapshot was published. Returns whether the player is still
+ * on its way, so later frames will differ.
+ */
+static bool draw_player_between_steps_(AppState *as, const Snapshot *snap)
+{
+    const GameContext *ctx = &as->game_ctx;
+    const int dx = ctx->player_xpos - as->prev_xpos;
+    const int dy = ctx->player_ypos - as->prev_ypos;
+    const SDL_Color bg = cell_colors_[CELL_EMPTY];
+    const SDL_Color fg = cell_colors_[CELL_PLAYER];
+    SDL_FRect r;
+    float t;
+
+    /* Skip when the player did not move, wrapped around or restarted */
+    if (SDL_abs(dx) + SDL_abs(dy) != 1)
+    {
+        return false;
+    }
+    t = (float)(SDL_GetTicksNS() - snap->time) / (float)SDL_MS_TO_NS(STEP_RATE_IN_MILLISECONDS);
+    if (t >= 1.0f)
+    {
+        return false;
+    }
+    r.w = r.h = BLOCK_SIZE_IN_PIXELS;
+    set_rect_xy_(&r, ctx->player_xpos - as->camera.x, ctx->player_ypos - as->camera.y);
+    SDL_SetRenderDrawColor(as->renderer, bg.r, bg.g, bg.b, bg.a);
+    SDL_RenderFillRect(as->renderer, &r);
+    r.x = ((float)(as->prev_xpos - as->camera.x) + (float)dx * t) * BLOCK_SIZE_IN_PIXELS;
+    r.y = ((float)(as->prev_ypos - as->camera.y) + (float)dy * t) * BLOCK_SIZE_IN_PIXELS;
+    SDL_SetRenderDrawColor(as->renderer, fg.r, fg.g, fg.b, fg.a);
+    SDL_RenderFillRect(as->renderer, &r);
+    return true;
+}
+
+/*
+ * Function to Compare Two Durations for SDL_qsort
+ */
+static int compare_u64_(const void *a, const void *b)
+{
+    const Uint64 x = *(const Uint64 *)a;
+    const Uint64 y = *(const Uint64 *)b;
+    return (x > y) - (x < y);
+}
+
+#if FRAME_STATS
+
+/*
+ * Function to Get the Duration of a Phase of a Recorded Frame
+ *
+ * Passing PHASE_COUNT gives the time from the previous frame's start to
+ * this one's, which includes time spent outside SDL_AppIterate.
+ */
+static Uint64 phase_ticks_(const FrameStats *st, Uint64 frame, unsigned phase)
+{
+    const FrameRecord *f = &st->frames[frame % FRAME_STATS_CAPACITY];
+    if (phase == PHASE_COUNT)
+    {
+        return f->start - st->frames[(frame - 1) % FRAME_STATS_CAPACITY].start;
+    }
+    return f->end[phase] - (phase == 0 ? f->start : f->end[phase - 1]);
+}
+
+/*
+ * Function to Update the Overlay's Percentiles
+ */
+static void stats_summarize_(FrameStats *st)
+{
+    static Uint64 ticks[FRAME_STATS_CAPACITY];
+    /* Completed frames whose predecessor is still in the ring; the current frame has taken the oldest slot */
+    const Uint64 first = st->count > FRAME_STATS_CAPACITY - 1 ? st->count - FRAME_STATS_CAPACITY + 2 : 1;
+    const float ms = 1000.0f / (float)SDL_GetPerformanceFrequency();
+    unsigned phase;
+    size_t n;
+    size_t i;
+
+    if (st->count <= first)
+    {
+        return;
+    }
+    n = (size_t)(st->count - first);
+    for (phase = 0; phase <= PHASE_COUNT; phase++)
+    {
+        for (i = 0; i < n; i++)
+        {
+            ticks[i] = phase_ticks_(st, first + i, phase);
+        }
+        SDL_qsort(ticks, n, sizeof(ticks[0]), compare_u64_);
+        st->summary[phase][0] = (float)ticks[n / 2] * ms;
+        st->summary[phase][1] = (float)ticks[(n * 99) / 100] * ms;
+        st->summary[phase][2] = (float)ticks[n - 1] * ms;
+    }
+}
+
+/*
+ * Function to Draw the Frame Statistics Overlay
+ */
+static void stats_draw_overlay_(AppState *as)
+{
+    static const char *const names[PHASE_COUNT + 1] = {"step", "draw", "present", "frame"};
+    FrameStats *st = &as->stats;
+    unsigned phase;
+
+    if (st->count % FRAME_STATS_REFRESH == 0)
+    {
+        stats_summarize_(st);
+    }
+    SDL_SetRenderDrawColor(as->renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
+    for (phase = 0; phase <= PHASE_COUNT; phase++)
+    {
+        const float *v = st->summary[phase];
+        SDL_RenderDebugTextFormat(as->renderer, 8.0f, 8.0f + 12.0f * (float)phase, "%-8s p50 %7.3f  p99 %7.3f  max %7.3f ms", names[phase], v[0], v[1], v[2]);
+    }
+}
+
+/*
+ * Function to Write the Recorded Frames to a File
+ *
+ * Frames are written oldest first, as Chrome trace events (viewable in
+ * chrome://tracing or Perfetto) if the path ends in ".json", else as CSV.
+ */
+static void stats_write_trace_(const FrameStats *st)
+{
+    static const char *const names[PHASE_COUNT] = {"step", "draw", "present"};
+    const size_t len = SDL_strlen(st->trace_path);
+    const bool json = len >= 5 && SDL_strcmp(st->trace_path + len - 5, ".json") == 0;
+    const double us = 1e6 / (double)SDL_GetPerformanceFrequency();
+    const Uint64 first = st->count > FRAME_STATS_CAPACITY ? st->count - FRAME_STATS_CAPACITY : 0;
+    const Uint64 origin = st->frames[first % FRAME_STATS_CAPACITY].start;
+    SDL_IOStream *io = SDL_IOFromFile(st->trace_path, "w");
+    Uint64 i;
+    unsigned phase;
+
+    if (!io)
+    {
+        SDL_Log("Failed to write trace '%s': %s", st->trace_path, SDL_GetError());
+        return;
+    }
+    SDL_IOprintf(io, json ? "{\"traceEvents\":[\n" : "frame,start_us,step_us,draw_us,present_us\n");
+    for (i = first; i < st->count; i++)
+    {
+        const FrameRecord *f = &st->frames[i % FRAME_STATS_CAPACITY];
+        if (!json)
+        {
+            SDL_IOprintf(io, "%llu,%.3f,%.3f,%.3f,%.3f\n", (unsigned long long)i, (double)(f->start - origin) * us,
+                         (double)phase_ticks_(st, i, PHASE_STEP) * us, (double)phase_ticks_(st, i, PHASE_DRAW) * us,
+                         (double)phase_ticks_(st, i, PHASE_PRESENT) * us);
+            continue;
+        }
+        for (phase = 0; phase < PHASE_COUNT; phase++)
+        {
+            const Uint64 begin = phase == 0 ? f->start : f->end[phase - 1];
+            SDL_IOprintf(io, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+                         i == first && phase == 0 ? "" : ",\n", names[phase], (double)(begin - origin) * us,
+                         (double)(f->end[phase] - begin) * us, (unsigned long long)i);
+        }
+    }
+    if (json)
+    {
+        SDL_IOprintf(io, "\n]}\n");
+    }
+    SDL_CloseIO(io);
 }
 
+#endif /* FRAME_STATS */
+
 /*
- * Function to Set the CellType at a Given Position
+ * Function to Get the CPU Time Used by the Process
  *
- * This function sets the type of cell at the specified (x, y) position
- * in the game grid using bit manipulation for efficient storage.
+ * This includes every thread, so the simulation and update threads count.
+ * Where CLOCK_PROCESS_CPUTIME_ID is missing, clock() is used instead; on
+ * Windows that measures wall time, not CPU time.
  */
-static void put_cell_at_(GameContext *ctx, char x, char y, CellType ct)
+static Uint64 cpu_time_ns_(void)
 {
-    const int shift = SHIFT(x, y);
-    const int adjust = shift % 8;
-    unsigned char *const pos = ctx->cells + (shift / 8);
-    unsigned short range;
-    SDL_memcpy(&range, pos, sizeof(range));
-    range &= ~(THREE_BITS << adjust);     /* Clear bits */
-    range |= (ct & THREE_BITS) << adjust; /* Set bits */
-    SDL_memcpy(pos, &range, sizeof(range));
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0)
+    {
+        return (Uint64)ts.tv_sec * SDL_NS_PER_SECOND + (Uint64)ts.tv_nsec;
+    }
+#endif
+    return (Uint64)clock() * SDL_NS_PER_SECOND / CLOCKS_PER_SEC;
 }
 
 /*
- * Function to Set the Position of an SDL_FRect Based on Grid Coordinates
+ * Function to Wake SDL_AppIterate When a Timer Fires
  *
- * This function calculates the pixel position of a rectangle (used for rendering)
- * based on grid coordinates and the size of each block.
+ * Runs on SDL's timer thread; a one-shot timer.
  */
-static void set_rect_xy_(SDL_FRect *r, short x, short y)
+static Uint32 SDLCALL pacing_timer_(void *userdata, SDL_TimerID timer, Uint32 interval)
 {
-    r->x = (float)(x * BLOCK_SIZE_IN_PIXELS);
-    r->y = (float)(y * BLOCK_SIZE_IN_PIXELS);
+    Pacing *p = (Pacing *)userdata;
+    SDL_Event wake;
+
+    (void)timer;
+    (void)interval;
+    SDL_zero(wake);
+    wake.type = p->wake_event;
+    SDL_SetAtomicInt(&p->wake_pending, 0);
+    SDL_PushEvent(&wake);
+    return 0;
 }
 
 /*
- * Function to Wrap Around Grid Boundaries
+ * Function to Set Up Frame Pacing
  *
- * This function ensures that a value wraps around if it goes beyond the grid boundaries,
- * allowing for continuous movement from one edge of the grid to the opposite edge.
+ * With on_change, SDL is told to call SDL_AppIterate only after events,
+ * and an event type is registered to wake it when there is something new
+ * to draw. fps of 0 leaves the frame rate uncapped; vsync is passed to
+ * SDL_SetRenderVSync unless vsync_name is NULL.
  */
-static void wrap_around_(char *val, char max)
+static void pacing_init_(AppState *as, bool on_change, unsigned fps, int vsync, const char *vsync_name, Uint64 measure_seconds)
 {
-    if (*val < 0)
+    Pacing *p = &as->pacing;
+
+    if (vsync_name && !SDL_SetRenderVSync(as->renderer, vsync))
     {
-        *val = max - 1;
+        SDL_Log("Cannot set vsync %s: %s", vsync_name, SDL_GetError());
     }
-    else if (*val > max - 1)
+    if (on_change)
     {
-        *val = 0;
+        p->wake_event = SDL_RegisterEvents(1);
+        if (p->wake_event && SDL_SetHint(SDL_HINT_MAIN_CALLBACK_RATE, "waitevent"))
+        {
+            p->on_change = true;
+        }
+        else
+        {
+            SDL_Log("Cannot wait for events; drawing every frame: %s", SDL_GetError());
+        }
     }
+    p->changed = true;
+    p->frame_ticks = fps ? SDL_GetPerformanceFrequency() / fps : 0;
+    p->deadline = SDL_GetPerformanceCounter();
+    p->measure_ticks = measure_seconds * SDL_GetPerformanceFrequency();
+    p->measure_start = p->deadline;
+    p->cpu_start = cpu_time_ns_();
+    SDL_snprintf(p->label, sizeof(p->label), "%s, %u fps cap, vsync %s", p->on_change ? "on-change" : "continuous", fps,
+                 vsync_name ? vsync_name : "default");
 }
 
 /*
- * Function to Initialize the Game State
- *
- * This function resets the game state to its initial conditions, placing the player
- * at the center of the grid and clearing all other cells.
+ * Function to Make SDL Call SDL_AppIterate Again Soon
  */
-void game_initialize(GameContext *ctx)
+static void pacing_wake_(Pacing *p)
 {
-    SDL_zeroa(ctx->cells);                  /* Clear the game grid */
-    ctx->player_xpos = GAME_GRID_WIDTH / 2; /* Set player position to center */
-    ctx->player_ypos = GAME_GRID_HEIGHT / 2;
-    ctx->next_dir = DIR_RIGHT;                                          /* Set initial direction */
-    put_cell_at_(ctx, ctx->player_xpos, ctx->player_ypos, CELL_PLAYER); /* Place the player on the grid */
+    SDL_Event wake;
+
+    if (p->on_change)
+    {
+        SDL_zero(wake);
+        wake.type = p->wake_event;
+        SDL_PushEvent(&wake);
+    }
 }
 
 /*
- * Function to Update the Player's Next Direction Based on Input
+ * Function to Wake SDL_AppIterate When the Next Game Step Is Due
  *
- * This function sets the player's next movement direction, which will be used
- * in the game logic update to move the player.
+ * Only needed when stepping on the main thread; the simulation thread
+ * sends its own wake event after every step.
  */
-void player_redir(GameContext *ctx, Direction dir)
+static void pacing_wake_for_step_(AppState *as)
 {
-    ctx->next_dir = dir;
+    Pacing *p = &as->pacing;
+    const Uint64 now = SDL_GetTicks();
+    const Uint64 due = as->last_step + STEP_RATE_IN_MILLISECONDS;
+
+    if (!p->on_change || as->sim_thread || !SDL_CompareAndSwapAtomicInt(&p->wake_pending, 0, 1))
+    {
+        return;
+    }
+    p->wake_timer = SDL_AddTimer(due > now ? (Uint32)(due - now) : 1U, pacing_timer_, p);
+    if (!p->wake_timer)
+    {
+        SDL_SetAtomicInt(&p->wake_pending, 0);
+        pacing_wake_(p);
+    }
 }
 
 /*
- * Function to Update the Game Logic
+ * Function to Wait Until the Next Frame May Start
  *
- * This function updates the game state, moving the player based on the current direction,
- * wrapping around the grid boundaries, and handling interactions with other cells.
+ * Sleeps until PACING_SPIN_NS before the deadline and spins for the rest.
+ * A frame that starts late moves the deadlines back instead of letting
+ * the following frames catch up in a burst.
  */
-void game_step(GameContext *ctx)
+static void pacing_wait_(Pacing *p)
 {
-    CellType ct;
-    char prev_xpos = ctx->player_xpos;
-    char prev_ypos = ctx->player_ypos;
+    const Uint64 freq = SDL_GetPerformanceFrequency();
+    Uint64 now = SDL_GetPerformanceCounter();
 
-    /* Move player based on next direction */
-    switch (ctx->next_dir)
+    if (!p->frame_ticks)
     {
-    case DIR_RIGHT:
-        ++ctx->player_xpos;
-        break;
-    case DIR_UP:
-        --ctx->player_ypos;
-        break;
-    case DIR_LEFT:
-        --ctx->player_xpos;
-        break;
-    case DIR_DOWN:
-        ++ctx->player_ypos;
-        break;
+        return;
     }
-
-    /* Wrap around the grid boundaries */
-    wrap_around_(&ctx->player_xpos, GAME_GRID_WIDTH);
-    wrap_around_(&ctx->player_ypos, GAME_GRID_HEIGHT);
-
-    /* Check for collisions or interactions */
-    ct = cell_at(ctx, ctx->player_xpos, ctx->player_ypos);
-    if (ct != CELL_EMPTY)
+    p->deadline += p->frame_ticks;
+    if (p->deadline <= now)
     {
-        /* Handle collision or interaction (e.g., restart game) */
-        game_initialize(ctx);
+        p->deadline = now;
         return;
     }
+    if ((p->deadline - now) * SDL_NS_PER_SECOND / freq > PACING_SPIN_NS)
+    {
+        SDL_DelayNS((p->deadline - now) * SDL_NS_PER_SECOND / freq - PACING_SPIN_NS);
+    }
+    while (SDL_GetPerformanceCounter() < p->deadline)
+    {
+        SDL_CPUPauseInstruction();
+    }
+}
 
-    /* Update the player's position on the grid */
-    put_cell_at_(ctx, prev_xpos, prev_ypos, CELL_EMPTY);                /* Clear previous position */
-    put_cell_at_(ctx, ctx->player_xpos, ctx->player_ypos, CELL_PLAYER); /* Set new position */
+/*
+ * Function to Record That a Frame Was Presented
+ */
+static void pacing_presented_(Pacing *p)
+{
+    const Uint64 now = SDL_GetPerformanceCounter();
+
+    if (p->frames > 0)
+    {
+        p->intervals[(p->frames - 1) % PACING_MEASURE_FRAMES] = now - p->last_present;
+    }
+    p->frames++;
+    p->last_present = now;
 }
 
 /*
- * Function to Handle Keyboard Input Events
+ * Function to Log the Measured Frame Rate, CPU Time and Jitter
  *
- * This function processes keyboard input and updates the game state accordingly.
- * It handles movement input, restarting the game, and quitting the application.
+ * Jitter is the standard deviation of the time between presents and the
+ * 99th percentile of its distance from their mean, over the last
+ * PACING_MEASURE_FRAMES frames.
  */
-static int handle_key_event_(GameContext *ctx, SDL_Scancode key_code)
+static void pacing_report_(Pacing *p)
 {
-    switch (key_code)
+    static Uint64 deviation[PACING_MEASURE_FRAMES];
+    const double ms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+    const double seconds = (double)(SDL_GetPerformanceCounter() - p->measure_start) * ms / 1000.0;
+    const double cpu_ms = (double)(cpu_time_ns_() - p->cpu_start) / 1e6;
+    const size_t n = p->frames > 1 ? (size_t)SDL_min(p->frames - 1, (Uint64)PACING_MEASURE_FRAMES) : 0;
+    double mean = 0.0;
+    double var = 0.0;
+    Uint64 worst = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++)
     {
-    /* Quit application */
-    case SDL_SCANCODE_ESCAPE:
-    case SDL_SCANCODE_Q:
-        return SDL_APP_SUCCESS;
-    /* Restart the game */
-    case SDL_SCANCODE_R:
-        game_initialize(ctx);
-        break;
-    /* Change player direction */
-    case SDL_SCANCODE_RIGHT:
-        player_redir(ctx, DIR_RIGHT);
-        break;
-    case SDL_SCANCODE_UP:
-        player_redir(ctx, DIR_UP);
-        break;
-    case SDL_SCANCODE_LEFT:
-        player_redir(ctx, DIR_LEFT);
-        break;
-    case SDL_SCANCODE_DOWN:
-        player_redir(ctx, DIR_DOWN);
-        break;
-    default:
-        break;
+        mean += (double)p->intervals[i];
+        worst = SDL_max(worst, p->intervals[i]);
     }
-    return SDL_APP_CONTINUE;
+    mean = n ? mean / (double)n : 0.0;
+    for (i = 0; i < n; i++)
+    {
+        const double d = (double)p->intervals[i] - mean;
+        var += d * d;
+        deviation[i] = (Uint64)(d < 0.0 ? -d : d);
+    }
+    SDL_qsort(deviation, n, sizeof(deviation[0]), compare_u64_);
+
+    SDL_Log("Pacing: %s", p->label);
+    SDL_Log("Pacing: %.1f frames/s, %.1f iterations/s over %.1f s", (double)p->frames / seconds,
+            (double)p->iterations / seconds, seconds);
+    SDL_Log("Pacing: CPU %.2f ms per second (%.1f%% of one core)", cpu_ms / seconds, cpu_ms / seconds / 10.0);
+    SDL_Log("Pacing: frame time mean %.3f ms, stddev %.3f ms, p99 deviation %.3f ms, max %.3f ms", mean * ms,
+            n ? SDL_sqrt(var / (double)n) * ms : 0.0, n ? (double)deviation[(n * 99) / 100] * ms : 0.0, (double)worst * ms);
 }
 
 /*
@@ -262,51 +3314,88 @@ static int handle_key_event_(GameContext *ctx, SDL_Scancode key_code)
  *
  * This function is called repeatedly and handles the timing of game logic updates
  * and rendering. It ensures the game logic is updated at the specified rate and
- * renders the game grid to the screen.
+ * renders the game grid to the screen. With --on-change it returns without
+ * drawing when nothing changed since the last frame.
  */
 SDL_AppResult SDL_AppIterate(void *appstate)
 {
     AppState *as = (AppState *)appstate;
     GameContext *ctx = &as->game_ctx;
     const Uint64 now = SDL_GetTicks();
-    SDL_FRect r;
-    unsigned i;
-    unsigned j;
-    CellType ct;
+    const Snapshot *snap = NULL;
+    Uint32 cells[VIEW_MATRIX_SIZE];
+
+    as->pacing.iterations++;
+    if (as->pacing.measure_ticks && SDL_GetPerformanceCounter() - as->pacing.measure_start >= as->pacing.measure_ticks)
+    {
+        pacing_report_(&as->pacing);
+        return SDL_APP_SUCCESS;
+    }
+    STATS_BEGIN_FRAME(as);
 
-    /* Run game logic if it's time to update */
+    /* Take the newest state from the simulation thread, or run game logic if it's time to update */
+    if (as->sim_thread)
+    {
+        const Uint64 shown = as->shown_step;
+        snap = take_snapshot_(as);
+        as->pacing.changed |= as->shown_step != shown;
+    }
     while ((now - as->last_step) >= STEP_RATE_IN_MILLISECONDS)
     {
-        game_step(ctx);
+        if (!as->sim_thread)
+        {
+            game_step(ctx);
+            journal_step_(&as->journal, ++as->steps, ctx);
+        }
+        entities_step(&as->entities, ctx);
         as->last_step += STEP_RATE_IN_MILLISECONDS;
+        as->pacing.changed = true;
+    }
+    STATS_END_PHASE(as, PHASE_STEP);
+
+    /* Nothing new to show; sleep until the next step or event */
+    if (as->pacing.on_change && !as->pacing.changed)
+    {
+        pacing_wake_for_step_(as);
+        return SDL_APP_CONTINUE;
     }
+    as->pacing.changed = false;
 
     /* Rendering */
-    r.w = r.h = BLOCK_SIZE_IN_PIXELS;
-    SDL_SetRenderDrawColor(as->renderer, 0, 0, 0, SDL_ALPHA_OPAQUE); /* Clear color */
-    SDL_RenderClear(as->renderer);
-    for (i = 0; i < GAME_GRID_WIDTH; i++)
+    camera_follow_(as);
+#if DIRTY_RENDERING
+    if (as->target)
     {
-        for (j = 0; j < GAME_GRID_HEIGHT; j++)
-        {
-            ct = cell_at(ctx, i, j);
-            if (ct == CELL_EMPTY)
-            {
-                continue;
-            }
-            set_rect_xy_(&r, i, j);
-            if (ct == CELL_PLAYER)
-            {
-                SDL_SetRenderDrawColor(as->renderer, 255, 255, 0, SDL_ALPHA_OPAQUE); /* Player color */
-            }
-            else
-            {
-                SDL_SetRenderDrawColor(as->renderer, 0, 128, 0, SDL_ALPHA_OPAQUE); /* Other cells */
-            }
-            SDL_RenderFillRect(as->renderer, &r);
-        }
+        render_dirty_(as, cells);
+    }
+    else
+#endif
+    {
+        render_full_(as, cells);
+    }
+    if (as->entities.end > 0)
+    {
+        draw_entities_(as);
+    }
+    /* Keep drawing frames while the player moves between cells */
+    if (snap && draw_player_between_steps_(as, snap))
+    {
+        as->pacing.changed = true;
+        pacing_wake_(&as->pacing);
+    }
+#if FRAME_STATS
+    if (as->stats.overlay)
+    {
+        stats_draw_overlay_(as);
     }
+#endif
+    STATS_END_PHASE(as, PHASE_DRAW);
     SDL_RenderPresent(as->renderer);
+    pacing_presented_(&as->pacing);
+    STATS_END_PHASE(as, PHASE_PRESENT);
+    STATS_END_FRAME(as);
+    pacing_wake_for_step_(as);
+    pacing_wait_(&as->pacing);
     return SDL_APP_CONTINUE;
 }
 
@@ -318,6 +3407,169 @@ SDL_AppResult SDL_AppIterate(void *appstate)
  */
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 {
+    Uint64 headless_steps = 0;
+    Uint64 grid_rounds = 0;
+    int micro_bench = 0;
+    Uint64 update_rounds = 0;
+    Uint64 entity_rounds = 0;
+    Uint32 entity_count = 0;
+    unsigned jobs = 0;
+    Uint32 seed = HEADLESS_DEFAULT_SEED;
+    int headless = 0;
+    int full_redraw = 0;
+    int sim_thread = 0;
+    const char *trace_path = NULL;
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    Uint64 seek = ~0ULL;
+    bool on_change = false;
+    unsigned fps = 0;
+    int vsync = 0;
+    const char *vsync_name = NULL;
+    Uint64 measure_seconds = 0;
+    int i;
+
+    /* Parse command line options */
+    for (i = 1; i < argc; i++)
+    {
+        if (SDL_strcmp(argv[i], "--headless") == 0 && i + 1 < argc)
+        {
+            headless = 1;
+            headless_steps = SDL_strtoull(argv[++i], NULL, 10);
+        }
+        else if (SDL_strcmp(argv[i], "--grid-bench") == 0 && i + 1 < argc)
+        {
+            grid_rounds = SDL_strtoull(argv[++i], NULL, 10);
+        }
+        else if (SDL_strcmp(argv[i], "--bench") == 0)
+        {
+            micro_bench = 1;
+        }
+        else if (SDL_strcmp(argv[i], "--update-bench") == 0 && i + 1 < argc)
+        {
+            update_rounds = SDL_strtoull(argv[++i], NULL, 10);
+        }
+        else if (SDL_strcmp(argv[i], "--entity-bench") == 0 && i + 1 < argc)
+        {
+            entity_rounds = SDL_strtoull(argv[++i], NULL, 10);
+        }
+        else if (SDL_strcmp(argv[i], "--entities") == 0 && i + 1 < argc)
+        {
+            entity_count = (Uint32)SDL_strtoul(argv[++i], NULL, 10);
+        }
+        else if (SDL_strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+        {
+            jobs = (unsigned)SDL_strtoul(argv[++i], NULL, 10);
+        }
+        else if (SDL_strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = (Uint32)SDL_strtoul(argv[++i], NULL, 0);
+        }
+        else if (SDL_strcmp(argv[i], "--full-redraw") == 0)
+        {
+            full_redraw = 1;
+        }
+        else if (SDL_strcmp(argv[i], "--sim-thread") == 0)
+        {
+            sim_thread = 1;
+        }
+        else if (SDL_strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            trace_path = argv[++i];
+        }
+        else if (SDL_strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            record_path = argv[++i];
+        }
+        else if (SDL_strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            replay_path = argv[++i];
+        }
+        else if (SDL_strcmp(argv[i], "--seek") == 0 && i + 1 < argc)
+        {
+            seek = SDL_strtoull(argv[++i], NULL, 10);
+        }
+        else if (SDL_strcmp(argv[i], "--on-change") == 0)
+        {
+            on_change = true;
+        }
+        else if (SDL_strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+        {
+            fps = (unsigned)SDL_strtoul(argv[++i], NULL, 10);
+        }
+        else if (SDL_strcmp(argv[i], "--vsync") == 0 && i + 1 < argc &&
+                 (SDL_strcmp(argv[i + 1], "on") == 0 || SDL_strcmp(argv[i + 1], "off") == 0 || SDL_strcmp(argv[i + 1], "adaptive") == 0))
+        {
+            vsync_name = argv[++i];
+            vsync = vsync_name[0] == 'a' ? SDL_RENDERER_VSYNC_ADAPTIVE : vsync_name[1] == 'n' ? 1 : SDL_RENDERER_VSYNC_DISABLED;
+        }
+        else if (SDL_strcmp(argv[i], "--measure") == 0 && i + 1 < argc)
+        {
+            measure_seconds = SDL_strtoull(argv[++i], NULL, 10);
+        }
+        else
+        {
+            SDL_Log("Usage: %s [--headless STEPS | --grid-bench ROUNDS | --bench | --update-bench ROUNDS | --entity-bench ROUNDS | --replay FILE [--seek STEP]] [--seed SEED] [--jobs N] [--entities N] [--record FILE] [--full-redraw] [--sim-thread] [--trace FILE] [--on-change] [--fps N] [--vsync on|off|adaptive] [--measure SECONDS]", argv[0]);
+            return SDL_APP_FAILURE;
+        }
+    }
+
+    if ((record_path || replay_path) && !GRID_INLINE)
+    {
+        SDL_Log("The chunked grid cannot be checkpointed, so it cannot be recorded or replayed");
+        return SDL_APP_FAILURE;
+    }
+
+#if GRID_UPDATE
+    /* Start the whole-grid update threads, stopped in SDL_AppQuit */
+    tile_pool_start_(&update_pool_, jobs);
+#else
+    if (update_rounds || jobs)
+    {
+        SDL_Log("Built with GRID_UPDATE=0; there is no whole-grid update to run");
+        return SDL_APP_FAILURE;
+    }
+#endif
+
+    /* Headless runs need no SDL subsystem at all */
+    if (grid_rounds)
+    {
+        return run_grid_bench_(grid_rounds, seed);
+    }
+    if (micro_bench)
+    {
+        return run_micro_bench_(seed);
+    }
+#if GRID_UPDATE
+    if (update_rounds)
+    {
+        return run_update_bench_(update_rounds);
+    }
+#endif
+    if (entity_rounds)
+    {
+        return run_entity_bench_(entity_rounds, entity_count, seed);
+    }
+    if (replay_path)
+    {
+        return run_replay_(replay_path, seek);
+    }
+    if (headless)
+    {
+        static GameContext ctx; /* Large grids do not fit on the stack */
+        EntityPool entities = {0};
+        Arena arena = {0};
+        SDL_AppResult result;
+        if (entity_count && !entities_create_(&entities, &arena, entity_count, seed))
+        {
+            SDL_Log("Headless: cannot allocate %u entities", (unsigned)entity_count);
+            return SDL_APP_FAILURE;
+        }
+        result = run_headless_(&ctx, &entities, headless_steps, seed, record_path);
+        arena_free_(&arena);
+        return result;
+    }
+
     /* Initialize SDL subsystems */
     if (!SDL_Init(SDL_INIT_VIDEO))
     {
@@ -333,17 +3585,64 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 
     *appstate = as;
 
+#if FRAME_STATS
+    as->stats.trace_path = trace_path;
+#else
+    if (trace_path)
+    {
+        SDL_Log("Built with FRAME_STATS=0; not writing a trace to '%s'", trace_path);
+    }
+#endif
+
     /* Create SDL window and renderer */
     if (!SDL_CreateWindowAndRenderer("{{PROJECT_NAME}}", SDL_WINDOW_WIDTH, SDL_WINDOW_HEIGHT, 0, &as->window, &as->renderer))
     {
         return SDL_APP_FAILURE;
     }
 
+    /* Keep the grid on a render target and redraw only what changed */
+    if (!full_redraw && DIRTY_RENDERING)
+    {
+        create_target_(as);
+    }
+
+    /* Decide when frames are drawn */
+    pacing_init_(as, on_change, fps, vsync, vsync_name, measure_seconds);
+
     /* Initialize game state */
     game_initialize(&as->game_ctx);
+    if (entity_count && !entities_create_(&as->entities, &as->arena, entity_count, seed))
+    {
+        SDL_Log("Cannot allocate %u entities; running without them", (unsigned)entity_count);
+    }
+
+    /* Record before the simulation thread, which writes to the journal, starts */
+    if (record_path && !journal_open_(&as->journal, record_path, &as->game_ctx))
+    {
+        return SDL_APP_FAILURE;
+    }
+    as->sim.journal = &as->journal;
 
     as->last_step = SDL_GetTicks();
 
+    /* Start the simulation thread */
+    if (sim_thread && !GRID_INLINE)
+    {
+        SDL_Log("The chunked grid cannot be snapshotted; stepping on the main thread");
+    }
+    else if (sim_thread)
+    {
+        sim_initialize_(&as->sim);
+        as->sim.wake_event = as->pacing.on_change ? as->pacing.wake_event : 0;
+        as->prev_xpos = as->sim.ctx.player_xpos;
+        as->prev_ypos = as->sim.ctx.player_ypos;
+        as->sim_thread = SDL_CreateThread(sim_thread_, "sim", &as->sim);
+        if (!as->sim_thread)
+        {
+            SDL_Log("Failed to start the simulation thread, stepping on the main thread: %s", SDL_GetError());
+        }
+    }
+
     return SDL_APP_CONTINUE;
 }
 
@@ -355,13 +3654,39 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
  */
 SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 {
-    GameContext *ctx = &((AppState *)appstate)->game_ctx;
+    AppState *as = (AppState *)appstate;
+
+    /* Any event but a wake-up may change what is drawn */
+    if (event->type == as->pacing.wake_event && as->pacing.wake_event)
+    {
+        return SDL_APP_CONTINUE;
+    }
+    as->pacing.changed = true;
     switch (event->type)
     {
     case SDL_EVENT_QUIT:
         return SDL_APP_SUCCESS;
+    /* The render target's contents were lost; draw it again in full */
+    case SDL_EVENT_RENDER_TARGETS_RESET:
+        as->target_valid = false;
+        break;
+    /* The render target itself was lost; recreate it */
+    case SDL_EVENT_RENDER_DEVICE_RESET:
+        if (as->target)
+        {
+            SDL_DestroyTexture(as->target);
+            create_target_(as);
+        }
+        break;
     case SDL_EVENT_KEY_DOWN:
-        return handle_key_event_(ctx, event->key.scancode);
+#if FRAME_STATS
+        if (event->key.scancode == SDL_SCANCODE_F3)
+        {
+            as->stats.overlay = !as->stats.overlay;
+            break;
+        }
+#endif
+        return handle_key_event_(as, event->key.scancode);
     default:
         break;
     }
@@ -372,15 +3697,41 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
  * Application Cleanup Function
  *
  * This function is called when the application is exiting and cleans up
- * resources such as the SDL renderer and window.
+ * resources such as the simulation and update threads, wake timer, render target, SDL renderer and window.
  */
 void SDL_AppQuit(void *appstate, SDL_AppResult result)
 {
     if (appstate != NULL)
     {
         AppState *as = (AppState *)appstate;
+        if (as->pacing.wake_timer)
+        {
+            SDL_RemoveTimer(as->pacing.wake_timer);
+        }
+        if (as->sim_thread)
+        {
+            SDL_SetAtomicInt(&as->sim.quit, 1);
+            SDL_WaitThread(as->sim_thread, NULL);
+            journal_close_(&as->journal, as->sim.steps, &as->sim.ctx);
+        }
+        else
+        {
+            journal_close_(&as->journal, as->steps, &as->game_ctx);
+        }
+#if FRAME_STATS
+        if (as->stats.trace_path)
+        {
+            stats_write_trace_(&as->stats);
+        }
+#endif
+        grid_clear_(&as->game_ctx);
+        arena_free_(&as->arena);
+        SDL_DestroyTexture(as->target);
         SDL_DestroyRenderer(as->renderer);
         SDL_DestroyWindow(as->window);
         SDL_free(as);
     }
+#if GRID_UPDATE
+    tile_pool_stop_(&update_pool_);
+#endif
 }
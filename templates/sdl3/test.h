@@ -0,0 +1,434 @@
+#ifndef TEST_H
+#define TEST_H
+
+// Test harness for assertions.h
+//
+//   #include "test.h"
+//
+//   TEST(addition)
+//   {
+//     c_assert_int_eq(4, 2 + 2);
+//   }
+//
+//   TEST_MAIN()
+//
+// Every TEST registers itself before main runs. Each test runs in its own forked
+// process, several at a time, so a crash, an exit() or a stray write in one test
+// cannot affect the others. A failed assertion is reported and the test carries
+// on; the test fails if any assertion failed or its process did not exit
+// cleanly. Results are printed as tests finish, with their wall time, and tests
+// slower than the slow limit are flagged.
+//
+// Options:
+//   -j N     Run N tests at once (default: one per CPU)
+//   -f TEXT  Only run tests whose name contains TEXT
+//   -s MS    Flag tests that take longer than MS milliseconds (default: 100)
+//   -o FILE  Also write the results to FILE as JSON
+//   -l       List the tests and exit
+//
+// POSIX only. Include test.h instead of, not after, assertions.h.
+
+#ifdef ASSERTIONS_H
+#error "Include test.h before assertions.h"
+#endif
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Failed assertions are counted and the test continues, instead of exiting
+static int test_failures_;
+#define C_ASSERT_FAIL() ((void)test_failures_++)
+
+#include "assertions.h"
+
+#ifndef TEST_MAX
+#define TEST_MAX 1024 // Most tests in one program
+#endif
+
+#ifndef TEST_SLOW_MS
+#define TEST_SLOW_MS 100.0 // Default slow test limit in milliseconds
+#endif
+
+// A registered test
+typedef struct
+{
+  const char *name;   // Test name, as given to TEST
+  void (*func)(void); // Test body
+  const char *file;   // Source file of the TEST
+  int line;           // Source line of the TEST
+} TestCase;
+
+// The outcome of running one test
+typedef struct
+{
+  pid_t pid;     // Worker process while the test runs, 0 before and after
+  int status;    // Wait status of the worker
+  double start;  // Start time in milliseconds
+  double ms;     // Wall time in milliseconds
+  FILE *output;  // Where the worker writes its stdout and stderr, while it runs
+  char *text;    // Everything the test wrote, once it has finished
+  size_t length; // Length of text
+} TestResult;
+
+static TestCase test_cases_[TEST_MAX];
+static int test_count_;
+
+// Register a test; called by the constructor that TEST defines
+static inline void test_register_(const char *name, void (*func)(void), const char *file, int line)
+{
+  if (test_count_ == TEST_MAX)
+  {
+    fprintf(stderr, "Too many tests; define TEST_MAX above %d\n", TEST_MAX);
+    exit(1);
+  }
+  test_cases_[test_count_].name = name;
+  test_cases_[test_count_].func = func;
+  test_cases_[test_count_].file = file;
+  test_cases_[test_count_].line = line;
+  test_count_++;
+}
+
+// Define and register a test
+#define TEST(name)                                                      \
+  static void test_##name(void);                                        \
+  __attribute__((constructor)) static void test_register_##name(void) \
+  {                                                                     \
+    test_register_(#name, test_##name, __FILE__, __LINE__);             \
+  }                                                                     \
+  static void test_##name(void)
+
+// Define main to run every registered test
+#define TEST_MAIN()                 \
+  int main(int argc, char *argv[]) \
+  {                                 \
+    return test_run(argc, argv);    \
+  }
+
+// Monotonic time in milliseconds
+static inline double test_now_ms_(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+// Fork a worker that runs one test with its output sent to result->output
+static inline bool test_start_(const TestCase *t, TestResult *result)
+{
+  result->output = tmpfile();
+  if (!result->output)
+  {
+    perror("tmpfile");
+    return false;
+  }
+  fflush(stdout);
+  fflush(stderr);
+  result->start = test_now_ms_();
+  result->pid = fork();
+  if (result->pid < 0)
+  {
+    perror("fork");
+    result->pid = 0;
+    fclose(result->output);
+    result->output = NULL;
+    return false;
+  }
+  if (result->pid == 0)
+  {
+    dup2(fileno(result->output), STDOUT_FILENO);
+    dup2(fileno(result->output), STDERR_FILENO);
+    setvbuf(stdout, NULL, _IOLBF, 0); // Keep stdout and stderr lines in order
+    t->func();
+    fflush(stdout);
+    fflush(stderr);
+    _exit(test_failures_ > 0 ? 1 : 0);
+  }
+  return true;
+}
+
+// Describe how a worker ended, or return NULL if the test passed
+static inline const char *test_verdict_(int status, char *buf, size_t size)
+{
+  if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+  {
+    return NULL;
+  }
+  if (WIFSIGNALED(status))
+  {
+    snprintf(buf, size, "killed by signal %d (%s)", WTERMSIG(status), strsignal(WTERMSIG(status)));
+  }
+  else if (WEXITSTATUS(status) == 1)
+  {
+    snprintf(buf, size, "assertion failed");
+  }
+  else
+  {
+    snprintf(buf, size, "exited with status %d", WEXITSTATUS(status));
+  }
+  return buf;
+}
+
+// Write a string as a JSON string literal
+static inline void test_json_string_(FILE *out, const char *s, size_t n)
+{
+  size_t i;
+  fputc('"', out);
+  for (i = 0; i < n; i++)
+  {
+    const unsigned char c = (unsigned char)s[i];
+    if (c == '"' || c == '\\')
+    {
+      fprintf(out, "\\%c", c);
+    }
+    else if (c == '\n')
+    {
+      fputs("\\n", out);
+    }
+    else if (c < 0x20)
+    {
+      fprintf(out, "\\u%04x", c);
+    }
+    else
+    {
+      fputc(c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+// Read a test's captured output into a new string, setting *n to its length
+static inline char *test_read_output_(FILE *output, size_t *n)
+{
+  long size;
+  char *text;
+  fseek(output, 0, SEEK_END);
+  size = ftell(output);
+  text = malloc(size > 0 ? (size_t)size + 1 : 1);
+  *n = 0;
+  if (text && size > 0)
+  {
+    rewind(output);
+    *n = fread(text, 1, (size_t)size, output);
+  }
+  if (text)
+  {
+    text[*n] = '\0';
+  }
+  return text;
+}
+
+// Keep a finished test's output in memory and close its file, so only
+// running tests hold a file open however many tests there are
+static inline void test_collect_output_(TestResult *result)
+{
+  if (result->output)
+  {
+    result->text = test_read_output_(result->output, &result->length);
+    fclose(result->output);
+    result->output = NULL;
+  }
+}
+
+// Print one test's result line, and its verdict and output if it failed
+static inline void test_report_(const TestCase *t, const TestResult *r, const char *verdict, double slow_ms)
+{
+  printf("[%s] %-40s %10.3f ms%s\n", verdict ? "FAIL" : "PASS", t->name, r->ms, r->ms > slow_ms ? "  SLOW" : "");
+  if (verdict)
+  {
+    printf("       %s:%d: %s\n", t->file, t->line, verdict);
+    if (r->text && r->length > 0)
+    {
+      printf("%s%s", r->text, r->text[r->length - 1] == '\n' ? "" : "\n");
+    }
+  }
+  fflush(stdout);
+}
+
+// Run the registered tests; returns 0 if every selected test passed
+static inline int test_run(int argc, char *argv[])
+{
+  TestResult *results = calloc(test_count_ > 0 ? (size_t)test_count_ : 1, sizeof(TestResult));
+  const char *filter = NULL;
+  const char *json_path = NULL;
+  double slow_ms = TEST_SLOW_MS;
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  int selected[TEST_MAX];
+  int count = 0;
+  int next = 0;
+  int running = 0;
+  int done = 0;
+  int failed = 0;
+  int slow = 0;
+  double wall;
+  int opt;
+  int i;
+
+  while ((opt = getopt(argc, argv, "j:f:s:o:l")) != -1)
+  {
+    switch (opt)
+    {
+    case 'j':
+      jobs = strtol(optarg, NULL, 10);
+      break;
+    case 'f':
+      filter = optarg;
+      break;
+    case 's':
+      slow_ms = strtod(optarg, NULL);
+      break;
+    case 'o':
+      json_path = optarg;
+      break;
+    case 'l':
+      for (i = 0; i < test_count_; i++)
+      {
+        printf("%s\n", test_cases_[i].name);
+      }
+      free(results);
+      return 0;
+    default:
+      fprintf(stderr, "Usage: %s [-j jobs] [-f filter] [-s slow_ms] [-o results.json] [-l]\n", argv[0]);
+      free(results);
+      return 2;
+    }
+  }
+  if (!results)
+  {
+    perror("calloc");
+    return 2;
+  }
+  jobs = jobs > 0 ? jobs : 1;
+  for (i = 0; i < test_count_; i++)
+  {
+    if (!filter || strstr(test_cases_[i].name, filter))
+    {
+      selected[count++] = i;
+    }
+  }
+
+  // Keep up to jobs workers busy, reporting each test as its worker exits
+  wall = test_now_ms_();
+  while (done < count)
+  {
+    int status;
+    pid_t pid;
+    char buf[128];
+    const char *verdict;
+    TestResult *r = NULL;
+
+    while (running < jobs && next < count)
+    {
+      if (!test_start_(&test_cases_[selected[next]], &results[selected[next]]))
+      {
+        r = &results[selected[next]];
+        r->status = 2 << 8; // Reported as "exited with status 2"
+        r->ms = 0.0;
+        failed++;
+        done++;
+        test_report_(&test_cases_[selected[next]], r, test_verdict_(r->status, buf, sizeof(buf)), slow_ms);
+        r = NULL;
+      }
+      else
+      {
+        running++;
+      }
+      next++;
+      if (done == count)
+      {
+        break;
+      }
+    }
+    if (running == 0)
+    {
+      continue;
+    }
+    pid = waitpid(-1, &status, 0);
+    if (pid < 0)
+    {
+      perror("waitpid");
+      failed += count - done; // Never reported, so never passed
+      break;
+    }
+    for (i = 0; i < count && !r; i++)
+    {
+      if (results[selected[i]].pid == pid)
+      {
+        r = &results[selected[i]];
+      }
+    }
+    if (!r)
+    {
+      continue;
+    }
+    r->ms = test_now_ms_() - r->start;
+    r->status = status;
+    r->pid = 0;
+    test_collect_output_(r);
+    running--;
+    done++;
+
+    verdict = test_verdict_(status, buf, sizeof(buf));
+    failed += verdict != NULL;
+    slow += r->ms > slow_ms;
+    test_report_(&test_cases_[r - results], r, verdict, slow_ms);
+  }
+  wall = test_now_ms_() - wall;
+
+  printf("\n%d tests, %d passed, %d failed, %d slow (over %.0f ms), %.3f ms with %ld jobs\n", count, count - failed, failed, slow, slow_ms, wall, jobs);
+  for (i = 0; i < count; i++)
+  {
+    char buf[128];
+    if (test_verdict_(results[selected[i]].status, buf, sizeof(buf)))
+    {
+      printf("  FAILED: %s\n", test_cases_[selected[i]].name);
+    }
+  }
+
+  // Machine-readable results, in registration order
+  if (json_path)
+  {
+    FILE *out = fopen(json_path, "w");
+    if (!out)
+    {
+      perror(json_path);
+      failed++;
+    }
+    else
+    {
+      fprintf(out, "{\"tests\":[");
+      for (i = 0; i < count; i++)
+      {
+        const TestCase *t = &test_cases_[selected[i]];
+        const TestResult *r = &results[selected[i]];
+        char buf[128];
+        const char *verdict = test_verdict_(r->status, buf, sizeof(buf));
+        fprintf(out, "%s\n{\"name\":", i ? "," : "");
+        test_json_string_(out, t->name, strlen(t->name));
+        fprintf(out, ",\"file\":");
+        test_json_string_(out, t->file, strlen(t->file));
+        fprintf(out, ",\"line\":%d,\"passed\":%s,\"ms\":%.3f,\"slow\":%s,\"verdict\":", t->line, verdict ? "false" : "true", r->ms, r->ms > slow_ms ? "true" : "false");
+        test_json_string_(out, verdict ? verdict : "passed", strlen(verdict ? verdict : "passed"));
+        fprintf(out, ",\"output\":");
+        test_json_string_(out, r->text ? r->text : "", r->text ? r->length : 0);
+        fprintf(out, "}");
+      }
+      fprintf(out, "\n],\"passed\":%d,\"failed\":%d,\"slow\":%d,\"wall_ms\":%.3f}\n", count - failed, failed, slow, wall);
+      fclose(out);
+    }
+  }
+
+  for (i = 0; i < test_count_; i++)
+  {
+    if (results[i].output)
+    {
+      fclose(results[i].output);
+    }
+    free(results[i].text);
+  }
+  free(results);
+  return failed > 0 ? 1 : 0;
+}
+
+#endif // TEST_H
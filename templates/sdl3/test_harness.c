@@ -0,0 +1,193 @@
+#include <sys/resource.h>
+
+#include "test.h"
+
+/*
+ * Tests of test.h Itself
+ *
+ * The inner_ tests below pass, fail and crash on purpose. They only do so
+ * when TEST_HARNESS_INNER is set, which the outer tests set when they run
+ * this program again on them; in a normal run they pass and do nothing.
+ * TEST_HARNESS_MAX_FILES limits the open files of such a run.
+ */
+
+static const char *self_;   /* Path of this program, from argv[0] */
+static char output_[16384]; /* What the last inner run printed */
+
+/*
+ * Function to Tell Whether an Inner Test Should Do Its Work
+ */
+static bool inner_(void)
+{
+    return getenv("TEST_HARNESS_INNER") != NULL;
+}
+
+TEST(inner_pass)
+{
+    c_assert_int_eq(4, 2 + 2);
+}
+
+TEST(inner_fail)
+{
+    if (inner_())
+    {
+        printf("output of inner_fail\n");
+        c_assert_int_eq(5, 2 + 2);
+    }
+}
+
+TEST(inner_crash)
+{
+    if (inner_())
+    {
+        abort();
+    }
+}
+
+/* Enough tests that holding a file open for each would run out of them */
+#define INNER_MANY_(n)                                 \
+    TEST(inner_many_##n)                                \
+    {                                                   \
+        c_assert_int_eq(n, n);                          \
+    }
+#define INNER_MANY_10_(n)                                                               \
+    INNER_MANY_(n##0) INNER_MANY_(n##1) INNER_MANY_(n##2) INNER_MANY_(n##3) INNER_MANY_(n##4) \
+    INNER_MANY_(n##5) INNER_MANY_(n##6) INNER_MANY_(n##7) INNER_MANY_(n##8) INNER_MANY_(n##9)
+INNER_MANY_10_(1)
+INNER_MANY_10_(2)
+INNER_MANY_10_(3)
+INNER_MANY_10_(4)
+
+/*
+ * Function to Run This Program on Its Inner Tests
+ *
+ * Runs the tests whose name contains filter, with at most max_files file
+ * descriptors (0 for no limit) and, if json is not NULL, the JSON results
+ * written to it. Returns the exit status, or -1 if the program did not
+ * exit; what it printed is left in output_.
+ */
+static int run_inner_(const char *filter, int max_files, const char *json)
+{
+    int fds[2];
+    size_t n = 0;
+    ssize_t r;
+    int status;
+    pid_t pid;
+
+    if (pipe(fds) != 0 || (pid = fork()) < 0)
+    {
+        return -1;
+    }
+    if (pid == 0)
+    {
+        char limit[16];
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        snprintf(limit, sizeof(limit), "%d", max_files);
+        setenv("TEST_HARNESS_INNER", "1", 1);
+        setenv("TEST_HARNESS_MAX_FILES", limit, 1);
+        if (json)
+        {
+            execl(self_, self_, "-j", "2", "-f", filter, "-o", json, (char *)NULL);
+        }
+        else
+        {
+            execl(self_, self_, "-j", "1", "-f", filter, (char *)NULL);
+        }
+        _exit(127);
+    }
+    close(fds[1]);
+    while ((r = read(fds[0], output_ + n, sizeof(output_) - 1 - n)) > 0)
+    {
+        n += (size_t)r;
+    }
+    output_[n] = '\0';
+    close(fds[0]);
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+    {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+TEST(reports_pass_fail_and_crash)
+{
+    c_assert_int_eq(1, run_inner_("inner_", 0, NULL));
+    c_assert_true(strstr(output_, "[PASS] inner_pass") != NULL);
+    c_assert_true(strstr(output_, "[FAIL] inner_fail") != NULL);
+    c_assert_true(strstr(output_, "assertion failed") != NULL);
+    c_assert_true(strstr(output_, "output of inner_fail") != NULL);
+    c_assert_true(strstr(output_, "[FAIL] inner_crash") != NULL);
+    c_assert_true(strstr(output_, "killed by signal") != NULL);
+    c_assert_true(strstr(output_, "43 tests, 41 passed, 2 failed") != NULL);
+}
+
+TEST(writes_json_results)
+{
+    char path[] = "/tmp/test_harness_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *f;
+    char *json = NULL;
+    size_t n;
+
+    c_assert_true(fd >= 0);
+    c_assert_int_eq(1, run_inner_("inner_", 0, path));
+    if ((f = fopen(path, "r")) != NULL)
+    {
+        json = test_read_output_(f, &n);
+        fclose(f);
+    }
+    close(fd);
+    unlink(path);
+    c_assert_true(json != NULL);
+    if (json)
+    {
+        c_assert_true(strstr(json, "{\"tests\":[") == json);
+        c_assert_true(strstr(json, "{\"name\":\"inner_pass\",") != NULL);
+        c_assert_true(strstr(json, "\"passed\":false,") != NULL);
+        c_assert_true(strstr(json, "\"verdict\":\"assertion failed\"") != NULL);
+        c_assert_true(strstr(json, "\"output\":\"output of inner_fail\\n") != NULL);
+        c_assert_true(strstr(json, "],\"passed\":41,\"failed\":2,") != NULL);
+        free(json);
+    }
+}
+
+TEST(runs_more_tests_than_open_files)
+{
+    const char *p = output_;
+    int passed = 0;
+
+    c_assert_int_eq(0, run_inner_("inner_many_", 16, NULL));
+    while ((p = strstr(p, "[PASS] inner_many_")) != NULL)
+    {
+        passed++;
+        p++;
+    }
+    c_assert_int_eq(40, passed);
+    c_assert_true(strstr(output_, "40 tests, 40 passed, 0 failed") != NULL);
+}
+
+TEST(fails_tests_that_cannot_start)
+{
+    /* Only stdin, stdout and stderr fit, so no test can get an output file */
+    c_assert_int_eq(1, run_inner_("inner_pass", 3, NULL));
+    c_assert_true(strstr(output_, "[FAIL] inner_pass") != NULL);
+    c_assert_true(strstr(output_, "1 tests, 0 passed, 1 failed") != NULL);
+}
+
+/* TEST_MAIN, keeping argv[0] so the tests can run this program again */
+int main(int argc, char *argv[])
+{
+    const char *max_files = getenv("TEST_HARNESS_MAX_FILES");
+    struct rlimit rl;
+
+    self_ = argv[0];
+    if (inner_() && max_files && atoi(max_files) > 0)
+    {
+        rl.rlim_cur = rl.rlim_max = (rlim_t)atoi(max_files);
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    return test_run(argc, argv);
+}
@@ -0,0 +1,90 @@
+#!/bin/bash
+# Check that boild generates projects for boil-render, including batches
+# larger than one read buffer, and refuses oversized requests with an
+# error reply instead of dropping the connection.
+# Usage: tests/daemon.sh [boil-render] [boild]
+
+RENDER="$(realpath "${1:-./boil-render}")"
+DAEMON="$(realpath "${2:-$(dirname "$RENDER")/boild}")"
+WORK="$(mktemp -d)"
+export BOIL_SOCKET="$WORK/boild.sock"
+umask 022
+status=0
+
+"$DAEMON" "$BOIL_SOCKET" 2> "$WORK/boild.log" &
+DAEMON_PID=$!
+trap 'kill $DAEMON_PID 2> /dev/null; wait $DAEMON_PID 2> /dev/null; rm -rf "$WORK"' EXIT
+for _ in $(seq 50); do
+    [ -S "$BOIL_SOCKET" ] && break
+    sleep 0.1
+done
+if [ ! -S "$BOIL_SOCKET" ]; then
+    echo "FAIL: boild did not start"
+    cat "$WORK/boild.log"
+    exit 1
+fi
+
+# Function to check a command's exit status
+expect_status() {
+    local want="$1"
+    shift
+    "$@" > "$WORK/out.log" 2>&1
+    local got=$?
+    if [ "$got" = "$want" ]; then
+        echo "ok: $* exited $got"
+    else
+        echo "FAIL: $* exited $got, expected $want"
+        cat "$WORK/out.log"
+        status=1
+    fi
+}
+
+mkdir -p "$WORK/templates/t/src" "$WORK/small" "$WORK/large"
+printf 'project {{PROJECT_NAME}}\n' > "$WORK/templates/t/src/name.txt"
+
+# A normal request
+cd "$WORK/small" || exit 1
+expect_status 0 "$RENDER" "$WORK/templates/t" alpha beta
+if [ "$(cat alpha/src/name.txt)" = "project alpha" ] && [ "$(cat beta/src/name.txt)" = "project beta" ]; then
+    echo "ok: named projects rendered"
+else
+    echo "FAIL: named projects not rendered"
+    status=1
+fi
+
+# More names than fit in 1 MiB, which boild used to cut off
+cd "$WORK/large" || exit 1
+expect_status 0 "$RENDER" -n 40000 "$WORK/templates/t"
+count="$(find . -mindepth 1 -maxdepth 1 -type d | wc -l)"
+if [ "$count" = 40000 ]; then
+    echo "ok: 40000 projects rendered"
+else
+    echo "FAIL: $count projects rendered, expected 40000"
+    status=1
+fi
+
+# A request over DAEMON_MAX_REQUEST gets an error and a failure status
+reply="$(perl -MIO::Socket::UNIX -e '
+    $SIG{PIPE} = "IGNORE";
+    my $s = IO::Socket::UNIX->new(Peer => $ARGV[0]) or die "connect: $!";
+    print $s "boild 1\ncwd /tmp\ntemplate /tmp\n";
+    my $line = "name " . ("x" x 250) . "\n";
+    print $s $line x 4096 for 1 .. 33;
+    shutdown($s, 1);
+    print while <$s>;
+' "$BOIL_SOCKET")"
+if [[ "$reply" == *"Error: boild takes requests of up to"*"=1" ]]; then
+    echo "ok: oversized request refused"
+else
+    echo "FAIL: oversized request got '$reply'"
+    status=1
+fi
+
+# boild keeps serving after refusing a request
+cd "$WORK/small" || exit 1
+expect_status 0 "$RENDER" "$WORK/templates/t" gamma
+if ! kill -0 $DAEMON_PID 2> /dev/null || [ ! -f gamma/src/name.txt ]; then
+    echo "FAIL: boild stopped serving"
+    status=1
+fi
+exit $status
@@ -0,0 +1,50 @@
+#!/bin/bash
+# Check that placeholders around the end of the first read buffer
+# (RENDER_BUF_SIZE, 64 KiB) are replaced, and that near misses there are
+# not, by comparing loose and packed renders with what the sed fallback in
+# boil.sh would write.
+# Usage: tests/render.sh [boil-render]
+
+RENDER="$(realpath "${1:-./boil-render}")"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+export BOIL_SOCKET=""
+umask 022
+status=0
+
+NAME="a_project_name_longer_than_the_placeholder"
+
+# Function to write count filler bytes
+filler() {
+    head -c "$1" /dev/zero | tr '\0' x
+}
+
+# Function to compare every rendered file with the sed fallback's output
+compare_with_sed() {
+    local kind="$1" file
+    for file in "$T"/*; do
+        file="${file##*/}"
+        if sed "s/{{PROJECT_NAME}}/$NAME/g" "$T/$file" | cmp -s - "$WORK/$kind/$NAME/$file"; then
+            continue
+        fi
+        echo "FAIL: $kind render of $file differs from sed"
+        status=1
+        return
+    done
+    echo "ok: $kind render matches sed"
+}
+
+T="$WORK/templates/t"
+mkdir -p "$T"
+for offset in $(seq 65516 65540); do
+    { filler "$offset"; printf '{{PROJECT_NAME}}'; filler 100; printf '{{PROJECT_NAME}}\n'; } > "$T/at_$offset.txt"
+    { filler "$offset"; printf '{{PROJECT_NAME'; filler 100; printf '{PROJECT_NAME}}\n'; } > "$T/near_$offset.txt"
+done
+
+mkdir "$WORK/loose" "$WORK/packed"
+(cd "$WORK/loose" && "$RENDER" "$T" "$NAME") > /dev/null || exit 1
+compare_with_sed loose
+"$RENDER" -c "$T" > /dev/null || exit 1
+(cd "$WORK/packed" && "$RENDER" "$T" "$NAME") > /dev/null || exit 1
+compare_with_sed packed
+exit $status
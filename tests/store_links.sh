@@ -0,0 +1,78 @@
+#!/bin/bash
+# Check that files linked from the object store keep their template's
+# execute bits, with -H (hard links) and without (clones or copies), and
+# that an object written through a hard link is never handed out again.
+# Usage: tests/store_links.sh [boil-render]
+
+RENDER="$(realpath "${1:-./boil-render}")"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+export BOIL_SOCKET=""
+umask 022
+status=0
+
+# Function to compare a file's mode with the expected one
+expect_mode() {
+    local mode
+    mode="$(stat -c %a "$1")"
+    if [ "$mode" = "$2" ]; then
+        echo "ok: $1 is $2"
+    else
+        echo "FAIL: $1 is $mode, expected $2"
+        status=1
+    fi
+}
+
+mkdir -p "$WORK/templates/t"
+printf '#!/bin/sh\necho hello\n' > "$WORK/templates/t/run.sh"
+printf 'plain data\n' > "$WORK/templates/t/data.txt"
+printf 'project {{PROJECT_NAME}}\n' > "$WORK/templates/t/name.txt"
+chmod 755 "$WORK/templates/t/run.sh"
+chmod 644 "$WORK/templates/t/data.txt"
+"$RENDER" -c "$WORK/templates/t" || exit 1
+
+cd "$WORK" || exit 1
+"$RENDER" -H templates/t linked || exit 1
+"$RENDER" templates/t copied || exit 1
+
+# Hard links drop the write bits but keep the execute bits
+expect_mode linked/run.sh 555
+expect_mode linked/data.txt 444
+expect_mode linked/name.txt 644
+expect_mode copied/run.sh 755
+expect_mode copied/data.txt 644
+if [ "$(stat -c %h linked/run.sh)" -lt 2 ]; then
+    echo "FAIL: linked/run.sh is not a hard link to the store"
+    status=1
+fi
+if ! linked/run.sh > /dev/null; then
+    echo "FAIL: linked/run.sh does not run"
+    status=1
+fi
+
+# Write to a stored object through a project's hard link, keeping its mode
+chmod u+w linked/data.txt
+printf 'PLAIN DATA\n' > linked/data.txt
+chmod u-w linked/data.txt
+"$RENDER" -H templates/t relinked || exit 1
+if [ "$(cat relinked/data.txt)" = "plain data" ]; then
+    echo "ok: modified object not handed out"
+else
+    echo "FAIL: relinked/data.txt holds '$(cat relinked/data.txt)'"
+    status=1
+fi
+if [ "$(stat -c %h relinked/data.txt)" != 1 ]; then
+    echo "FAIL: relinked/data.txt is linked to the modified object"
+    status=1
+fi
+
+# Rebuilding the pack stores the file again
+"$RENDER" -c templates/t || exit 1
+"$RENDER" -H templates/t restored || exit 1
+if [ "$(cat restored/data.txt)" = "plain data" ] && [ "$(stat -c %h restored/data.txt)" -ge 2 ]; then
+    echo "ok: object stored again"
+else
+    echo "FAIL: restored/data.txt is not a link to a good object"
+    status=1
+fi
+exit $status
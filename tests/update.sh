@@ -0,0 +1,97 @@
+#!/bin/bash
+# Check that boil-render -u re-renders what the template changed, adds and
+# removes files, leaves edited files alone as conflicts, and reports the
+# same conflicts again on the next update.
+# Usage: tests/update.sh [boil-render]
+
+RENDER="$(realpath "${1:-./boil-render}")"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+export BOIL_SOCKET=""
+umask 022
+status=0
+
+# Function to compare a file's content with the expected one
+expect_content() {
+    if [ "$(cat "$1" 2> /dev/null)" = "$2" ]; then
+        echo "ok: $1 holds '$2'"
+    else
+        echo "FAIL: $1 holds '$(cat "$1" 2> /dev/null)', expected '$2'"
+        status=1
+    fi
+}
+
+# Function to check that a path does not exist
+expect_missing() {
+    if [ -e "$1" ]; then
+        echo "FAIL: $1 still exists"
+        status=1
+    else
+        echo "ok: $1 is gone"
+    fi
+}
+
+# Function to check the summary line of an update
+expect_summary() {
+    if grep -qF "Project 'demo' updated: $1." "$WORK/update.log"; then
+        echo "ok: $1"
+    else
+        echo "FAIL: expected '$1', got:"
+        cat "$WORK/update.log"
+        status=1
+    fi
+}
+
+T="$WORK/templates/t"
+mkdir -p "$T"
+printf 'keep {{PROJECT_NAME}}\n' > "$T/keep.txt"
+printf 'old {{PROJECT_NAME}}\n' > "$T/change.txt"
+printf 'remove me\n' > "$T/remove.txt"
+printf 'template v1\n' > "$T/edited.txt"
+printf 'dropped v1\n' > "$T/dropped_edited.txt"
+
+cd "$WORK" || exit 1
+"$RENDER" "$T" demo > /dev/null || exit 1
+
+# Edit the project, then change the template
+printf 'my edit\n' > demo/edited.txt
+printf 'my edit\n' > demo/dropped_edited.txt
+printf 'mine\n' > demo/clash.txt
+printf 'new {{PROJECT_NAME}}\n' > "$T/change.txt"
+rm "$T/remove.txt" "$T/dropped_edited.txt"
+printf 'template v2\n' > "$T/edited.txt"
+mkdir "$T/sub"
+printf 'added {{PROJECT_NAME}}\n' > "$T/sub/added.txt"
+printf 'theirs\n' > "$T/clash.txt"
+
+"$RENDER" -u demo > "$WORK/update.log" 2>&1 || { cat "$WORK/update.log"; exit 1; }
+expect_summary "1 changed, 2 added, 1 removed, 3 conflicts"
+expect_content demo/keep.txt "keep demo"
+expect_content demo/change.txt "new demo"
+expect_content demo/sub/added.txt "added demo"
+expect_missing demo/remove.txt
+expect_content demo/edited.txt "my edit"
+expect_content demo/dropped_edited.txt "my edit"
+expect_content demo/clash.txt "mine"
+for path in edited.txt dropped_edited.txt clash.txt; do
+    if ! grep -qF "Conflict: demo/$path" "$WORK/update.log"; then
+        echo "FAIL: no conflict reported for $path"
+        status=1
+    fi
+done
+
+# Nothing changed since, so only the conflicts are reported again
+"$RENDER" -u demo > "$WORK/update.log" 2>&1 || { cat "$WORK/update.log"; exit 1; }
+expect_summary "0 changed, 0 added, 0 removed, 3 conflicts"
+
+# Restoring what was generated resolves a conflict: the template wins
+printf 'template v1\n' > demo/edited.txt
+"$RENDER" -u demo > "$WORK/update.log" 2>&1 || { cat "$WORK/update.log"; exit 1; }
+expect_summary "1 changed, 0 added, 0 removed, 2 conflicts"
+expect_content demo/edited.txt "template v2"
+
+# Deleting a file the template dropped resolves that conflict too
+rm demo/dropped_edited.txt
+"$RENDER" -u demo > "$WORK/update.log" 2>&1 || { cat "$WORK/update.log"; exit 1; }
+expect_summary "0 changed, 0 added, 0 removed, 1 conflicts"
+exit $status